@@ -0,0 +1,37 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstddef>
+
+// Shared helpers for the bench/ executables
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+// Keep a value (and the work that produced it) from being optimized away
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Average nanoseconds per call of fn() over `iterations` calls
+template <typename Fn>
+double nsPerCall(size_t iterations, Fn&& fn) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(iterations);
+}
+
+} // namespace bench
+
+#endif // BENCH_UTIL_H
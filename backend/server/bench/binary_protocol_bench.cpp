@@ -0,0 +1,217 @@
+// ChatBox1 binary packets against the JSON text frames they replace, for
+// a chat message and a 64 KB file chunk: decode (parse + extract the
+// fields the handler uses), encode, and frame size.
+//
+// The JSON chunk decode excludes base64 decoding (its encode includes the
+// base64 encoding a client does). The binary figures include the CRC32 of
+// the payload (v1 always, v2 with FLAG_CHECKSUM).
+//
+//   binary_protocol_bench [iterations]
+
+#include "protocol_chatbox1.h"
+#include "bench_util.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ProtocolChatBox1;
+
+namespace {
+
+using json = nlohmann::json;
+
+const std::string kRoomId = "room-4f1c";
+const std::string kText = "Sounds good, I'll push the fix after lunch. Ping me if CI breaks!";
+constexpr uint32_t kTopicId = 3;
+
+struct Decoded {
+    std::string roomId;
+    std::string text;
+};
+
+// ----- chat: JSON -----
+
+std::string encodeChatJson() {
+    return json{{"type", "chat"}, {"roomId", kRoomId}, {"content", kText}, {"replyToId", ""}}.dump();
+}
+
+Decoded decodeChatJson(std::string_view frame) {
+    json msg = json::parse(frame);
+    return Decoded{msg.value("roomId", "global"), msg.value("content", "")};
+}
+
+// ----- chat: v1 (fixed header + ChatTextPayload) -----
+
+std::string encodeChatV1() {
+    ChatTextPayload chat{};
+    std::memcpy(chat.roomId, kRoomId.data(), kRoomId.size());
+    chat.messageLen = static_cast<uint16_t>(kText.size());
+    std::string payload(reinterpret_cast<const char*>(&chat), sizeof(chat));
+    payload += kText;
+
+    PacketHeader header = createHeader(MSG_CHAT_TEXT, "user-1", kRoomId.c_str(),
+                                       static_cast<uint32_t>(payload.size()));
+    std::vector<uint8_t> packet = serializePacket(header, payload.data(), payload.size());
+    return std::string(packet.begin(), packet.end());
+}
+
+Decoded decodeChatV1(std::string_view frame) {
+    PacketHeader header;
+    std::string_view payload;
+    ChatTextPayload chat;
+    if (!parsePacket(frame, header, payload) || payload.size() < sizeof(chat)) {
+        return {};
+    }
+    std::memcpy(&chat, payload.data(), sizeof(chat));
+    return Decoded{fieldString(chat.roomId, sizeof(chat.roomId)),
+                   std::string(payload.substr(sizeof(chat), chat.messageLen))};
+}
+
+// ----- chat: v2 (varint header, interned topic, text is the payload) -----
+
+std::string encodeChatV2(uint8_t flags) {
+    PacketHeaderV2 header;
+    header.msgType = MSG_CHAT_TEXT;
+    header.flags = flags;
+    header.topicId = kTopicId;
+    return serializePacketV2(header, kText);
+}
+
+Decoded decodeChatV2(std::string_view frame) {
+    PacketHeaderV2 header;
+    std::string_view payload;
+    if (!parsePacketV2(frame, header, payload)) {
+        return {};
+    }
+    // Stand-in for the connection's InternTable lookup
+    return Decoded{header.topicId == kTopicId ? kRoomId : std::string(), std::string(payload)};
+}
+
+// ----- 64 KB file chunk -----
+
+std::string base64(const std::string& in) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        uint32_t n = (uint8_t(in[i]) << 16) | (uint8_t(in[i + 1]) << 8) | uint8_t(in[i + 2]);
+        out += alphabet[n >> 18];
+        out += alphabet[(n >> 12) & 63];
+        out += alphabet[(n >> 6) & 63];
+        out += alphabet[n & 63];
+    }
+    if (i < in.size()) {
+        uint32_t n = uint8_t(in[i]) << 16;
+        if (i + 1 < in.size()) {
+            n |= uint8_t(in[i + 1]) << 8;
+        }
+        out += alphabet[n >> 18];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < in.size() ? alphabet[(n >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+std::string encodeChunkJson(const std::string& chunk) {
+    return json{{"type", "upload_chunk"}, {"uploadId", "upload-1700000000000"},
+                {"chunkIndex", 7}, {"data", base64(chunk)}}.dump();
+}
+
+size_t decodeChunkJson(std::string_view frame) {
+    json msg = json::parse(frame);
+    std::string data = msg.value("data", "");
+    return data.size() + static_cast<size_t>(msg.value("chunkIndex", 0));
+}
+
+std::string encodeChunkV1(const std::string& chunk) {
+    FileChunkPayload header{};
+    std::memcpy(header.transferId, "upload-1700000000000", 20);
+    header.chunkIndex = 7;
+    header.chunkSize = static_cast<uint32_t>(chunk.size());
+    std::string payload(reinterpret_cast<const char*>(&header), sizeof(header));
+    payload += chunk;
+
+    PacketHeader packet = createHeader(MSG_FILE_CHUNK, "user-1", "", static_cast<uint32_t>(payload.size()));
+    std::vector<uint8_t> bytes = serializePacket(packet, payload.data(), payload.size());
+    return std::string(bytes.begin(), bytes.end());
+}
+
+size_t decodeChunkV1(std::string_view frame) {
+    PacketHeader header;
+    std::string_view payload;
+    FileChunkPayload chunk;
+    if (!parsePacket(frame, header, payload) || payload.size() < sizeof(chunk)) {
+        return 0;
+    }
+    std::memcpy(&chunk, payload.data(), sizeof(chunk));
+    return payload.substr(sizeof(chunk), chunk.chunkSize).size() + chunk.chunkIndex;  // Zero-copy view
+}
+
+void row(const char* name, size_t bytes, double decodeNs, double encodeNs) {
+    std::printf("  %-22s %8zu B   decode %10.0f ns   encode %10.0f ns\n", name, bytes, decodeNs, encodeNs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    std::string chatJson = encodeChatJson();
+    std::string chatV1 = encodeChatV1();
+    std::string chatV2 = encodeChatV2(0);
+    std::string chatV2Crc = encodeChatV2(FLAG_CHECKSUM);
+
+    for (const Decoded& decoded : {decodeChatJson(chatJson), decodeChatV1(chatV1),
+                                   decodeChatV2(chatV2), decodeChatV2(chatV2Crc)}) {
+        if (decoded.roomId != kRoomId || decoded.text != kText) {
+            std::fprintf(stderr, "chat decode mismatch\n");
+            return 1;
+        }
+    }
+
+    std::printf("chat, %zu B text, %zu iterations\n", kText.size(), iterations);
+    row("json", chatJson.size(),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(decodeChatJson(chatJson)); }),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(encodeChatJson()); }));
+    row("binary v1", chatV1.size(),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(decodeChatV1(chatV1)); }),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(encodeChatV1()); }));
+    row("binary v2", chatV2.size(),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(decodeChatV2(chatV2)); }),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(encodeChatV2(0)); }));
+    row("binary v2 + crc", chatV2Crc.size(),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(decodeChatV2(chatV2Crc)); }),
+        bench::nsPerCall(iterations, [&] { bench::doNotOptimize(encodeChatV2(FLAG_CHECKSUM)); }));
+
+    std::string chunk(64 * 1024, '\0');
+    uint32_t seed = 7;
+    for (auto& byte : chunk) {
+        seed = seed * 1103515245u + 12345u;
+        byte = static_cast<char>(seed >> 24);
+    }
+    std::string chunkJson = encodeChunkJson(chunk);
+    std::string chunkV1 = encodeChunkV1(chunk);
+    if (decodeChunkV1(chunkV1) != chunk.size() + 7) {
+        std::fprintf(stderr, "chunk decode mismatch\n");
+        return 1;
+    }
+
+    size_t chunkIterations = std::max<size_t>(1, iterations / 100);
+    std::printf("64 KB file chunk, %zu iterations\n", chunkIterations);
+    row("json (base64)", chunkJson.size(),
+        bench::nsPerCall(chunkIterations, [&] { bench::doNotOptimize(decodeChunkJson(chunkJson)); }),
+        bench::nsPerCall(chunkIterations, [&] { bench::doNotOptimize(encodeChunkJson(chunk)); }));
+    row("binary v1", chunkV1.size(),
+        bench::nsPerCall(chunkIterations, [&] { bench::doNotOptimize(decodeChunkV1(chunkV1)); }),
+        bench::nsPerCall(chunkIterations, [&] { bench::doNotOptimize(encodeChunkV1(chunk)); }));
+    return 0;
+}
@@ -0,0 +1,200 @@
+// permessage-deflate cost and ratio per outbound message type, for the two
+// WS_COMPRESSION modes, plus the CompressionPolicy decision with defaults.
+//
+// - shared:    a fresh raw deflate context (32 KB window) per message, as
+//              with uWS SHARED_COMPRESSOR (no context takeover)
+// - dedicated: one 4 KB-window context kept across a stream of messages
+//              of the same type (context takeover, WS_COMPRESSION_WINDOW_KB=4)
+//
+// zlib default level; each message ends with Z_SYNC_FLUSH and the 4-byte
+// 00 00 FF FF tail is dropped, as permessage-deflate does on the wire.
+//
+//   compression_bench [stream length]
+
+#include "websocket/compression_policy.h"
+#include "bench_util.h"
+
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+// Message i of a stream of one type (ids and text vary per message)
+using Generator = std::function<std::string(size_t)>;
+
+std::string roomJoined(size_t i) {
+    json history = json::array();
+    for (size_t m = 0; m < 50; m++) {
+        history.push_back({
+            {"messageId", "msg-" + std::to_string(1700000000000 + i * 100 + m)},
+            {"userId", "user-" + std::to_string(m % 7)},
+            {"username", "member" + std::to_string(m % 7)},
+            {"content", "Message " + std::to_string(m) + " about the release plan for sprint " + std::to_string(i % 12)},
+            {"timestamp", 1700000000000 + i * 100 + m},
+            {"replyToId", ""}
+        });
+    }
+    return json{
+        {"type", "room_joined"},
+        {"roomId", "room-" + std::to_string(i % 16)},
+        {"userId", "user-1"},
+        {"username", "member1"},
+        {"history", history},
+        {"memberCount", 12},
+        {"polls", json::array()}
+    }.dump();
+}
+
+std::string onlineUsers(size_t i) {
+    json users = json::array();
+    for (size_t u = 0; u < 200; u++) {
+        users.push_back({
+            {"userId", "user-" + std::to_string(u)},
+            {"username", "member" + std::to_string(u)},
+            {"status", (u + i) % 3 == 0 ? "away" : "online"},
+            {"avatarUrl", ""}
+        });
+    }
+    return json{{"count", users.size()}, {"type", "online_users"}, {"users", users}}.dump();
+}
+
+std::string chat(size_t i) {
+    return json{
+        {"content", "Sounds good, I'll push the fix for ticket " + std::to_string(4000 + i) + " after lunch"},
+        {"messageId", "msg-" + std::to_string(1700000000000 + i)},
+        {"metadata", nullptr},
+        {"roomId", "room-4f1c"},
+        {"timestamp", 1700000000000 + i},
+        {"type", "chat"},
+        {"userId", "user-" + std::to_string(i % 5)},
+        {"username", "member" + std::to_string(i % 5)}
+    }.dump();
+}
+
+std::string presenceUpdate(size_t i) {
+    return json{
+        {"type", "presence_update"},
+        {"userId", "user-" + std::to_string(i % 50)},
+        {"username", "member" + std::to_string(i % 50)},
+        {"status", i % 2 ? "online" : "away"}
+    }.dump();
+}
+
+std::string typing(size_t i) {
+    return json{
+        {"isTyping", i % 2 == 0},
+        {"type", "typing"},
+        {"userId", "user-" + std::to_string(i % 5)},
+        {"username", "member" + std::to_string(i % 5)}
+    }.dump();
+}
+
+std::string webrtcIce(size_t i) {
+    json signal = {
+        {"callId", "call-1700000000000"},
+        {"from", "user-3"},
+        {"candidate", "candidate:" + std::to_string(842163049 + i) +
+                      " 1 udp 1677729535 203.0.113." + std::to_string(i % 250) + " " +
+                      std::to_string(50000 + i % 1000) + " typ srflx raddr 0.0.0.0 rport 0 generation 0"}
+    };
+    return json{{"type", "webrtc_ice"}, {"data", signal.dump()}}.dump();
+}
+
+class Deflater {
+public:
+    explicit Deflater(int windowBits) {
+        stream_ = {};
+        deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -windowBits, 8, Z_DEFAULT_STRATEGY);
+    }
+    ~Deflater() { deflateEnd(&stream_); }
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    // Compressed size of one message (context carries over between calls)
+    size_t compress(const std::string& message) {
+        buffer_.resize(deflateBound(&stream_, message.size()) + 16);
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(message.data()));
+        stream_.avail_in = static_cast<uInt>(message.size());
+        stream_.next_out = buffer_.data();
+        stream_.avail_out = static_cast<uInt>(buffer_.size());
+        deflate(&stream_, Z_SYNC_FLUSH);
+        size_t written = buffer_.size() - stream_.avail_out;
+        return written >= 4 ? written - 4 : written;  // 00 00 FF FF
+    }
+
+private:
+    z_stream stream_;
+    std::vector<Bytef> buffer_;
+};
+
+struct Row {
+    const char* name;
+    Generator generate;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t streamLength = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+
+    CompressionSettings settings;
+    settings.mode = CompressionMode::SHARED;
+    settings.excludedTypes = CompressionPolicy::parseTypeList("webrtc_offer,webrtc_answer,webrtc_ice,typing,pong");
+    CompressionPolicy policy(settings);
+
+    const std::vector<Row> rows = {
+        {"room_joined (50 history)", roomJoined},
+        {"online_users (200 users)", onlineUsers},
+        {"chat", chat},
+        {"presence_update", presenceUpdate},
+        {"typing", typing},
+        {"webrtc_ice", webrtcIce},
+    };
+
+    std::printf("%zu messages per type; bytes and CPU per message\n\n", streamLength);
+    std::printf("%-26s %7s | %8s %8s | %8s %8s | %s\n",
+                "type", "raw B", "shared B", "us/msg", "ded4KB B", "us/msg", "policy (defaults)");
+
+    for (const auto& row : rows) {
+        std::vector<std::string> messages;
+        size_t rawBytes = 0;
+        for (size_t i = 0; i < streamLength; i++) {
+            messages.push_back(row.generate(i));
+            rawBytes += messages.back().size();
+        }
+
+        size_t sharedBytes = 0;
+        auto start = bench::Clock::now();
+        for (const auto& message : messages) {
+            Deflater fresh(15);
+            sharedBytes += fresh.compress(message);
+        }
+        std::chrono::duration<double, std::micro> sharedTime = bench::Clock::now() - start;
+
+        size_t dedicatedBytes = 0;
+        start = bench::Clock::now();
+        {
+            Deflater stream(12);
+            for (const auto& message : messages) {
+                dedicatedBytes += stream.compress(message);
+            }
+        }
+        std::chrono::duration<double, std::micro> dedicatedTime = bench::Clock::now() - start;
+
+        double n = static_cast<double>(streamLength);
+        std::printf("%-26s %7.0f | %8.0f %8.2f | %8.0f %8.2f | %s\n",
+                    row.name, rawBytes / n,
+                    sharedBytes / n, sharedTime.count() / n,
+                    dedicatedBytes / n, dedicatedTime.count() / n,
+                    policy.shouldCompress(messages.front()) ? "compress" : "plain");
+    }
+    return 0;
+}
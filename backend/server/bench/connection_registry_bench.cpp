@@ -0,0 +1,107 @@
+// ConnectionRegistry lookup cost against the number of live connections.
+//
+// Each lookup builds the userId string (as the server does from a socket's
+// data) and visits that user's connections. For reference, "map floor" is
+// one std::unordered_map<std::string, int> find over the same keys: the cost
+// of a single hashed string lookup with no registry at all.
+//
+//   connection_registry_bench [lookups]
+
+#include "websocket/connection_registry.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string userKey(size_t i) {
+    return "user-" + std::to_string(i);
+}
+
+std::string sessionKey(size_t i) {
+    return "session-" + std::to_string(i) + "-a1b2c3d4";
+}
+
+double nsPer(Clock::duration elapsed, size_t count) {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+}
+
+struct Result {
+    double user;
+    double session;
+    double floor;
+};
+
+Result run(size_t connections, size_t lookups) {
+    // One connection per user, plus a second device for every tenth user
+    size_t users = connections * 10 / 11;
+    std::vector<char> sockets(connections);  // Distinct wsPtr values
+
+    ConnectionRegistry registry;
+    std::unordered_map<std::string, int> floorMap;
+    for (size_t i = 0; i < connections; i++) {
+        void* wsPtr = &sockets[i];
+        size_t user = i < users ? i : (i - users) * 10;
+        registry.add(wsPtr, nullptr);
+        registry.authenticate(wsPtr, userKey(user), userKey(user), sessionKey(i));
+    }
+    for (size_t i = 0; i < users; i++) {
+        floorMap.emplace(userKey(i), static_cast<int>(i));
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<size_t> order(lookups);
+    for (auto& index : order) {
+        index = rng() % users;
+    }
+
+    size_t sink = 0;
+
+    auto start = Clock::now();
+    for (size_t index : order) {
+        sink += registry.forEachUserConnection(userKey(index), [&](const ConnectionState& state) {
+            sink += state.connectionId;
+        });
+    }
+    double user = nsPer(Clock::now() - start, lookups);
+
+    start = Clock::now();
+    for (size_t index : order) {
+        registry.withSession(sessionKey(index), [&](const ConnectionState& state) {
+            sink += state.connectionId;
+        });
+    }
+    double session = nsPer(Clock::now() - start, lookups);
+
+    start = Clock::now();
+    for (size_t index : order) {
+        auto it = floorMap.find(userKey(index));
+        sink += it != floorMap.end() ? static_cast<size_t>(it->second) : 0;
+    }
+    double floor = nsPer(Clock::now() - start, lookups);
+
+    if (sink == 42) {
+        std::printf("\n");  // Keep the loops observable
+    }
+    return Result{user, session, floor};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t lookups = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::printf("%12s %14s %14s %14s\n", "connections", "user ns", "session ns", "map floor ns");
+    for (size_t connections : {1000, 10000, 50000, 200000, 1000000}) {
+        Result result = run(connections, lookups);
+        std::printf("%12zu %14.1f %14.1f %14.1f\n", connections, result.user, result.session, result.floor);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Inbound JSON: InboundMessage (simdjson on-demand) against a full
+// nlohmann document, per message type. Each iteration parses the frame,
+// reads "type" and reads the fields the server's handler uses.
+//
+// Cold types (not handled by handleInbound) pay type() + toJson() on the
+// on-demand side, as in the server.
+//
+//   inbound_message_bench [iterations]
+
+#include "websocket/inbound_message.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+enum class Kind { STRING, BOOL, DOUBLE, OBJECT };
+
+struct Field {
+    const char* key;
+    Kind kind;
+};
+
+struct Sample {
+    const char* name;
+    std::string frame;
+    std::vector<Field> fields;
+    bool cold = false;
+};
+
+size_t readNlohmann(std::string_view frame, const Sample& sample) {
+    json msg = json::parse(frame);
+    size_t total = msg.value("type", "").size();
+    for (const auto& field : sample.fields) {
+        switch (field.kind) {
+            case Kind::STRING: total += msg.value(field.key, "").size(); break;
+            case Kind::BOOL:   total += msg.value(field.key, false); break;
+            case Kind::DOUBLE: total += static_cast<size_t>(msg.value(field.key, 0.0)); break;
+            case Kind::OBJECT: total += msg.contains(field.key) && msg[field.key].is_object(); break;
+        }
+    }
+    return total;
+}
+
+size_t readOnDemand(InboundMessage& msg, std::string_view frame, const Sample& sample) {
+    if (!msg.parse(frame)) {
+        return 0;
+    }
+    size_t total = msg.type().size();
+    if (sample.cold) {
+        json document = msg.toJson();
+        for (const auto& field : sample.fields) {
+            total += document.value(field.key, "").size();
+        }
+        return total;
+    }
+    for (const auto& field : sample.fields) {
+        switch (field.kind) {
+            case Kind::STRING: total += msg.getString(field.key).size(); break;
+            case Kind::BOOL:   total += msg.getBool(field.key, false); break;
+            case Kind::DOUBLE: total += static_cast<size_t>(msg.getDouble(field.key, 0.0)); break;
+            case Kind::OBJECT: total += !msg.getRawObject(field.key).empty(); break;
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    const std::vector<Sample> samples = {
+        {"chat",
+         R"({"type":"chat","roomId":"room-4f1c","content":"See you at the standup in five minutes","replyToId":"","metadata":{"fileId":"f-1","fileName":"notes.pdf"}})",
+         {{"roomId", Kind::STRING}, {"metadata", Kind::OBJECT}, {"content", Kind::STRING}}},
+        {"typing", R"({"type":"typing","roomId":"room-4f1c","isTyping":true})", {{"isTyping", Kind::BOOL}}},
+        {"ping", R"({"type":"ping","timestamp":1700000000000})", {}},
+        {"mark_read", R"({"type":"mark_read","messageId":"msg-1700000000000-42","roomId":"room-4f1c"})",
+         {{"roomId", Kind::STRING}, {"messageId", Kind::STRING}}},
+        {"add_reaction",
+         R"({"type":"add_reaction","messageId":"msg-1700000000000-42","emoji":"👍","roomId":"room-4f1c"})",
+         {{"messageId", Kind::STRING}, {"emoji", Kind::STRING}, {"roomId", Kind::STRING}}},
+        {"presence_update", R"({"type":"presence_update","status":"away"})", {{"status", Kind::STRING}}},
+        {"webrtc_ice",
+         R"({"type":"webrtc_ice","callId":"call-1700000000000","targetId":"user-7","candidate":"candidate:842163049 1 udp 1677729535 203.0.113.7 50123 typ srflx raddr 0.0.0.0 rport 0 generation 0 ufrag 4ZcD network-cost 999"})",
+         {{"callId", Kind::STRING}, {"targetId", Kind::STRING}, {"candidate", Kind::STRING}}},
+        {"watch_sync", R"({"type":"watch_sync","action":"seek","time":1234.5})",
+         {{"action", Kind::STRING}, {"time", Kind::DOUBLE}}},
+        {"get_online_users", R"({"type":"get_online_users"})", {}, true},
+        {"join_room", R"({"type":"join_room","roomId":"room-4f1c","password":""})", {{"roomId", Kind::STRING}}, true},
+    };
+
+    InboundMessage reader;
+    std::printf("%zu iterations per type\n", iterations);
+    std::printf("  %-18s %10s %10s %8s\n", "type", "nlohmann", "on-demand", "speedup");
+    for (const auto& sample : samples) {
+        std::string_view frame = sample.frame;
+        if (readNlohmann(frame, sample) != readOnDemand(reader, frame, sample)) {
+            std::fprintf(stderr, "readers disagree for %s\n", sample.name);
+            return 1;
+        }
+        double nlohmannNs = bench::nsPerCall(iterations, [&] {
+            bench::doNotOptimize(readNlohmann(frame, sample));
+        });
+        double onDemandNs = bench::nsPerCall(iterations, [&] {
+            bench::doNotOptimize(readOnDemand(reader, frame, sample));
+        });
+        std::printf("  %-18s %7.0f ns %7.0f ns %7.1fx%s\n", sample.name, nlohmannNs, onDemandNs,
+                    nlohmannNs / onDemandNs, sample.cold ? " (cold: type + toJson)" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Outbound JSON: typed messages through json_writer against building the
+// same nlohmann::json object and calling dump(), as the server did before.
+// Output equality is covered by tests/json_writer_test.
+//
+//   json_writer_bench [iterations]
+
+#include "websocket/protocol_messages.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+const std::string kContent = "Sounds good, I'll push the fix after lunch. Ping me if CI breaks!";
+
+std::string chatJson() {
+    json response = {
+        {"type", "chat"},
+        {"userId", "user-1"},
+        {"username", "alice"},
+        {"content", kContent},
+        {"roomId", "room-4f1c"},
+        {"messageId", "msg-1700000000000-42"},
+        {"timestamp", int64_t{1700000000000}}
+    };
+    return response.dump();
+}
+
+std::string chatWriter() {
+    ChatMessage message;
+    message.content = kContent;
+    message.messageId = "msg-1700000000000-42";
+    message.roomId = "room-4f1c";
+    message.timestamp = 1700000000000;
+    message.userId = "user-1";
+    message.username = "alice";
+    return json_writer::toString(message);
+}
+
+std::string typingJson() {
+    return json{{"type", "typing"}, {"userId", "user-1"}, {"username", "alice"}, {"isTyping", true}}.dump();
+}
+
+std::string typingWriter() {
+    TypingMessage message;
+    message.isTyping = true;
+    message.userId = "user-1";
+    message.username = "alice";
+    return json_writer::toString(message);
+}
+
+std::string reactionJson() {
+    return json{{"type", "reaction_added"}, {"messageId", "msg-1700000000000-42"}, {"emoji", "\xF0\x9F\x91\x8D"},
+                {"userId", "user-2"}, {"username", "bob"}, {"roomId", "room-4f1c"}}.dump();
+}
+
+std::string reactionWriter() {
+    ReactionAddedMessage message;
+    message.emoji = "\xF0\x9F\x91\x8D";
+    message.messageId = "msg-1700000000000-42";
+    message.roomId = "room-4f1c";
+    message.userId = "user-2";
+    message.username = "bob";
+    return json_writer::toString(message);
+}
+
+std::string readJson() {
+    return json{{"type", "message_read"}, {"messageId", "msg-1700000000000-42"}, {"readBy", "user-2"},
+                {"username", "bob"}, {"roomId", "room-4f1c"}, {"timestamp", int64_t{1700000000000}}}.dump();
+}
+
+std::string readWriter() {
+    MessageReadMessage message;
+    message.messageId = "msg-1700000000000-42";
+    message.readBy = "user-2";
+    message.roomId = "room-4f1c";
+    message.timestamp = 1700000000000;
+    message.username = "bob";
+    return json_writer::toString(message);
+}
+
+struct PresenceChange {
+    std::string userId;
+    std::string username;
+    std::string status;
+};
+
+std::vector<PresenceChange> presenceChanges() {
+    std::vector<PresenceChange> changes;
+    for (int i = 0; i < 20; i++) {
+        changes.push_back({"user-" + std::to_string(i), "member" + std::to_string(i), i % 3 ? "online" : "away"});
+    }
+    return changes;
+}
+
+std::string presenceJson(const std::vector<PresenceChange>& changes) {
+    json users = json::array();
+    for (const auto& change : changes) {
+        users.push_back({{"userId", change.userId}, {"username", change.username}, {"status", change.status}});
+    }
+    return json{{"type", "presence_batch"}, {"users", users}}.dump();
+}
+
+std::string presenceWriter(const std::vector<PresenceChange>& changes) {
+    PresenceBatchMessage message;
+    message.users.reserve(changes.size());
+    for (const auto& change : changes) {
+        message.users.push_back(PresenceEntry{change.status, change.userId, change.username});
+    }
+    return json_writer::toString(message);
+}
+
+template <typename Old, typename New>
+bool row(const char* name, size_t iterations, Old&& oldFn, New&& newFn) {
+    if (oldFn() != newFn()) {
+        std::fprintf(stderr, "output differs for %s\n", name);
+        return false;
+    }
+    double oldNs = bench::nsPerCall(iterations, [&] { bench::doNotOptimize(oldFn()); });
+    double newNs = bench::nsPerCall(iterations, [&] { bench::doNotOptimize(newFn()); });
+    std::printf("  %-20s %10.0f ns %10.0f ns %7.1fx\n", name, oldNs, newNs, oldNs / newNs);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    auto changes = presenceChanges();
+
+    std::printf("%zu iterations per message\n", iterations);
+    std::printf("  %-20s %13s %13s\n", "message", "json{}.dump()", "writer");
+    bool ok = row("chat", iterations, chatJson, chatWriter) &&
+              row("typing", iterations, typingJson, typingWriter) &&
+              row("reaction_added", iterations, reactionJson, reactionWriter) &&
+              row("message_read", iterations, readJson, readWriter) &&
+              row("presence_batch x20", iterations / 10,
+                  [&] { return presenceJson(changes); }, [&] { return presenceWriter(changes); });
+    return ok ? 0 : 1;
+}
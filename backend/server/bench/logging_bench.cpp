@@ -0,0 +1,97 @@
+// Cost of filtered log statements on the chat path: the 17 per-message
+// statements (dispatch, handleChatMessage, MySQLClient::createMessage,
+// broadcastToRoom/sendToUser) replayed in their old string-concatenating
+// Logger::info() form and as LOG_*_F macros, with the runtime level at
+// WARNING so every statement is filtered.
+//
+// Built twice (see CMakeLists.txt): logging_bench with LOG_MIN_LEVEL=0
+// (runtime check only) and logging_bench_release with LOG_MIN_LEVEL=2
+// (DEBUG/INFO statements compiled out).
+//
+//   logging_bench [iterations]
+
+#include "utils/logger.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+struct ChatContext {
+    std::string type = "chat";
+    std::string username = "alice";
+    std::string userId = "user-1";
+    std::string roomId = "room-4f1c";
+    std::string content = "Sounds good, I'll push the fix after lunch. Ping me if CI breaks!";
+    std::string messageId = "msg-1700000000000-42";
+    std::string messageType = "text";
+    std::string replyToId;
+    size_t devices = 2;
+    int count = 1;
+};
+
+void concatenated(const ChatContext& c) {
+    Logger::info("📨 Message type: " + c.type);
+    Logger::info("💬 Chat from " + c.username + " in room '" + c.roomId + "': " + c.content);
+    Logger::info("🔍 Preparing to save message to database...");
+    Logger::info("📦 DM conversation roomId for storage: " + c.roomId);
+    Logger::info("🔍 Calling authManager_->getDatabase()->createMessage()...");
+    Logger::info("📝 START createMessage");
+    Logger::info("  Attempting to save message: " + c.messageId);
+    Logger::info("  Room: " + c.roomId + ", Sender: " + c.username + " (" + c.userId + ")");
+    Logger::info("  Content: " + c.content);
+    Logger::info("  MessageType: " + c.messageType + ", ReplyTo: " + c.replyToId);
+    Logger::info("✓ Message SQL executed successfully");
+    Logger::info("✓✓ Message VERIFIED in database (count=" + std::to_string(c.count) + ")");
+    Logger::info("💾 Message saved to database");
+    Logger::info("📢 Broadcast to room '" + c.roomId + "'");
+    Logger::info("📤 Message sent to user: " + c.userId + " (" + std::to_string(c.devices) + " connections)");
+    Logger::debug("🧾 Response for " + c.messageId + ": " + c.content);
+    Logger::debug("Dropped message for slow consumer " + c.userId + " (" + std::to_string(c.count) + " bytes queued)");
+}
+
+void lazy(const ChatContext& c) {
+    LOG_INFO_F("📨 Message type: {}", c.type);
+    LOG_INFO_F("💬 Chat from {} in room '{}': {}", c.username, c.roomId, c.content);
+    LOG_INFO_F("🔍 Preparing to save message to database...");
+    LOG_INFO_F("📦 DM conversation roomId for storage: {}", c.roomId);
+    LOG_INFO_F("🔍 Calling authManager_->getDatabase()->createMessage()...");
+    LOG_INFO_F("📝 START createMessage");
+    LOG_INFO_F("  Attempting to save message: {}", c.messageId);
+    LOG_INFO_F("  Room: {}, Sender: {} ({})", c.roomId, c.username, c.userId);
+    LOG_INFO_F("  Content: {}", c.content);
+    LOG_INFO_F("  MessageType: {}, ReplyTo: {}", c.messageType, c.replyToId);
+    LOG_INFO_F("✓ Message SQL executed successfully");
+    LOG_INFO_F("✓✓ Message VERIFIED in database (count={})", c.count);
+    LOG_INFO_F("💾 Message saved to database");
+    LOG_INFO_F("📢 Broadcast to room '{}'", c.roomId);
+    LOG_INFO_F("📤 Message sent to user: {} ({} connections)", c.userId, c.devices);
+    LOG_DEBUG_F("🧾 Response for {}: {}", c.messageId, c.content);
+    LOG_DEBUG_F("Dropped message for slow consumer {} ({} bytes queued)", c.userId, c.count);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Logger::setLevel(LogLevel::Warning);
+
+    ChatContext context;
+    double oldNs = bench::nsPerCall(iterations, [&] {
+        bench::doNotOptimize(context);
+        concatenated(context);
+    });
+    double newNs = bench::nsPerCall(iterations, [&] {
+        bench::doNotOptimize(context);
+        lazy(context);
+    });
+
+    std::printf("LOG_MIN_LEVEL=%d, runtime level WARNING, 17 statements per chat message, %zu iterations\n",
+                LOG_MIN_LEVEL, iterations);
+    std::printf("  Logger::info(a + b)   %8.1f ns/msg\n", oldNs);
+    std::printf("  LOG_*_F               %8.1f ns/msg\n", newNs);
+    Logger::flush();
+    return 0;
+}
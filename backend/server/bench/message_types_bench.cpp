@@ -0,0 +1,79 @@
+// Message type dispatch: the compile-time perfect hash (lookupMessageType)
+// against the string if/else chain it replaced, for every known type and
+// one unknown type.
+//
+// The chain is reproduced as sequential std::string == literal compares in
+// kMessageTypes order, which is the order of the old .message handler.
+//
+//   message_types_bench [iterations]
+
+#include "websocket/message_types.h"
+#include "bench_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+MessageKind ifChain(const std::string& type) {
+    for (const auto& entry : kMessageTypes) {
+        if (type == entry.name.data()) {  // Names are string literals
+            return entry.kind;
+        }
+    }
+    return MessageKind::UNKNOWN;
+}
+
+struct Stats {
+    double total = 0;
+    double worst = 0;
+    std::string worstType;
+
+    void add(const std::string& type, double ns) {
+        total += ns;
+        if (ns > worst) {
+            worst = ns;
+            worstType = type;
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    // Runtime strings, as read from a frame
+    std::vector<std::string> types;
+    for (const auto& entry : kMessageTypes) {
+        types.emplace_back(entry.name);
+    }
+    types.emplace_back("not_a_type");
+
+    Stats chain, hash;
+    for (const auto& type : types) {
+        if (ifChain(type) != lookupMessageType(type).kind) {
+            std::fprintf(stderr, "mismatch for %s\n", type.c_str());
+            return 1;
+        }
+        chain.add(type, bench::nsPerCall(iterations, [&] {
+            bench::doNotOptimize(type);
+            bench::doNotOptimize(ifChain(type));
+        }));
+        hash.add(type, bench::nsPerCall(iterations, [&] {
+            bench::doNotOptimize(type);
+            bench::doNotOptimize(lookupMessageType(type).kind);
+        }));
+    }
+
+    double count = static_cast<double>(types.size());
+    std::printf("%zu types + 1 unknown, %zu iterations each\n", types.size() - 1, iterations);
+    std::printf("  if-chain:     avg %6.1f ns, worst %6.1f ns (%s)\n",
+                chain.total / count, chain.worst, chain.worstType.c_str());
+    std::printf("  perfect hash: avg %6.1f ns, worst %6.1f ns (%s)\n",
+                hash.total / count, hash.worst, hash.worstType.c_str());
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Inbound JSON: parsing each frame once (json::parse on the frame's
+// string_view, handlers take const json&) against the old path, which
+// copied the frame into a std::string, parsed it for "type", then parsed
+// it again in the *Json handler.
+//
+// Counts heap allocations (global operator new) and time for the parse
+// and the handler's field reads; handler bodies are not included.
+//
+//   parse_once_bench [iterations]
+
+#include "bench_util.h"
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using json = nlohmann::json;
+
+struct Sample {
+    const char* name;
+    std::string frame;
+    std::vector<const char*> fields;  // Read by the handler with value()
+};
+
+// Handler entry: read the type and each field as a string
+size_t readFields(const json& msg, const Sample& sample) {
+    size_t total = msg.value("type", "").size();
+    for (const char* field : sample.fields) {
+        total += msg.value(field, "").size();
+    }
+    return total;
+}
+
+size_t oldPath(std::string_view frame, const Sample& sample) {
+    std::string copy(frame);
+    json dispatch = json::parse(copy);
+    std::string type = dispatch.value("type", "");
+    bench::doNotOptimize(type);
+    json msg = json::parse(copy);  // Again, inside handle*Json(ws, message)
+    return readFields(msg, sample);
+}
+
+size_t newPath(std::string_view frame, const Sample& sample) {
+    json msg = json::parse(frame);
+    return readFields(msg, sample);
+}
+
+template <typename Fn>
+size_t countAllocations(Fn&& fn) {
+    size_t before = allocations.load(std::memory_order_relaxed);
+    fn();
+    return allocations.load(std::memory_order_relaxed) - before;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    const std::vector<Sample> samples = {
+        {"chat",
+         R"({"type":"chat","roomId":"room-4f1c","content":"See you at the standup in five minutes","replyToId":""})",
+         {"roomId", "content", "replyToId"}},
+        {"join_room", R"({"type":"join_room","roomId":"room-4f1c","password":""})", {"roomId"}},
+        {"typing", R"({"type":"typing","roomId":"room-4f1c","isTyping":true})", {"roomId"}},
+        {"edit_message",
+         R"({"type":"edit_message","messageId":"msg-1700000000000-42","newContent":"fixed typo","roomId":"room-4f1c"})",
+         {"messageId", "newContent", "roomId"}},
+        {"mark_read",
+         R"({"type":"mark_read","messageId":"msg-1700000000000-42","roomId":"room-4f1c"})",
+         {"messageId", "roomId"}},
+    };
+
+    std::printf("%-14s %12s %12s %12s %12s\n", "type", "allocs old", "allocs new", "ns old", "ns new");
+    for (const auto& sample : samples) {
+        std::string_view frame = sample.frame;
+        if (oldPath(frame, sample) != newPath(frame, sample)) {
+            std::fprintf(stderr, "paths disagree for %s\n", sample.name);
+            return 1;
+        }
+        size_t oldAllocs = countAllocations([&] { bench::doNotOptimize(oldPath(frame, sample)); });
+        size_t newAllocs = countAllocations([&] { bench::doNotOptimize(newPath(frame, sample)); });
+        double oldNs = bench::nsPerCall(iterations, [&] { bench::doNotOptimize(oldPath(frame, sample)); });
+        double newNs = bench::nsPerCall(iterations, [&] { bench::doNotOptimize(newPath(frame, sample)); });
+        std::printf("%-14s %12zu %12zu %12.0f %12.0f\n", sample.name, oldAllocs, newAllocs, oldNs, newNs);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+// PerformanceMonitor hot-path costs: Histogram::record, Counter::add, a
+// Timer (two steady_clock reads + record) and one /metrics scrape with
+// the server's metric count (51 types x 2 exec histograms, ~20 DB ops).
+// Merge correctness is covered by tests/performance_monitor_test.
+//
+//   performance_monitor_bench [iterations]
+
+#include "utils/logging.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using chatbox::logging::PerformanceMonitor;
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    for (int type = 0; type < 51; type++) {
+        for (const char* exec : {"loop", "db"}) {
+            auto& histogram = PerformanceMonitor::histogram(
+                "chatbox_handler_seconds", "type=\"t" + std::to_string(type) + "\",exec=\"" + exec + "\"");
+            histogram.record(1000 + type);
+        }
+    }
+    for (int op = 0; op < 20; op++) {
+        PerformanceMonitor::histogram("chatbox_db_call_seconds", "op=\"op" + std::to_string(op) + "\"").record(50000);
+    }
+
+    auto& histogram = PerformanceMonitor::histogram("bench_seconds");
+    auto& counter = PerformanceMonitor::counter("bench_total");
+
+    uint64_t value = 1;
+    double recordNs = bench::nsPerCall(iterations, [&] {
+        histogram.record(value);
+        value = (value * 6364136223846793005u + 1442695040888963407u) >> 40;  // Spread over buckets
+    });
+    double addNs = bench::nsPerCall(iterations, [&] { counter.add(); });
+    double timerNs = bench::nsPerCall(iterations / 10, [&] {
+        PerformanceMonitor::Timer timer(&histogram);
+    });
+    double clockNs = bench::nsPerCall(iterations / 10, [&] {
+        bench::doNotOptimize(std::chrono::steady_clock::now());
+    });
+
+    size_t scrapeBytes = 0;
+    double scrapeNs = bench::nsPerCall(200, [&] { scrapeBytes = PerformanceMonitor::getMetrics().size(); });
+
+    std::printf("  Histogram::record   %8.1f ns\n", recordNs);
+    std::printf("  Counter::add        %8.1f ns\n", addNs);
+    std::printf("  Timer               %8.1f ns (steady_clock::now %.1f ns)\n", timerNs, clockNs);
+    std::printf("  Scrape              %8.1f us (%zu bytes)\n", scrapeNs / 1000.0, scrapeBytes);
+    return 0;
+}
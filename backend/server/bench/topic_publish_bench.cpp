@@ -0,0 +1,233 @@
+// Room fan-out: one App::publish() to a topic with N subscribers against
+// the per-socket ws->send() loop it replaced, on a real uWS event loop.
+//
+// N loopback clients (raw sockets drained by the main thread) subscribe
+// to one topic; the loop thread then sends K chat-sized messages to all
+// of them either way, uncompressed. Reported per message: CPU time of the event loop thread and
+// wall time until every byte has reached the clients. Linux only; needs
+// the server's uWS/uSockets (built with CHATBOX_BUILD_SERVER).
+//
+//   topic_publish_bench [port]
+//   (needs `ulimit -n` above 2x the largest subscriber count)
+
+#include "bench_util.h"
+
+#include <App.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view kTopic = "room:bench";
+
+struct SocketData {};
+using WebSocket = uWS::WebSocket<false, true, SocketData>;
+
+double threadCpuNs(pthread_t thread) {
+    clockid_t clock;
+    timespec ts{};
+    if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Server frame size of an unmasked TEXT message
+size_t frameSize(size_t payload) {
+    return payload + (payload < 126 ? 2 : payload < 65536 ? 4 : 10);
+}
+
+// Connects and completes the WebSocket upgrade; reads after that use MSG_DONTWAIT
+int connectClient(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    static const std::string request =
+        "GET / HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (::send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) {
+        std::perror("send");
+        std::exit(1);
+    }
+    std::string response;
+    char byte;
+    while (response.size() < 4 || response.compare(response.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (::recv(fd, &byte, 1, 0) != 1) {
+            std::fprintf(stderr, "handshake failed\n");
+            std::exit(1);
+        }
+        response.push_back(byte);
+    }
+    return fd;
+}
+
+// Reads from every client until `expected` bytes have arrived in total
+void drain(const std::vector<int>& fds, size_t expected) {
+    std::vector<pollfd> polls;
+    for (int fd : fds) {
+        polls.push_back(pollfd{fd, POLLIN, 0});
+    }
+    std::vector<char> buffer(256 * 1024);
+    size_t received = 0;
+    while (received < expected) {
+        if (::poll(polls.data(), polls.size(), 1000) <= 0) {
+            continue;
+        }
+        for (auto& p : polls) {
+            if (p.revents & POLLIN) {
+                ssize_t n = ::recv(p.fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+                if (n > 0) {
+                    received += static_cast<size_t>(n);
+                }
+            }
+        }
+    }
+}
+
+struct Server {
+    uWS::App* app = nullptr;
+    uWS::Loop* loop = nullptr;
+    us_listen_socket_t* listenSocket = nullptr;
+    std::vector<WebSocket*> sockets;  // Loop thread only
+    std::atomic<size_t> open{0};
+    std::atomic<bool> ready{false};
+};
+
+void runServer(Server& server, int port) {
+    uWS::App app;
+    app.ws<SocketData>("/*", {
+        .compression = uWS::DISABLED,
+        .maxPayloadLength = 16 * 1024,
+        .idleTimeout = 0,
+        .maxBackpressure = 256 * 1024 * 1024,
+        .closeOnBackpressureLimit = false,
+        .open = [&server](auto* ws) {
+            ws->subscribe(kTopic);
+            server.sockets.push_back(ws);
+            server.open++;
+        },
+        .close = [&server](auto* ws, int, std::string_view) {
+            std::erase(server.sockets, ws);
+            server.open--;
+        },
+    });
+    app.listen(port, [&server](auto* listenSocket) {
+        server.listenSocket = listenSocket;
+    });
+    if (!server.listenSocket) {
+        std::fprintf(stderr, "cannot listen on port %d\n", port);
+        std::exit(1);
+    }
+    server.app = &app;
+    server.loop = uWS::Loop::get();
+    server.ready = true;
+    app.run();
+}
+
+struct Result {
+    double cpuNs;   // Event loop thread CPU per message
+    double wallNs;  // Until every client has every byte, per message
+};
+
+Result measure(Server& server, pthread_t serverThread, const std::vector<int>& clients,
+               const std::string& message, size_t messages, bool publish) {
+    size_t expected = clients.size() * messages * frameSize(message.size());
+    std::atomic<bool> sent{false};
+
+    double cpuBefore = threadCpuNs(serverThread);
+    auto start = bench::Clock::now();
+    server.loop->defer([&server, &message, &sent, messages, publish]() {
+        for (size_t i = 0; i < messages; i++) {
+            if (publish) {
+                server.app->publish(kTopic, message, uWS::OpCode::TEXT, false);
+            } else {
+                for (WebSocket* ws : server.sockets) {  // The old broadcastToRoom loop
+                    ws->send(message, uWS::OpCode::TEXT, false);
+                }
+            }
+        }
+        sent = true;
+    });
+    drain(clients, expected);
+    std::chrono::duration<double, std::nano> wall = bench::Clock::now() - start;
+    while (!sent) {
+        std::this_thread::yield();
+    }
+    double cpu = threadCpuNs(serverThread) - cpuBefore;
+    return Result{cpu / messages, wall.count() / messages};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? std::atoi(argv[1]) : 9901;
+    const std::string message =
+        R"({"content":"Sounds good, I'll push the fix after lunch. Ping me if CI breaks!",)"
+        R"("messageId":"msg-1700000000000-42","roomId":"room-4f1c","timestamp":1700000000000,)"
+        R"("type":"chat","userId":"user-1","username":"alice"})";
+
+    Server server;
+    std::thread serverThread(runServer, std::ref(server), port);
+    while (!server.ready) {
+        std::this_thread::yield();
+    }
+
+    std::printf("%zu B messages; per message: loop thread CPU / wall until delivered\n", message.size());
+    std::printf("%12s %8s | %12s %12s | %12s %12s | %7s\n", "subscribers", "messages",
+                "send cpu", "send wall", "publish cpu", "publish wall", "cpu x");
+
+    std::vector<int> clients;
+    for (size_t subscribers : {10, 100, 1000}) {
+        while (clients.size() < subscribers) {
+            clients.push_back(connectClient(port));
+        }
+        while (server.open.load() < subscribers) {
+            std::this_thread::yield();
+        }
+        size_t messages = std::max<size_t>(50, 200000 / subscribers);
+
+        // Warm-up, then alternate so both modes see the same socket state
+        measure(server, serverThread.native_handle(), clients, message, 10, true);
+        Result send = measure(server, serverThread.native_handle(), clients, message, messages, false);
+        Result publish = measure(server, serverThread.native_handle(), clients, message, messages, true);
+
+        std::printf("%12zu %8zu | %9.1f us %9.1f us | %9.1f us %9.1f us | %6.1fx\n",
+                    subscribers, messages, send.cpuNs / 1000, send.wallNs / 1000,
+                    publish.cpuNs / 1000, publish.wallNs / 1000, send.cpuNs / publish.cpuNs);
+    }
+
+    for (int fd : clients) {
+        ::close(fd);
+    }
+    server.loop->defer([&server]() {
+        us_listen_socket_close(0, server.listenSocket);
+    });
+    serverThread.join();
+    return 0;
+}
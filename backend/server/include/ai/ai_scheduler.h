@@ -0,0 +1,99 @@
+#ifndef AI_SCHEDULER_H
+#define AI_SCHEDULER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class GeminiClient;
+
+/**
+ * AI Request Scheduler
+ *
+ * Fixed pool of worker threads for Gemini calls (seconds each), separate
+ * from the event loops and the DB executor so AI traffic never delays
+ * chat. Requests are admitted only while the queue has room and the user
+ * is under their in-flight limit; the rest are refused immediately.
+ *
+ * Completions run on an AI worker: the caller posts socket work back to
+ * the owning loop.
+ *
+ * Thread-safe.
+ */
+class AiScheduler {
+public:
+    struct Limits {
+        size_t workers = 2;
+        size_t maxQueue = 64;        // Admitted, not started yet
+        size_t perUserInFlight = 2;  // Queued + running per user
+    };
+
+    enum class Admission {
+        ACCEPTED,
+        QUEUE_FULL,
+        USER_LIMIT,
+        UNAVAILABLE  // Stopped
+    };
+
+    struct Stats {
+        size_t workers = 0;
+        size_t queueDepth = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;       // No response from Gemini
+        uint64_t rejected = 0;     // QUEUE_FULL + USER_LIMIT
+        double avgRunMs = 0;
+    };
+
+    // Receives the response, or nullopt if the call failed
+    using Completion = std::function<void(std::optional<std::string>)>;
+
+    AiScheduler(std::shared_ptr<GeminiClient> client, const Limits& limits);
+    ~AiScheduler();
+
+    Admission submit(const std::string& userId, std::string prompt, Completion done);
+
+    Stats stats() const;
+
+    /**
+     * Drop queued requests and join the workers (running calls finish)
+     */
+    void stop();
+
+    // Client-facing reason for a refused request
+    static const char* describe(Admission admission);
+
+private:
+    struct Request {
+        std::string userId;
+        std::string prompt;
+        Completion done;
+    };
+
+    std::shared_ptr<GeminiClient> client_;
+    Limits limits_;
+    std::vector<std::thread> workers_;
+    std::deque<Request> queue_;
+    std::unordered_map<std::string, size_t> inFlight_;  // userId -> queued + running
+    bool stopping_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // Metrics (under mutex_)
+    uint64_t completed_ = 0;
+    uint64_t failed_ = 0;
+    uint64_t rejected_ = 0;
+    double totalRunMs_ = 0;
+
+    void workerLoop();
+    void releaseLocked(const std::string& userId);
+};
+
+#endif // AI_SCHEDULER_H
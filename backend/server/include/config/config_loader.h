@@ -22,6 +22,45 @@ struct Config {
     std::string serverIP;
     int serverPort;
     std::string serverHost;
+    int serverThreads;  // Event loops (0 = one per core)
+    
+    // WebSocket permessage-deflate
+    std::string wsCompression;        // off | shared | dedicated
+    int wsCompressionWindowKb;        // dedicated sliding window size
+    int wsCompressionThreshold;       // bytes, smaller frames stay uncompressed
+    std::string wsCompressionExclude; // comma separated message types
+    
+    // Per-connection output limits (KB) and slow consumer cut-off
+    int wsSendLowWatermarkKb;
+    int wsSendHighWatermarkKb;
+    int wsSendHardLimitKb;
+    int wsSlowConsumerTimeout;  // seconds above the hard limit
+    int wsPresenceWindowMs;     // presence batching window
+    int wsCorkDeadlineUs;       // max wait of a corked frame (0 = no corking)
+    
+    // Inbound rate limits (tokens per second / burst; 0 rate = off)
+    int wsRateConnection;
+    int wsRateConnectionBurst;
+    int wsRateUser;
+    int wsRateUserBurst;
+    int wsRateStrikes;  // rejected messages tolerated before disconnecting
+    
+    // Reconnect storms: auth/login pacing and shared bootstrap data
+    int authAdmissionRate;       // auth/login per second (0 = unpaced)
+    int authAdmissionMaxWaitMs;  // longest queued wait before "retry after"
+    int bootstrapDirectoryRefreshS;
+    int bootstrapRenderMs;
+    
+    // Chat latency tracing
+    int traceSampleEvery;  // 1 in N chat messages (0 = off)
+    int traceSlowMs;       // log the breakdown above this
+    
+    // Event loop stall watchdog (0 = off)
+    int loopStallMs;
+    
+    // Database executor
+    int dbWorkers;
+    int dbQueueLimit;
     
     // JWT Configuration
     std::string jwtSecret;
@@ -29,6 +68,9 @@ struct Config {
     
     // Gemini AI
     std::string geminiApiKey;
+    int aiWorkers;
+    int aiQueueLimit;
+    int aiMaxInFlightPerUser;
     
     // Debug
     bool debug;
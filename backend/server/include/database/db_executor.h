@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Database Executor
+ *
+ * Bounded worker pool that runs blocking MySQLClient work off the event
+ * loops. Each worker thread owns its MySQL session (MySQLClient::getSession
+ * is per thread). Completions that touch sockets are posted back to the
+ * owning loop by the caller (Loop::defer).
+ *
+ * Tasks submitted with the same non-zero key (a connection ID) run one at
+ * a time in submit order, so one client's requests are never reordered.
+ *
+ * Thread-safe.
+ */
+class DbExecutor {
+public:
+    struct Stats {
+        size_t workers = 0;
+        size_t queueDepth = 0;     // Submitted, not started yet
+        size_t maxQueueDepth = 0;  // High-water mark
+        uint64_t completed = 0;
+        uint64_t rejected = 0;     // Queue full
+        double avgWaitMs = 0;      // Submit -> start
+        double maxWaitMs = 0;
+        double avgRunMs = 0;
+    };
+
+    DbExecutor(size_t workerCount, size_t maxQueueDepth);
+    ~DbExecutor();
+
+    /**
+     * Queue work for a worker thread
+     * @param key Serialization key (0 = none)
+     * @return false if the queue is full (task not queued)
+     */
+    bool submit(uint64_t key, std::function<void()> task);
+
+    Stats stats() const;
+
+    /**
+     * Finish queued work and join the workers
+     */
+    void stop();
+
+private:
+    struct Task {
+        uint64_t key = 0;
+        std::function<void()> run;
+        std::chrono::steady_clock::time_point submittedAt;
+    };
+
+    std::vector<std::thread> workers_;
+    std::deque<Task> ready_;
+    // Keys with a task queued in ready_ or running -> tasks waiting behind it
+    std::unordered_map<uint64_t, std::deque<Task>> strands_;
+    size_t queued_ = 0;
+    size_t maxQueueDepth_;
+    bool stopping_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // Metrics (under mutex_)
+    size_t peakDepth_ = 0;
+    uint64_t completed_ = 0;
+    uint64_t rejected_ = 0;
+    double totalWaitMs_ = 0;
+    double maxWaitMs_ = 0;
+    double totalRunMs_ = 0;
+
+    void workerLoop();
+};
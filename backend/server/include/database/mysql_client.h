@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <optional>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <mysqlx/xdevapi.h>  // Full include needed for templates
 #include "types.h"
+#include "room_member_cache.h"
 
 class MySQLClient {
 public:
@@ -28,6 +34,8 @@ public:
     std::optional<User> getUserById(const std::string& userId);
     std::vector<User> getAllUsers();
     bool updateUserStatus(const std::string& userId, int status);
+    // One UPDATE for many users: (userId, "online" | "offline" | "away" | "busy")
+    bool updateUserStatuses(const std::vector<std::pair<std::string, std::string>>& statuses);
     bool updateUserAvatar(const std::string& userId, const std::string& avatarUrl);
     bool deleteUser(const std::string& userId);
     
@@ -55,12 +63,15 @@ public:
     bool addRoomMember(const std::string& roomId, const std::string& userId);
     bool removeRoomMember(const std::string& roomId, const std::string& userId);
     std::vector<std::string> getRoomMembers(const std::string& roomId);
+    RoomMemberCache::MemberList getRoomMemberList(const std::string& roomId);  // Shared snapshot, no copy
+    std::vector<std::string> getUserRoomIds(const std::string& userId);
     
     // Room Roles & Permissions
     bool setMemberRole(const std::string& roomId, const std::string& userId, const std::string& role);
     std::string getMemberRole(const std::string& roomId, const std::string& userId);
     bool hasMemberPermission(const std::string& roomId, const std::string& userId, const std::string& action);
     bool isRoomOwner(const std::string& roomId, const std::string& userId);
+    bool isRoomMember(const std::string& roomId, const std::string& userId);
     
     // Pin Messages
     bool pinMessage(const std::string& roomId, const std::string& messageId);
@@ -91,8 +102,8 @@ public:
     // Returns existing conversation_id or creates a new one
     std::string getOrCreateDmConversation(const std::string& userId1, const std::string& userId2);
     
-    // Direct session access for custom queries
-    std::shared_ptr<mysqlx::Session> getSession() { return session_; }
+    // Direct session access for custom queries (one session per calling thread)
+    std::shared_ptr<mysqlx::Session> getSession();
     
 private:
     std::string host_;
@@ -101,7 +112,19 @@ private:
     std::string database_;
     int port_;
     
-    std::shared_ptr<mysqlx::Session> session_;
+    std::shared_ptr<mysqlx::Session> session_;  // Session of the thread that called connect()
+    
+    // Per-thread sessions (event loops run on separate threads). Each thread
+    // caches its own in a thread_local; the map only exists for disconnect().
+    std::unordered_map<std::thread::id, std::shared_ptr<mysqlx::Session>> threadSessions_;
+    std::mutex sessionsMutex_;
+    std::atomic<uint64_t> generation_{0};  // Changes on connect / disconnect: cached sessions are stale
+    
+    std::shared_ptr<mysqlx::Session> openSession();
+    
+    // Room members + roles (write-through, see room_member_cache.h)
+    RoomMemberCache roomMembers_;
+    std::optional<RoomMemberCache::MemberRows> loadRoomMembers(const std::string& roomId);
     
     void handleException(const std::exception& e, const std::string& context);
 };
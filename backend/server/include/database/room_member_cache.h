@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Room Member Cache
+ *
+ * In-process copy of room_members (member IDs + roles) keyed by room.
+ * Rooms are loaded lazily on first use and kept up to date by MySQLClient,
+ * which applies every successful room/member write to the cache
+ * (write-through), so lookups after the first never hit the database.
+ *
+ * A fill computed from a query that raced with a write to the same room
+ * is dropped (see version()), so the cache never resurrects stale
+ * membership. Writes to other rooms do not affect it.
+ *
+ * At most `capacity` rooms are kept. When full, rooms not read since the
+ * previous sweep are evicted first (second chance); an evicted room is
+ * simply loaded again on its next lookup.
+ *
+ * Thread-safe (readers share the lock).
+ */
+class RoomMemberCache {
+public:
+    static constexpr size_t kDefaultCapacity = 10000;
+
+    explicit RoomMemberCache(size_t capacity = kDefaultCapacity);
+
+    using MemberList = std::shared_ptr<const std::vector<std::string>>;
+    using MemberRows = std::vector<std::pair<std::string, std::string>>;  // (userId, role)
+
+    /**
+     * Member IDs of a loaded room
+     * @return nullptr if the room is not cached yet
+     */
+    MemberList getMembers(const std::string& roomId) const;
+
+    /**
+     * Role of a user in a loaded room
+     * @return nullopt if the room is not cached yet, "" if not a member
+     */
+    std::optional<std::string> getRole(const std::string& roomId, const std::string& userId) const;
+
+    /**
+     * Write counter of the room, read before querying the database for fill()
+     */
+    uint64_t version(const std::string& roomId) const;
+
+    /**
+     * Install rows loaded from the database
+     * Ignored if the room was written since `versionBefore` was read
+     */
+    void fill(const std::string& roomId, const MemberRows& rows, uint64_t versionBefore);
+
+    // Write-through updates (called after the SQL succeeded)
+    void setMember(const std::string& roomId, const std::string& userId, const std::string& role);
+    void addMemberIfAbsent(const std::string& roomId, const std::string& userId, const std::string& role);
+    void removeMember(const std::string& roomId, const std::string& userId);
+    void createRoom(const std::string& roomId, const std::string& ownerId);
+    void eraseRoom(const std::string& roomId);
+    void clear();
+
+private:
+    struct RoomEntry {
+        std::unordered_map<std::string, std::string> roles;  // userId -> role
+        MemberList members;  // Snapshot handed to broadcasters, rebuilt on change
+        mutable std::atomic<bool> referenced{true};  // Read since the last eviction sweep
+    };
+
+    // Write counters per stripe of rooms (bounded, unlike one per room ever
+    // seen); rooms sharing a stripe only cost each other a dropped fill
+    static constexpr size_t kVersionStripes = 4096;
+
+    size_t capacity_;
+    std::unordered_map<std::string, RoomEntry> rooms_;
+    std::array<uint64_t, kVersionStripes> versions_{};
+    mutable std::shared_mutex mutex_;
+
+    static size_t stripe(const std::string& roomId);
+    RoomEntry& insertLocked(const std::string& roomId);
+    void touchLocked(const std::string& roomId) { versions_[stripe(roomId)]++; }
+    static void markRead(const RoomEntry& entry);
+    static void rebuildMembers(RoomEntry& entry);
+};
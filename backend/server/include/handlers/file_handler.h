@@ -1,9 +1,11 @@
 #ifndef FILE_HANDLER_H
 #define FILE_HANDLER_H
 
+#include <functional>
 #include <memory>
 #include <string>
 #include "../protocol_chatbox1.h"
+#include "websocket/prepared_message.h"
 #include <vector>
 #include <nlohmann/json.hpp>
 
@@ -31,6 +33,15 @@ public:
     
     ~FileHandler();
     
+    // Callback for room fan-out (called by WebSocketServer)
+    using RoomBroadcastCallback = std::function<void(const std::string& roomId,
+                                                     const PreparedMessage::Ptr& message)>;
+    void setRoomBroadcastCallback(RoomBroadcastCallback callback) { roomBroadcastCallback_ = callback; }
+    
+    // Callback for replies to the uploading socket (corked / queued like any other send)
+    using SendCallback = std::function<void(void* ws, const PreparedMessage::Ptr& message)>;
+    void setSendCallback(SendCallback callback) { sendCallback_ = callback; }
+    
     // Handle file messages
     void handleFileUpload(void* ws,
                           const FileUploadPayload& payload,
@@ -75,6 +86,14 @@ public:
                           const nlohmann::json& data,
                           const std::string& userId);
     
+    // Raw chunk bytes (ChatBox1 MSG_FILE_CHUNK; the JSON variant is base64)
+    void handleUploadChunkData(void* ws,
+                               const std::string& uploadId,
+                               uint32_t chunkIndex,
+                               const uint8_t* bytes,
+                               size_t size,
+                               const std::string& userId);
+    
     void handleUploadFinalize(void* ws,
                              const nlohmann::json& data,
                              const std::string& userId);
@@ -83,10 +102,13 @@ private:
     std::shared_ptr<FileStorage> fileStorage_;
     std::shared_ptr<MySQLClient> dbClient_;
     std::shared_ptr<PubSubBroker> broker_;
+    RoomBroadcastCallback roomBroadcastCallback_;  // Direct WebSocket delivery
+    SendCallback sendCallback_;
     
     // Helper functions
     void sendSuccess(void* ws, uint8_t messageType, const void* payload, size_t size);
     void sendError(void* ws, uint8_t messageType, const std::string& error);
+    void sendJson(void* ws, const nlohmann::json& message);
     void sendPacket(void* ws, const PacketHeader& header, const void* payload, size_t size);
     
     std::string generateFileId();
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // ============================================================================
@@ -17,6 +18,7 @@
 // ============================================================================
 
 #define PROTOCOL_VERSION 1
+#define PROTOCOL_VERSION_V2 2  // Compact header, see PacketHeaderV2
 #define DEFAULT_PORT 8080  // WebSocket port
 #define MAX_BUFFER_SIZE 8192
 #define MAX_TOPIC_LEN 128
@@ -32,6 +34,9 @@
 // Packet magic number for validation
 #define PACKET_MAGIC 0x43484154  // "CHAT" in ASCII
 
+// Sec-WebSocket-Protocol value that switches a connection to binary packets
+#define CHATBOX1_SUBPROTOCOL "chatbox1"
+
 // Alias for backward compatibility with websocket_server.cpp
 #define MSG_AUTH_LOGIN MSG_LOGIN_REQUEST
 #define MSG_AUTH_REGISTER MSG_REGISTER_REQUEST
@@ -175,7 +180,10 @@ enum MessageType : uint32_t {
     MSG_ACK,
     MSG_NACK,
     MSG_PING,
-    MSG_PONG
+    MSG_PONG,
+    
+    // ===== PROTOCOL v2 (256+) =====
+    MSG_INTERN = 256            // Topic ID request / announcement
 };
 
 // ============================================================================
@@ -227,6 +235,9 @@ enum GameType : uint8_t {
 // PACKET HEADER (Common for all messages)
 // ============================================================================
 
+// A BINARY WebSocket frame is one PacketHeader followed by payloadLength
+// bytes of payload. Fields are little-endian; checksum is the CRC32 of the
+// payload.
 #pragma pack(push, 1)
 struct PacketHeader {
     uint32_t msgType;           // MessageType
@@ -246,6 +257,41 @@ struct PacketHeader {
 #define FLAG_COMPRESSED 0x02
 #define FLAG_PRIORITY   0x04
 #define FLAG_REQUIRE_ACK 0x08
+#define FLAG_CHECKSUM   0x10  // v2: CRC32 of the payload follows it (4 bytes)
+
+// ============================================================================
+// PACKET HEADER v2 (compact)
+// ============================================================================
+
+/*
+ * Wire format:
+ *   u8 version (2) | varint msgType | u8 flags | varint topicId | varint payloadLength
+ *   payload [| u32 crc32 if FLAG_CHECKSUM]
+ *
+ * Varints are LEB128 (7 bits per byte, little-endian). topicId 0 = none;
+ * other IDs are interned per connection with MSG_INTERN. The sender is the
+ * authenticated user, so it is not sent.
+ *
+ * Negotiation: after CHATBOX1_SUBPROTOCOL, a client sends a v1 packet with
+ * version = 2 (normally MSG_PING). The server then switches the connection
+ * to v2; the MSG_PONG comes back as a v2 packet.
+ *
+ * v2 payloads (str = varint length + bytes; the room is the topic):
+ *   MSG_CHAT_TEXT              text (rest of payload)
+ *   MSG_TYPING_START/STOP      empty
+ *   MSG_ADD_REACTION           str messageId, str emoji
+ *   MSG_MESSAGE_READ           str messageId
+ *   MSG_PING / MSG_PONG        empty
+ *   MSG_FILE_CHUNK             str transferId, varint chunkIndex, bytes (rest)
+ *   MSG_INTERN                 varint id, name (rest)
+ *                              client: id 0 = assign an ID to name
+ *                              server: id + name = assigned, id + "" = evicted
+ */
+struct PacketHeaderV2 {
+    uint32_t msgType = 0;
+    uint8_t flags = 0;
+    uint32_t topicId = 0;
+};
 
 // ============================================================================
 // PAYLOAD STRUCTURES
@@ -282,6 +328,11 @@ struct ChatTextPayload {
     // Followed by: char message[messageLen]
 };
 
+struct ReadReceiptPayload {
+    char roomId[64];
+    char messageId[64];
+};
+
 struct ChatFilePayload {
     char roomId[64];
     char messageId[64];
@@ -454,6 +505,23 @@ namespace ProtocolChatBox1 {
     
     bool deserializePacket(const std::vector<uint8_t>& data, 
                           PacketHeader& header, std::vector<uint8_t>& payload);
+    
+    // Zero-copy variant: payload points into frame
+    bool parsePacket(std::string_view frame, PacketHeader& header, std::string_view& payload);
+    
+    // Fixed-size char field -> string (stops at the first NUL)
+    std::string fieldString(const char* field, size_t size);
+    
+    // v2 packets (payload points into frame)
+    std::string serializePacketV2(const PacketHeaderV2& header, std::string_view payload);
+    bool parsePacketV2(std::string_view frame, PacketHeaderV2& header, std::string_view& payload);
+    
+    // v2 payload fields: consume from the front of `in`, false if truncated
+    // or out of range (varints longer than 10 bytes or past 64 bits)
+    void appendVarint(std::string& out, uint64_t value);
+    void appendString(std::string& out, std::string_view value);
+    bool readVarint(std::string_view& in, uint64_t& value);
+    bool readString(std::string_view& in, std::string_view& value);
 }
 
 // ============================================================================
@@ -2,14 +2,49 @@
 #define SOCKET_DATA_H
 
 #include <string>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "websocket/send_queue.h"
+#include "websocket/intern_table.h"
+#include "websocket/rate_limiter.h"
 
-// Per-socket user data
-struct PerSocketData {
+// Who is on the socket. DATABASE handlers run on DB executor threads
+// against their own copy (PerSocketData::dbSession) and post changes back.
+struct SocketSession {
     std::string sessionId;
     std::string userId;
     std::string username;
     std::string currentRoom;  // Currently joined room
+    uint64_t connectionId = 0;  // ConnectionRegistry ID
     bool authenticated = false;
+    
+    bool operator==(const SocketSession&) const = default;
+};
+
+// Per-socket user data
+struct PerSocketData : SocketSession {
+    // Output waiting while the socket is congested (see SendLimits)
+    SendQueue sendQueue;
+    std::chrono::steady_clock::time_point overLimitSince{};  // Epoch = under the hard limit
+    
+    // Frames written this loop iteration, sent together at its end
+    // (see WebSocketServer::writeCorked)
+    std::vector<SendQueue::Entry> corked;
+    size_t corkedBytes = 0;
+    
+    // Inbound token buckets (see RateLimiter)
+    ConnectionRate rate;
+    uint32_t heldMessages = 0;  // Waiting for auth admission (see AuthAdmission)
+    
+    // Session copy used by DB executor tasks (one at a time per connection)
+    std::shared_ptr<SocketSession> dbSession;
+    
+    // Negotiated CHATBOX1_SUBPROTOCOL at upgrade: BINARY frames accepted
+    bool binaryProtocol = false;
+    uint8_t packetVersion = 1;  // Switched to 2 by the client (see PacketHeaderV2)
+    InternTable topics;         // v2 topic IDs of this connection
 };
 
 #endif // SOCKET_DATA_H
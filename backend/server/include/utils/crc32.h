@@ -0,0 +1,32 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC-32 (IEEE 802.3 / zlib polynomial), used for PacketHeader::checksum
+ *
+ * Named checksum::crc32 so it does not clash with zlib's ::crc32.
+ *
+ * The implementation is picked once at first use: PCLMULQDQ folding on
+ * x86-64, otherwise slice-by-8. The PCLMUL path is only selected after it
+ * matches the slice-by-8 reference on a set of lengths and alignments.
+ *
+ * (The SSE4.2 crc32 instruction computes CRC-32C, a different polynomial,
+ * so it cannot produce this checksum.)
+ */
+namespace checksum {
+
+// CRC of data, continuing from `crc` (0 starts a new checksum)
+uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+// Selected implementation ("pclmul" or "slice-by-8")
+const char* crc32Implementation();
+
+// Portable reference (slice-by-8), also used for short inputs
+uint32_t crc32Portable(const void* data, size_t length, uint32_t crc = 0);
+
+} // namespace checksum
+
+#endif // CRC32_H
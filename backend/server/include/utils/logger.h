@@ -2,10 +2,16 @@
 #define LOGGER_H
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <utility>
 #include <iostream>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <fmt/format.h>
 
 enum class LogLevel {
     Debug,
@@ -14,19 +20,90 @@ enum class LogLevel {
     Error
 };
 
+/**
+ * Logger
+ *
+ * Asynchronous: a call copies the message into its thread's lock-free
+ * ring buffer (level, coarse timestamp, payload) and returns. A writer
+ * thread drains every ring, formats the records in timestamp order and
+ * writes them to stdout in large writes. A full ring drops the record;
+ * drops are counted and reported in the log.
+ *
+ * Timestamps come from a cached clock refreshed by tick() (each event
+ * loop iteration) and by the writer thread, so they are a few ms coarse.
+ *
+ * Hot paths log through the LOG_*_F macros below instead: arguments are
+ * only evaluated and formatted once the level check passes.
+ */
 class Logger {
 public:
+    struct Stats {
+        uint64_t written = 0;
+        uint64_t dropped = 0;  // Ring full
+    };
+
     static void setLevel(LogLevel level);
+    static bool enabled(LogLevel level) { return level >= currentLevel; }
+
+    // "debug", "info", "warning"/"warn" or "error" (LOG_LEVEL in .env)
+    static std::optional<LogLevel> parseLevel(std::string_view name);
+
     static void debug(const std::string& message);
     static void info(const std::string& message);
     static void warning(const std::string& message);
     static void error(const std::string& message);
-    
+
+    // fmt syntax, rendered into a stack buffer (no std::string); use the
+    // LOG_*_F macros, which check the level first
+    template <typename... Args>
+    static void logf(LogLevel level, fmt::format_string<Args...> format, Args&&... args) {
+        fmt::memory_buffer buffer;
+        fmt::format_to(std::back_inserter(buffer), format, std::forward<Args>(args)...);
+        log(level, std::string_view(buffer.data(), buffer.size()));
+    }
+
+    // Refresh the cached clock (once per event loop iteration)
+    static void tick();
+
+    // Wait until everything logged so far has been written
+    static void flush();
+
+    static Stats stats();
+
 private:
     static LogLevel currentLevel;
-    static void log(LogLevel level, const std::string& message);
-    static std::string getCurrentTimestamp();
-    static std::string levelToString(LogLevel level);
+    static void log(LogLevel level, std::string_view message);
 };
 
+// ============================================================================
+// LAZY LOG MACROS
+// ============================================================================
+
+// Lowest level the LOG_*_F macros are compiled in at: 0 debug, 1 info,
+// 2 warning, 3 error. Release builds drop DEBUG and INFO statements
+// entirely (override with -DLOG_MIN_LEVEL=N).
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 2
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Arguments are not evaluated unless the statement is compiled in and the
+// level is enabled at runtime
+#define LOG_AT_F(level, ...)                                          \
+    do {                                                              \
+        if constexpr (static_cast<int>(level) >= LOG_MIN_LEVEL) {     \
+            if (Logger::enabled(level)) {                             \
+                Logger::logf(level, __VA_ARGS__);                     \
+            }                                                         \
+        }                                                             \
+    } while (0)
+
+#define LOG_DEBUG_F(...) LOG_AT_F(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO_F(...)  LOG_AT_F(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN_F(...)  LOG_AT_F(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR_F(...) LOG_AT_F(LogLevel::Error, __VA_ARGS__)
+
 #endif // LOGGER_H
@@ -5,6 +5,7 @@
 #include <string>
 #include <sstream>
 #include <chrono>
+#include <cstdint>
 #include <map>
 
 namespace chatbox {
@@ -43,18 +44,68 @@ private:
 
 /**
  * Performance monitoring
+ *
+ * Histograms and counters are registered once by name + labels (mutex) and
+ * then recorded lock-free: every thread writes its own shard (plain
+ * relaxed stores, no shared cache lines). getMetrics() merges the shards
+ * into Prometheus text format.
+ *
+ * Histograms are HDR-style log-linear (8 sub-buckets per power of two,
+ * <= 12.5% relative error) over uint64 values: nanoseconds for SECONDS,
+ * plain values for COUNT / BYTES. Exported `le` buckets are sums of the
+ * HDR buckets below the bound (the straddling one split linearly).
  */
 class PerformanceMonitor {
 public:
+    enum class Unit {
+        SECONDS,  // Recorded in nanoseconds
+        COUNT,
+        BYTES
+    };
+    
+    class Histogram {
+    public:
+        void record(uint64_t value);
+        void recordDuration(std::chrono::nanoseconds duration) {
+            record(duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0);
+        }
+        
+    private:
+        friend class PerformanceMonitor;
+        explicit Histogram(uint32_t id) : id(id) {}
+        uint32_t id;
+    };
+    
+    class Counter {
+    public:
+        void add(uint64_t value = 1);
+        
+    private:
+        friend class PerformanceMonitor;
+        explicit Counter(uint32_t id) : id(id) {}
+        uint32_t id;
+    };
+    
+    /**
+     * Registered metric (same name + labels = same metric)
+     * @param labels Prometheus label list without braces: type="chat"
+     */
+    static Histogram& histogram(const std::string& name, const std::string& labels = "", Unit unit = Unit::SECONDS);
+    static Counter& counter(const std::string& name, const std::string& labels = "");
+    
+    // Records the time from construction to stop() / destruction
     class Timer {
     public:
-        Timer(const std::string& name);
+        explicit Timer(const std::string& name);
+        explicit Timer(Histogram* histogram = nullptr);  // Histogram may be set later
         ~Timer();
+        void setHistogram(Histogram& target) { histogram = &target; }
+        std::chrono::steady_clock::time_point startedAt() const { return start; }
         void stop();
         
     private:
-        std::string name;
-        std::chrono::high_resolution_clock::time_point start;
+        Histogram* histogram;
+        std::chrono::steady_clock::time_point start;
         bool stopped = false;
     };
     
@@ -91,8 +142,14 @@ private:
 #define LOG_WARNING(msg) chatbox::logging::Logger::warning(msg, {{"file", __FILE__}, {"line", std::to_string(__LINE__)}})
 #define LOG_ERROR(msg) chatbox::logging::Logger::error(msg, {{"file", __FILE__}, {"line", std::to_string(__LINE__)}})
 
-// Performance timing macro
-#define PERF_TIMER(name) chatbox::logging::PerformanceMonitor::Timer __perf_timer(name)
+// Performance timing macro: PERF_TIMER(name [, labels [, unit]]), the
+// histogram is looked up once per call site
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_TIMER(...)                                                                              \
+    static auto& PERF_CONCAT(perfHistogram_, __LINE__) =                                             \
+        chatbox::logging::PerformanceMonitor::histogram(__VA_ARGS__);                                \
+    chatbox::logging::PerformanceMonitor::Timer PERF_CONCAT(perfTimer_, __LINE__)(&PERF_CONCAT(perfHistogram_, __LINE__))
 
 } // namespace logging
 } // namespace chatbox
@@ -0,0 +1,68 @@
+#ifndef AUTH_ADMISSION_H
+#define AUTH_ADMISSION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Auth admission limits (AUTH_ADMISSION_* in .env)
+ *
+ * ratePerSecond = 0 turns pacing off.
+ */
+struct AdmissionLimits {
+    double ratePerSecond = 500;
+    std::chrono::milliseconds maxWait{5000};  // Longest queued wait before refusing
+};
+
+/**
+ * Auth Admission
+ *
+ * Paces auth/login across all loops so a reconnect storm reaches MySQL as
+ * a steady stream. Each request reserves the next free slot (one CAS on
+ * the schedule's tail): it runs at that slot if the wait is within
+ * maxWait. The queue is the schedule itself; callers hold the request
+ * until its slot.
+ *
+ * Refused requests get retry times from a second schedule at the same
+ * rate, so clients come back one slot apart instead of all at once. N
+ * clients are through in about N / rate + maxWait.
+ *
+ * Thread-safe, lock-free.
+ */
+class AuthAdmission {
+public:
+    struct Ticket {
+        bool admitted;
+        int64_t waitNs;  // Admitted: run after this long. Refused: retry after it.
+    };
+
+    struct Stats {
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        uint64_t queued = 0;    // Slots reserved ahead of now
+        int64_t backlogMs = 0;  // Time until the schedule is empty
+    };
+
+    explicit AuthAdmission(const AdmissionLimits& limits = AdmissionLimits());
+
+    Ticket reserve(int64_t nowNs);
+
+    Stats stats(int64_t nowNs) const;
+
+    double ratePerSecond() const { return intervalNs_ ? 1e9 / intervalNs_ : 0; }
+
+private:
+    int64_t intervalNs_;  // Between two slots (0 = unpaced)
+    int64_t maxWaitNs_;
+    std::atomic<int64_t> next_{0};       // First free slot
+    std::atomic<int64_t> nextRetry_{0};  // First retry time not handed out
+
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+
+    // Next retry time for a refused request, at least earliestNs away
+    int64_t retryAfter(int64_t nowNs, int64_t earliestNs);
+};
+
+#endif // AUTH_ADMISSION_H
@@ -0,0 +1,88 @@
+#ifndef BOOTSTRAP_SNAPSHOT_H
+#define BOOTSTRAP_SNAPSHOT_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "database/types.h"
+
+/**
+ * Bootstrap Snapshot
+ *
+ * What every client asks for right after auth, served from memory:
+ * - the user directory (users table), reloaded periodically with
+ *   refresh() on the DB executor instead of once per client
+ * - the online_users reply, rendered at most once per renderInterval from
+ *   the directory and the online set, and shared by every requester
+ *
+ * A client gets the shared rendering minus its own entry (two copies, no
+ * JSON building). Presence changes after a rendering reach the client
+ * through presence_batch.
+ *
+ * Thread-safe.
+ */
+class BootstrapSnapshot {
+public:
+    using Loader = std::function<std::vector<User>()>;
+    using OnlineSource = std::function<std::vector<std::string>()>;
+
+    struct Stats {
+        size_t users = 0;
+        uint64_t loads = 0;
+        uint64_t renders = 0;
+        uint64_t served = 0;
+        int64_t directoryAgeMs = -1;  // -1 = not loaded
+    };
+
+    explicit BootstrapSnapshot(std::chrono::milliseconds renderInterval = std::chrono::milliseconds(1000));
+
+    void setRenderInterval(std::chrono::milliseconds interval);
+
+    // Reload the directory (DB thread). Concurrent callers share one load;
+    // with `onlyIfMissing` nothing happens once a directory is present.
+    void refresh(const Loader& load, bool onlyIfMissing = false);
+
+    /**
+     * online_users JSON for userId (its own entry left out)
+     * @return nullopt until a directory has been loaded
+     */
+    std::optional<std::string> onlineUsers(const std::string& userId, const OnlineSource& online);
+
+    Stats stats() const;
+
+private:
+    using Directory = std::vector<User>;
+
+    struct Rendering {
+        std::string users;  // Array elements, comma separated, no brackets
+        std::unordered_map<std::string, std::pair<size_t, size_t>> spans;  // userId -> element [begin, end)
+        size_t count = 0;
+        std::chrono::steady_clock::time_point renderedAt;
+        std::shared_ptr<const Directory> directory;  // Rendered from
+    };
+
+    std::chrono::milliseconds renderInterval_;
+
+    mutable std::mutex mutex_;  // Guards the pointers and counters below
+    std::shared_ptr<const Directory> directory_;
+    std::chrono::steady_clock::time_point loadedAt_{};
+    std::shared_ptr<const Rendering> rendering_;
+    uint64_t loads_ = 0;
+    uint64_t renders_ = 0;
+    uint64_t served_ = 0;
+
+    std::mutex loadMutex_;    // One directory load at a time
+    std::mutex renderMutex_;  // One rendering at a time
+
+    static std::shared_ptr<const Rendering> render(const std::shared_ptr<const Directory>& directory,
+                                                   const std::unordered_set<std::string>& online);
+};
+
+#endif // BOOTSTRAP_SNAPSHOT_H
@@ -0,0 +1,67 @@
+#ifndef COMPRESSION_POLICY_H
+#define COMPRESSION_POLICY_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+/**
+ * permessage-deflate settings (WS_COMPRESSION* in .env)
+ *
+ * - OFF:       no extension negotiated
+ * - SHARED:    one compressor per loop, no context takeover (no per-socket
+ *              memory, each message compressed on its own)
+ * - DEDICATED: sliding window per socket (better ratio on repetitive
+ *              traffic, costs windowKb + deflate state per connection)
+ */
+enum class CompressionMode {
+    OFF,
+    SHARED,
+    DEDICATED
+};
+
+struct CompressionSettings {
+    CompressionMode mode = CompressionMode::OFF;
+    int windowKb = 4;              // DEDICATED only: 3, 4, 8, 16, 32, 64, 128 or 256
+    size_t thresholdBytes = 1024;  // Smaller payloads always go out uncompressed
+    std::unordered_set<std::string> excludedTypes;  // Latency-critical "type"s
+};
+
+/**
+ * Compression Policy
+ *
+ * Decides per outbound message whether to ask uWS for compression. The
+ * socket still has to have negotiated the extension; otherwise uWS sends
+ * the frame uncompressed.
+ */
+class CompressionPolicy {
+public:
+    CompressionPolicy() = default;
+    explicit CompressionPolicy(CompressionSettings settings);
+
+    bool enabled() const { return settings_.mode != CompressionMode::OFF; }
+    const CompressionSettings& settings() const { return settings_; }
+
+    /**
+     * Compress this JSON payload?
+     * Size is checked first; the "type" is only looked up for large payloads
+     */
+    bool shouldCompress(std::string_view payload) const;
+
+    /**
+     * Parse WS_COMPRESSION ("off", "shared", "dedicated")
+     * @return nullopt for unknown values
+     */
+    static std::optional<CompressionMode> parseMode(const std::string& value);
+
+    /**
+     * Parse a comma separated type list ("webrtc_ice, typing")
+     */
+    static std::unordered_set<std::string> parseTypeList(const std::string& value);
+
+private:
+    CompressionSettings settings_;
+};
+
+#endif // COMPRESSION_POLICY_H
@@ -0,0 +1,136 @@
+#ifndef CONNECTION_REGISTRY_H
+#define CONNECTION_REGISTRY_H
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace uWS { struct Loop; }
+
+// Connection state shared by all event loops
+struct ConnectionState {
+    std::string sessionId;
+    std::string userId;
+    std::string username;
+    bool authenticated;
+    uint64_t connectedAt;
+    uint64_t connectionId;  // Unique per connection (wsPtr may be reused after close)
+    void* wsPtr;  // WebSocket pointer for broadcasting
+    uWS::Loop* loop;  // Event loop that accepted (and owns) this socket
+
+    ConnectionState()
+        : authenticated(false), connectedAt(0), connectionId(0), wsPtr(nullptr), loop(nullptr) {}
+};
+
+/**
+ * Connection Registry
+ *
+ * Owns every live ConnectionState and keeps secondary indexes so lookups
+ * never scan all connections:
+ * - userId    -> connections (one per device)
+ * - sessionId -> connection
+ *
+ * Indexes are maintained on open (add), auth (authenticate) and close
+ * (remove). Room fan-out goes through uWS topics instead. They point
+ * straight at the states in connections_ (unordered_map nodes do not move
+ * on rehash), so a user lookup is one hashed find plus a short vector
+ * rather than a chain of node-based containers.
+ *
+ * Thread-safe. Visitors run with the registry lock held, so they must not
+ * call back into the registry.
+ */
+class ConnectionRegistry {
+public:
+    /**
+     * Register a new (unauthenticated) connection
+     * @return Connection ID assigned to the socket
+     */
+    uint64_t add(void* wsPtr, uWS::Loop* loop);
+
+    /**
+     * Mark connection as authenticated and index it by user and session
+     * @return false if the socket is not registered
+     */
+    bool authenticate(void* wsPtr,
+                      const std::string& userId,
+                      const std::string& username,
+                      const std::string& sessionId);
+
+    /**
+     * Unregister connection and drop it from every index
+     * @return State of the removed connection
+     */
+    std::optional<ConnectionState> remove(void* wsPtr);
+
+    /**
+     * Check that wsPtr still refers to the same connection
+     */
+    bool isAlive(void* wsPtr, uint64_t connectionId) const;
+
+    size_t size() const;
+    size_t userConnectionCount(const std::string& userId) const;
+    std::vector<std::string> getOnlineUserIds() const;
+
+    // ========================================================================
+    // VISITORS (run under the registry lock)
+    // ========================================================================
+
+    // All authenticated connections
+    template <typename Fn>
+    size_t forEachAuthenticated(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t visited = 0;
+        for (const auto& [wsPtr, state] : connections_) {
+            if (state.authenticated) {
+                fn(state);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    // Every device of one user
+    template <typename Fn>
+    size_t forEachUserConnection(const std::string& userId, Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return visitUserLocked(userId, fn);
+    }
+
+    // The connection holding sessionId
+    template <typename Fn>
+    bool withSession(const std::string& sessionId, Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = bySession_.find(sessionId);
+        if (it == bySession_.end()) {
+            return false;
+        }
+        fn(*it->second);
+        return true;
+    }
+
+private:
+    std::unordered_map<void*, ConnectionState> connections_;
+    std::unordered_map<std::string, std::vector<ConnectionState*>> byUser_;  // Few devices each
+    std::unordered_map<std::string, ConnectionState*> bySession_;
+    uint64_t nextConnectionId_ = 0;
+    mutable std::mutex mutex_;
+
+    template <typename Fn>
+    size_t visitUserLocked(const std::string& userId, Fn& fn) const {
+        auto it = byUser_.find(userId);
+        if (it == byUser_.end()) {
+            return 0;
+        }
+        for (const ConnectionState* state : it->second) {
+            fn(*state);
+        }
+        return it->second.size();
+    }
+
+    void unindexLocked(ConnectionState& state);
+};
+
+#endif // CONNECTION_REGISTRY_H
@@ -0,0 +1,56 @@
+#ifndef INBOUND_MESSAGE_H
+#define INBOUND_MESSAGE_H
+
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include <simdjson.h>
+
+/**
+ * Inbound Message
+ *
+ * One JSON text frame read with simdjson's on-demand API: type() first,
+ * then handlers pull only the fields they use. Nothing is materialized;
+ * a field is located and converted when asked for. toJson() builds the
+ * full nlohmann document for cold types that need it.
+ *
+ * The frame is copied into a padded buffer owned by the reader
+ * (simdjson reads up to SIMDJSON_PADDING bytes past the end; uWS frames
+ * have no such guarantee). Views returned by the getters stay valid until
+ * the next parse().
+ *
+ * Field access follows nlohmann's value(key, fallback): a missing field
+ * gives the fallback, a field of another type throws. One reader per loop
+ * thread, reused for every frame.
+ */
+class InboundMessage {
+public:
+    // false = not a JSON object
+    bool parse(std::string_view frame);
+
+    // "type" field ("" if missing)
+    std::string_view type() const { return type_; }
+
+    std::string_view getString(std::string_view key, std::string_view fallback = {});
+    bool getBool(std::string_view key, bool fallback);
+    double getDouble(std::string_view key, double fallback);
+
+    // Raw JSON text of an object field (empty if missing or not an object)
+    std::string_view getRawObject(std::string_view key);
+
+    // Full document, for cold paths (throws nlohmann::json::exception)
+    nlohmann::json toJson() const;
+
+private:
+    simdjson::ondemand::parser parser_;
+    simdjson::ondemand::document document_;
+    simdjson::ondemand::object object_;
+    std::string buffer_;   // Frame + padding
+    std::string_view frame_;
+    std::string_view type_;
+
+    // Field value, or NO_SUCH_FIELD
+    simdjson::simdjson_result<simdjson::ondemand::value> field(std::string_view key);
+};
+
+#endif // INBOUND_MESSAGE_H
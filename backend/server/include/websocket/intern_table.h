@@ -0,0 +1,50 @@
+#ifndef INTERN_TABLE_H
+#define INTERN_TABLE_H
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Intern Table
+ *
+ * Per-connection name <-> small integer map for ChatBox1 v2 topic IDs.
+ * Bounded: interning past the capacity evicts the least recently used
+ * entry. IDs are never reused on a connection, so a client still holding
+ * an evicted ID gets "unknown id" instead of reaching another topic.
+ *
+ * Owned by one socket (its loop thread only); not thread-safe.
+ */
+class InternTable {
+public:
+    static constexpr size_t kDefaultCapacity = 128;
+
+    struct Interned {
+        uint32_t id;
+        std::optional<uint32_t> evicted;  // Released to make room
+    };
+
+    explicit InternTable(size_t capacity = kDefaultCapacity);
+
+    // ID for name (existing or new)
+    Interned intern(std::string_view name);
+
+    // Name for an ID, nullptr if unknown or evicted
+    const std::string* lookup(uint32_t id);
+
+    size_t size() const { return byId_.size(); }
+
+private:
+    using Entry = std::pair<uint32_t, std::string>;
+
+    size_t capacity_;
+    uint32_t nextId_ = 1;  // 0 = "no topic" on the wire
+    std::list<Entry> lru_;  // Most recently used first
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> byId_;
+    std::unordered_map<std::string, uint32_t> byName_;
+};
+
+#endif // INTERN_TABLE_H
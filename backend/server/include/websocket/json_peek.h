@@ -0,0 +1,24 @@
+#ifndef JSON_PEEK_H
+#define JSON_PEEK_H
+
+#include <string_view>
+
+/**
+ * JSON Peek
+ *
+ * Reads one top-level string field of a serialized JSON object without
+ * parsing it (nested objects and arrays are skipped, so "metadata.type"
+ * never matches "type"). Used on the send path, where outbound payloads
+ * are already rendered and only need to be classified.
+ */
+namespace json_peek {
+
+/**
+ * Raw (still escaped) value of a top-level string field
+ * @return empty if missing or not a string
+ */
+std::string_view topLevelString(std::string_view json, std::string_view key);
+
+} // namespace json_peek
+
+#endif // JSON_PEEK_H
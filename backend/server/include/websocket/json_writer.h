@@ -0,0 +1,142 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <charconv>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/**
+ * JSON Writer
+ *
+ * Direct-to-buffer serialization of typed protocol messages (see
+ * protocol_messages.h), byte-identical to nlohmann::json::dump() of the
+ * equivalent object:
+ * - keys in nlohmann's (sorted) order, checked at compile time, and
+ *   appended as pre-escaped literals
+ * - string values escaped in one pass with dump()'s rules (control
+ *   characters, quote and backslash; UTF-8 kept as is, invalid UTF-8
+ *   rejected)
+ *
+ * Declare a message as a struct whose fields are the JSON fields, then
+ * JSON_MESSAGE(Struct, field...) with the fields in key order. A constant
+ * "type" is a `static constexpr std::string_view type` member listed like
+ * any other field.
+ */
+namespace json_writer {
+
+/**
+ * Append `value` as a quoted JSON string
+ * @throws std::invalid_argument on invalid UTF-8 (dump() throws too)
+ */
+void appendString(std::string& out, std::string_view value);
+
+inline void appendValue(std::string& out, std::string_view value) { appendString(out, value); }
+inline void appendValue(std::string& out, const std::string& value) { appendString(out, value); }
+inline void appendValue(std::string& out, const char* value) { appendString(out, value); }
+
+inline void appendValue(std::string& out, bool value) { out.append(value ? "true" : "false"); }
+
+template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+void appendValue(std::string& out, T value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+// Pre-built document (e.g. attachment metadata); nullptr or null = field left out
+inline void appendValue(std::string& out, const nlohmann::json* value) { out.append(value->dump()); }
+
+template <typename T>
+auto appendValue(std::string& out, const T& message) -> decltype(appendJson(out, message)) {
+    appendJson(out, message);
+}
+
+template <typename T>
+void appendValue(std::string& out, const std::vector<T>& values) {
+    out.push_back('[');
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+        appendValue(out, values[i]);
+    }
+    out.push_back(']');
+}
+
+// Optional fields are written only when present
+template <typename T>
+constexpr bool present(const T&) { return true; }
+inline bool present(const nlohmann::json* value) { return value && !value->is_null(); }
+
+// nlohmann::json objects iterate their keys in std::less order
+constexpr bool sortedKeys(std::initializer_list<std::string_view> keys) {
+    std::string_view previous;
+    bool first = true;
+    for (std::string_view key : keys) {
+        if (!first && !(previous < key)) {
+            return false;
+        }
+        previous = key;
+        first = false;
+    }
+    return true;
+}
+
+// Serialized message
+template <typename T>
+std::string toString(const T& message) {
+    std::string out;
+    out.reserve(256);
+    appendJson(out, message);
+    return out;
+}
+
+} // namespace json_writer
+
+// ============================================================================
+// JSON_MESSAGE: generates appendJson() for a struct (up to 8 fields)
+// ============================================================================
+
+#define JSON_WRITER_FIELD(field)                                    \
+    if (::json_writer::present(message.field)) {                    \
+        out.push_back(separator);                                   \
+        separator = ',';                                            \
+        out.append("\"" #field "\":");                              \
+        ::json_writer::appendValue(out, message.field);             \
+    }
+#define JSON_WRITER_KEY(field) #field,
+
+#define JSON_WRITER_EXPAND(x) x
+#define JSON_WRITER_EACH_1(f, a) f(a)
+#define JSON_WRITER_EACH_2(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_1(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_3(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_2(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_4(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_3(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_5(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_4(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_6(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_5(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_7(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_6(f, __VA_ARGS__))
+#define JSON_WRITER_EACH_8(f, a, ...) f(a) JSON_WRITER_EXPAND(JSON_WRITER_EACH_7(f, __VA_ARGS__))
+#define JSON_WRITER_PICK(_1, _2, _3, _4, _5, _6, _7, _8, name, ...) name
+#define JSON_WRITER_EACH(f, ...)                                                                  \
+    JSON_WRITER_EXPAND(JSON_WRITER_PICK(__VA_ARGS__, JSON_WRITER_EACH_8, JSON_WRITER_EACH_7,      \
+                                        JSON_WRITER_EACH_6, JSON_WRITER_EACH_5, JSON_WRITER_EACH_4, \
+                                        JSON_WRITER_EACH_3, JSON_WRITER_EACH_2,                   \
+                                        JSON_WRITER_EACH_1)(f, __VA_ARGS__))
+
+#define JSON_MESSAGE(Type, ...)                                                                   \
+    static_assert(::json_writer::sortedKeys({JSON_WRITER_EACH(JSON_WRITER_KEY, __VA_ARGS__)}),    \
+                  #Type ": fields must be listed in key order (as nlohmann::json::dump() writes)"); \
+    inline void appendJson(std::string& out, const Type& message) {                               \
+        char separator = '{';                                                                     \
+        JSON_WRITER_EACH(JSON_WRITER_FIELD, __VA_ARGS__)                                          \
+        if (separator == '{') {                                                                   \
+            out.push_back('{');                                                                   \
+        }                                                                                         \
+        out.push_back('}');                                                                       \
+    }
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,105 @@
+#ifndef LOOP_WATCHDOG_H
+#define LOOP_WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Loop Watchdog (LOOP_STALL_MS in .env)
+ *
+ * Each event loop beats a heartbeat at the end of every iteration, and a
+ * timer wakes idle loops every heartbeatPeriod() so a healthy loop never
+ * goes a threshold without one. The watchdog thread scans the heartbeats:
+ * one older than the threshold means the loop is stuck in a handler, and
+ * it logs the loop and what it is running (its current activity).
+ *
+ * When the stalled iteration ends the loop records the gap between its
+ * heartbeats in chatbox_loop_stall_seconds{activity} (up to one heartbeat
+ * period of it may be idle time) and logs it.
+ */
+class LoopWatchdog {
+public:
+    // One event loop's heartbeat; beat() and setActivity() on its thread only
+    class Heartbeat {
+    public:
+        // End of a loop iteration (post handler)
+        void beat();
+
+        // What the loop runs now: a string literal (message type, route,
+        // timer), or nullptr between handlers
+        void setActivity(const char* activity) { activity_.store(activity, std::memory_order_relaxed); }
+
+    private:
+        friend class LoopWatchdog;
+        Heartbeat(LoopWatchdog& owner, unsigned loopIndex);
+
+        LoopWatchdog& owner_;
+        unsigned loopIndex_;
+        std::atomic<bool> active_{true};
+        std::atomic<int64_t> lastBeatNs_;
+        std::atomic<const char*> activity_{nullptr};
+        // Activity the watchdog caught, and the heartbeat it was late after
+        std::atomic<const char*> stalledIn_{nullptr};
+        std::atomic<int64_t> stalledAfterNs_{0};
+
+        // Watchdog thread only: the stall already reported, next repeat
+        int64_t reportedBeatNs_ = 0;
+        int64_t nextReportNs_ = 0;
+    };
+
+    struct Stats {
+        int64_t thresholdMs = 0;
+        uint64_t stalls = 0;       // Ended stalls
+        int64_t maxStallMs = 0;
+        uint64_t detected = 0;     // Seen by the watchdog while in progress
+    };
+
+    explicit LoopWatchdog(std::chrono::milliseconds threshold);
+    ~LoopWatchdog();
+
+    LoopWatchdog(const LoopWatchdog&) = delete;
+    LoopWatchdog& operator=(const LoopWatchdog&) = delete;
+
+    // Heartbeat of a loop starting to run; owned by the watchdog
+    Heartbeat* attach(unsigned loopIndex);
+
+    // The loop stopped: no longer watched
+    void detach(Heartbeat* heartbeat);
+
+    // How often idle loops must wake up to beat
+    std::chrono::milliseconds heartbeatPeriod() const;
+
+    void stop();
+
+    Stats stats() const;
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    int64_t thresholdNs_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool stopping_ = false;
+    std::vector<std::unique_ptr<Heartbeat>> heartbeats_;
+    std::thread thread_;
+
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<int64_t> maxStallNs_{0};
+    std::atomic<uint64_t> detected_{0};
+
+    void watch();
+    void check(Heartbeat& heartbeat, int64_t nowNs);
+    void recordStall(Heartbeat& heartbeat, const char* activity, int64_t stallNs);
+};
+
+#endif // LOOP_WATCHDOG_H
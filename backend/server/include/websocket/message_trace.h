@@ -0,0 +1,70 @@
+#ifndef MESSAGE_TRACE_H
+#define MESSAGE_TRACE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "websocket/prepared_message.h"
+
+/**
+ * Chat latency tracing (TRACE_* in .env)
+ *
+ * One in `sampleEvery` chat messages carries a MessageTrace from the loop
+ * through the DB executor to the sockets it is written to. Each stage
+ * feeds chatbox_chat_stage_seconds{stage} and the end-to-end time feeds
+ * chatbox_chat_latency_seconds; a traced message slower than
+ * slowThreshold is logged with its full breakdown (set it near the p99 of
+ * that histogram). Unsampled messages cost one counter check.
+ */
+struct TraceSettings {
+    uint32_t sampleEvery = 0;                         // 0 = tracing off
+    std::chrono::milliseconds slowThreshold{250};
+};
+
+class MessageTrace {
+public:
+    using Ptr = std::shared_ptr<MessageTrace>;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Stage : uint8_t {
+        RECEIVED,   // Frame arrived on the loop
+        PARSED,     // Fields read, task queued for the DB executor
+        DEQUEUED,   // DB task started
+        RESOLVED,   // Storage room known (DM conversation looked up)
+        PERSISTED,  // createMessage returned
+        FANOUT,     // Echo, publish / sendToUser issued
+        WRITTEN     // Last socket written (every tracked frame released)
+    };
+    static constexpr size_t kStageCount = 7;
+
+    static void configure(const TraceSettings& settings);
+
+    // A trace for this message if it is sampled, else nullptr
+    static Ptr sample(Clock::time_point receivedAt);
+
+    // `message` as shared by every send of it: once every copy is written
+    // (or dropped), the trace may complete. No-op without a trace.
+    static PreparedMessage::Ptr track(const Ptr& trace, PreparedMessage::Ptr message);
+
+    void mark(Stage stage) { stages_[static_cast<size_t>(stage)] = Clock::now(); }
+
+    // Identifies the message in the slow log
+    void describe(std::string messageId, std::string roomId);
+
+    // Records the histograms (and the slow log) if the message got to FANOUT
+    ~MessageTrace();
+
+    MessageTrace(const MessageTrace&) = delete;
+    MessageTrace& operator=(const MessageTrace&) = delete;
+
+private:
+    explicit MessageTrace(Clock::time_point receivedAt);
+
+    std::array<Clock::time_point, kStageCount> stages_{};
+    std::string messageId_;
+    std::string roomId_;
+};
+
+#endif // MESSAGE_TRACE_H
@@ -0,0 +1,234 @@
+#ifndef MESSAGE_TYPES_H
+#define MESSAGE_TYPES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Inbound WebSocket message types
+ *
+ * The JSON "type" field is resolved to a MessageKind plus its auth policy
+ * through a perfect hash generated at compile time: one hash and one string
+ * compare per message, independent of how many types exist.
+ *
+ * To add a type: append it to MessageKind and kMessageTypes, then handle
+ * the kind in the dispatch switch (websocket_server.cpp). Its rate limit
+ * cost should reflect the work it causes: DB scans cost the most.
+ */
+enum class MessageKind : uint8_t {
+    UNKNOWN = 0,
+    REGISTER,
+    LOGIN,
+    AUTH,
+    CHAT,
+    TYPING,
+    GET_ONLINE_USERS,
+    EDIT_MESSAGE,
+    DELETE_MESSAGE,
+    ADD_REACTION,
+    PIN_MESSAGE,
+    UNPIN_MESSAGE,
+    REPLY_MESSAGE,
+    CREATE_ROOM,
+    JOIN_ROOM,
+    LEAVE_ROOM,
+    GET_ROOMS,
+    SEARCH_MESSAGES,
+    MARK_READ,
+    PING,
+    CALL_INIT,
+    CALL_ACCEPT,
+    CALL_REJECT,
+    CALL_END,
+    WEBRTC_OFFER,
+    WEBRTC_ANSWER,
+    WEBRTC_ICE,
+    PRESENCE_UPDATE,
+    PROFILE_UPDATE,
+    CHANGE_PASSWORD,
+    AI_REQUEST,
+    POLL_CREATE,
+    POLL_VOTE,
+    POLL_CLOSE,
+    GET_ROOM_POLLS,
+    GAME_INVITE,
+    GAME_ACCEPT,
+    GAME_REJECT,
+    GAME_MOVE,
+    WATCH_CREATE,
+    WATCH_SYNC,
+    WATCH_END,
+    UPLOAD_INIT,
+    UPLOAD_CHUNK,
+    UPLOAD_FINALIZE,
+    FORWARD_MESSAGE,
+    USER_BLOCK,
+    USER_UNBLOCK,
+    GET_BLOCKED_USERS,
+    KICK_USER,
+    INVITE_USER,
+    CHAT_LOCATION
+};
+
+enum class AuthPolicy : uint8_t {
+    NONE,            // Allowed before authentication
+    REQUIRED,        // Rejected with "Not authenticated"
+    REQUIRED_SILENT  // Ignored (no reply) when not authenticated
+};
+
+enum class ExecPolicy : uint8_t {
+    LOOP,     // Handled on the socket's event loop
+    DATABASE  // Touches MySQL: handled on the DB executor (see DbExecutor)
+};
+
+struct MessageTypeEntry {
+    std::string_view name;
+    MessageKind kind;
+    AuthPolicy auth;
+    ExecPolicy exec;
+    uint8_t cost;  // Rate limit tokens per message (see RateLimits; 0 = free)
+};
+
+inline constexpr MessageTypeEntry kMessageTypes[] = {
+    {"register",           MessageKind::REGISTER,           AuthPolicy::NONE,            ExecPolicy::DATABASE, 10},
+    {"login",              MessageKind::LOGIN,              AuthPolicy::NONE,            ExecPolicy::DATABASE, 10},
+    {"auth",               MessageKind::AUTH,               AuthPolicy::NONE,            ExecPolicy::DATABASE,  5},
+    {"chat",               MessageKind::CHAT,               AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  1},
+    {"typing",             MessageKind::TYPING,             AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"get_online_users",   MessageKind::GET_ONLINE_USERS,   AuthPolicy::REQUIRED_SILENT, ExecPolicy::DATABASE, 10},
+    {"edit_message",       MessageKind::EDIT_MESSAGE,       AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"delete_message",     MessageKind::DELETE_MESSAGE,     AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"add_reaction",       MessageKind::ADD_REACTION,       AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"pin_message",        MessageKind::PIN_MESSAGE,        AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"unpin_message",      MessageKind::UNPIN_MESSAGE,      AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"reply_message",      MessageKind::REPLY_MESSAGE,      AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"create_room",        MessageKind::CREATE_ROOM,        AuthPolicy::REQUIRED,        ExecPolicy::DATABASE, 10},
+    {"join_room",          MessageKind::JOIN_ROOM,          AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"leave_room",         MessageKind::LEAVE_ROOM,         AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"get_rooms",          MessageKind::GET_ROOMS,          AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  5},
+    {"search_messages",    MessageKind::SEARCH_MESSAGES,    AuthPolicy::REQUIRED,        ExecPolicy::DATABASE, 20},
+    {"mark_read",          MessageKind::MARK_READ,          AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  1},
+    {"ping",               MessageKind::PING,               AuthPolicy::NONE,            ExecPolicy::LOOP,      1},
+    {"call_init",          MessageKind::CALL_INIT,          AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      1},
+    {"call_accept",        MessageKind::CALL_ACCEPT,        AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      1},
+    {"call_reject",        MessageKind::CALL_REJECT,        AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      1},
+    {"call_end",           MessageKind::CALL_END,           AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      1},
+    {"webrtc_offer",       MessageKind::WEBRTC_OFFER,       AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"webrtc_answer",      MessageKind::WEBRTC_ANSWER,      AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"webrtc_ice",         MessageKind::WEBRTC_ICE,         AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"presence_update",    MessageKind::PRESENCE_UPDATE,    AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"profile_update",     MessageKind::PROFILE_UPDATE,     AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  5},
+    {"change_password",    MessageKind::CHANGE_PASSWORD,    AuthPolicy::REQUIRED,        ExecPolicy::DATABASE, 20},
+    {"ai_request",         MessageKind::AI_REQUEST,         AuthPolicy::REQUIRED,        ExecPolicy::LOOP,     10},
+    {"poll_create",        MessageKind::POLL_CREATE,        AuthPolicy::REQUIRED_SILENT, ExecPolicy::DATABASE,  5},
+    {"poll_vote",          MessageKind::POLL_VOTE,          AuthPolicy::REQUIRED_SILENT, ExecPolicy::DATABASE,  2},
+    {"poll_close",         MessageKind::POLL_CLOSE,         AuthPolicy::REQUIRED_SILENT, ExecPolicy::DATABASE,  2},
+    {"get_room_polls",     MessageKind::GET_ROOM_POLLS,     AuthPolicy::REQUIRED_SILENT, ExecPolicy::DATABASE,  5},
+    {"game_invite",        MessageKind::GAME_INVITE,        AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"game_accept",        MessageKind::GAME_ACCEPT,        AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"game_reject",        MessageKind::GAME_REJECT,        AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"game_move",          MessageKind::GAME_MOVE,          AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"watch_create",       MessageKind::WATCH_CREATE,       AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"watch_sync",         MessageKind::WATCH_SYNC,         AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"watch_end",          MessageKind::WATCH_END,          AuthPolicy::REQUIRED_SILENT, ExecPolicy::LOOP,      1},
+    {"upload_init",        MessageKind::UPLOAD_INIT,        AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      5},
+    {"upload_chunk",       MessageKind::UPLOAD_CHUNK,       AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      0},
+    {"upload_finalize",    MessageKind::UPLOAD_FINALIZE,    AuthPolicy::REQUIRED,        ExecPolicy::LOOP,      1},
+    {"forward_message",    MessageKind::FORWARD_MESSAGE,    AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"user_block",         MessageKind::USER_BLOCK,         AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"user_unblock",       MessageKind::USER_UNBLOCK,       AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"get_blocked_users",  MessageKind::GET_BLOCKED_USERS,  AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  5},
+    {"kick_user",          MessageKind::KICK_USER,          AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"invite_user",        MessageKind::INVITE_USER,        AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  2},
+    {"chat_location",      MessageKind::CHAT_LOCATION,      AuthPolicy::REQUIRED,        ExecPolicy::DATABASE,  1},
+};
+
+namespace message_types {
+
+inline constexpr MessageTypeEntry kUnknown{"", MessageKind::UNKNOWN, AuthPolicy::NONE, ExecPolicy::LOOP, 1};
+inline constexpr size_t kTypeCount = sizeof(kMessageTypes) / sizeof(kMessageTypes[0]);
+inline constexpr size_t kTableSize = 256;  // Power of two, > 4x type count
+
+static_assert(kTypeCount < kTableSize, "Too many message types for the hash table");
+
+// Seeded FNV-1a with a final avalanche
+constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+constexpr size_t slot(std::string_view s, uint32_t seed) {
+    return hash(s, seed) & (kTableSize - 1);
+}
+
+constexpr bool isPerfect(uint32_t seed) {
+    std::array<bool, kTableSize> used{};
+    for (const auto& entry : kMessageTypes) {
+        size_t i = slot(entry.name, seed);
+        if (used[i]) {
+            return false;
+        }
+        used[i] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        if (isPerfect(seed)) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+inline constexpr uint32_t kSeed = findSeed();
+static_assert(kSeed != 0, "No collision-free seed found; grow kTableSize");
+
+// Slot -> index into kMessageTypes + 1 (0 = empty)
+constexpr std::array<uint8_t, kTableSize> buildTable() {
+    std::array<uint8_t, kTableSize> table{};
+    for (size_t i = 0; i < kTypeCount; i++) {
+        table[slot(kMessageTypes[i].name, kSeed)] = static_cast<uint8_t>(i + 1);
+    }
+    return table;
+}
+
+inline constexpr auto kTable = buildTable();
+
+} // namespace message_types
+
+/**
+ * Resolve a message type string
+ * @return Matching entry, or an entry with MessageKind::UNKNOWN
+ */
+constexpr const MessageTypeEntry& lookupMessageType(std::string_view type) {
+    using namespace message_types;
+    uint8_t index = kTable[slot(type, kSeed)];
+    if (index == 0 || kMessageTypes[index - 1].name != type) {
+        return kUnknown;
+    }
+    return kMessageTypes[index - 1];
+}
+
+// Position in kMessageTypes; kTypeCount for unknown types (per-type stats)
+constexpr size_t messageTypeIndex(const MessageTypeEntry& entry) {
+    return entry.kind == MessageKind::UNKNOWN
+        ? message_types::kTypeCount
+        : static_cast<size_t>(&entry - kMessageTypes);
+}
+
+static_assert(lookupMessageType("chat").kind == MessageKind::CHAT);
+static_assert(lookupMessageType("chat_location").kind == MessageKind::CHAT_LOCATION);
+static_assert(lookupMessageType("chat_").kind == MessageKind::UNKNOWN);
+
+#endif // MESSAGE_TYPES_H
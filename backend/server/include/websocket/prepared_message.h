@@ -0,0 +1,40 @@
+#ifndef PREPARED_MESSAGE_H
+#define PREPARED_MESSAGE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+namespace uWS { enum OpCode : unsigned char; }
+
+/**
+ * Prepared Message
+ *
+ * Immutable, ref-counted outbound message rendered once for any number of
+ * recipients: the JSON is serialized once and the same payload is handed
+ * to every socket's send() (uWS frames it, and applies permessage-deflate
+ * per socket, see CompressionPolicy).
+ *
+ * Share it as std::shared_ptr<const PreparedMessage> across loops.
+ */
+class PreparedMessage {
+public:
+    using Ptr = std::shared_ptr<const PreparedMessage>;
+
+    static Ptr create(std::string payload, uWS::OpCode opCode);
+    static Ptr create(std::string payload);  // TEXT
+    static Ptr create(const nlohmann::json& message);
+
+    std::string_view payload() const { return payload_; }
+
+    uWS::OpCode opCode() const { return opCode_; }
+
+private:
+    std::string payload_;
+    uWS::OpCode opCode_;
+
+    PreparedMessage() = default;
+};
+
+#endif // PREPARED_MESSAGE_H
@@ -0,0 +1,63 @@
+#ifndef PRESENCE_AGGREGATOR_H
+#define PRESENCE_AGGREGATOR_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Presence Aggregator
+ *
+ * Collects presence changes (connect, disconnect, client status) for a
+ * short window; flush() returns only the users whose status differs from
+ * what was last published. A user who connects and disconnects inside one
+ * window produces nothing, and N users reconnecting after a restart
+ * produce one batch instead of N broadcasts.
+ *
+ * Thread-safe (recorded from any loop, flushed from one timer).
+ */
+class PresenceAggregator {
+public:
+    struct Change {
+        std::string userId;
+        std::string username;
+        std::string status;  // "online", "offline", or a client status ("away", ...)
+    };
+
+    // First device of a user authenticated
+    void online(const std::string& userId, const std::string& username);
+
+    // Last device of a user disconnected
+    void offline(const std::string& userId, const std::string& username);
+
+    // Status chosen by the client (presence_update)
+    void setStatus(const std::string& userId, const std::string& username, const std::string& status);
+
+    // Whether a user has a live connection right now
+    using ConnectedCheck = std::function<bool(const std::string& userId)>;
+
+    /**
+     * Net changes since the previous flush, in first-recorded order.
+     * "offline" is rechecked with `connected`: a disconnect that raced a
+     * new device's auth does not publish a connected user as offline.
+     */
+    std::vector<Change> flush(const ConnectedCheck& connected);
+
+private:
+    struct Pending {
+        std::string username;
+        std::string status;
+        std::string publishedStatus;  // Status when the window opened
+    };
+
+    std::unordered_map<std::string, Pending> pending_;
+    std::vector<std::string> order_;  // userIds in first-recorded order
+    std::unordered_map<std::string, std::string> published_;  // userId -> status (absent = offline)
+    std::mutex mutex_;
+
+    void recordLocked(const std::string& userId, const std::string& username, const std::string& status);
+};
+
+#endif // PRESENCE_AGGREGATOR_H
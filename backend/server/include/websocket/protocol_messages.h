@@ -0,0 +1,72 @@
+#ifndef PROTOCOL_MESSAGES_H
+#define PROTOCOL_MESSAGES_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "websocket/json_writer.h"
+
+/**
+ * Protocol Messages
+ *
+ * Typed form of the hot outbound JSON messages, serialized with
+ * json_writer::toString(). Fields are views: fill a message and serialize
+ * it right away.
+ */
+
+// New message in a room or DM
+struct ChatMessage {
+    static constexpr std::string_view type = "chat";
+    std::string_view content;
+    std::string_view messageId;
+    const nlohmann::json* metadata = nullptr;  // File attachment, optional
+    std::string_view roomId;
+    int64_t timestamp = 0;  // Milliseconds
+    std::string_view userId;
+    std::string_view username;
+};
+JSON_MESSAGE(ChatMessage, content, messageId, metadata, roomId, timestamp, type, userId, username)
+
+struct TypingMessage {
+    static constexpr std::string_view type = "typing";
+    bool isTyping = false;
+    std::string_view userId;
+    std::string_view username;
+};
+JSON_MESSAGE(TypingMessage, isTyping, type, userId, username)
+
+struct ReactionAddedMessage {
+    static constexpr std::string_view type = "reaction_added";
+    std::string_view emoji;
+    std::string_view messageId;
+    std::string_view roomId;
+    std::string_view userId;
+    std::string_view username;
+};
+JSON_MESSAGE(ReactionAddedMessage, emoji, messageId, roomId, type, userId, username)
+
+struct MessageReadMessage {
+    static constexpr std::string_view type = "message_read";
+    std::string_view messageId;
+    std::string_view readBy;
+    std::string_view roomId;
+    int64_t timestamp = 0;  // Milliseconds
+    std::string_view username;
+};
+JSON_MESSAGE(MessageReadMessage, messageId, readBy, roomId, timestamp, type, username)
+
+// One user's status in a presence_batch
+struct PresenceEntry {
+    std::string_view status;
+    std::string_view userId;
+    std::string_view username;
+};
+JSON_MESSAGE(PresenceEntry, status, userId, username)
+
+struct PresenceBatchMessage {
+    static constexpr std::string_view type = "presence_batch";
+    std::vector<PresenceEntry> users;
+};
+JSON_MESSAGE(PresenceBatchMessage, type, users)
+
+#endif // PROTOCOL_MESSAGES_H
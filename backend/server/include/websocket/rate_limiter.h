@@ -0,0 +1,126 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "websocket/message_types.h"
+
+/**
+ * Inbound rate limits (WS_RATE_* in .env)
+ *
+ * Every message type has a cost in tokens (MessageTypeEntry::cost): cheap
+ * signaling costs 1, DB scans such as search_messages cost much more, so
+ * their sustained rate is rate / cost. A message must fit both the
+ * connection's bucket and the user's bucket (shared by all devices).
+ * Rejected messages draw from a strike bucket; a connection that empties
+ * it is disconnected. A rate of 0 disables that bucket.
+ */
+struct RateLimits {
+    double connectionRate = 20;   // Tokens per second per connection
+    double connectionBurst = 60;
+    double userRate = 40;         // Tokens per second across a user's connections
+    double userBurst = 120;
+    double strikeRate = 1;        // Rejections forgiven per second
+    double strikeBurst = 30;      // Rejections tolerated before disconnecting
+};
+
+/**
+ * Token bucket as GCRA: one "theoretical arrival time" instead of a token
+ * count and refill timestamp. A cost is admitted while the bucket's TAT,
+ * pushed forward by cost * interval, stays within `burst` of now.
+ */
+class TokenBucket {
+public:
+    struct Rate {
+        int64_t intervalNs = 0;   // Time to earn one token (0 = unlimited)
+        int64_t toleranceNs = 0;  // Burst, as time
+
+        static Rate of(double perSecond, double burst);
+    };
+
+    bool tryConsume(const Rate& rate, uint32_t cost, int64_t nowNs);
+
+    // Give back a cost just consumed (another bucket rejected the message)
+    void refund(const Rate& rate, uint32_t cost) { tat_ -= cost * rate.intervalNs; }
+
+private:
+    int64_t tat_ = 0;
+};
+
+// Same bucket for several loop threads (a user's devices): CAS, no lock
+class SharedTokenBucket {
+public:
+    bool tryConsume(const TokenBucket::Rate& rate, uint32_t cost, int64_t nowNs);
+
+private:
+    std::atomic<int64_t> tat_{0};
+};
+
+// Rate state of one connection (PerSocketData, its loop thread only)
+struct ConnectionRate {
+    TokenBucket requests;
+    TokenBucket strikes;
+    std::shared_ptr<SharedTokenBucket> user;  // Set once authenticated
+    int64_t lastReplyNs = 0;                  // Last "rate_limited" sent
+};
+
+/**
+ * Rate Limiter
+ *
+ * Checks are O(1) and lock-free: the connection buckets are plain fields
+ * of the socket and the user bucket is a CAS on one atomic. The mutex is
+ * only taken to look up a user's bucket, once per authentication.
+ */
+class RateLimiter {
+public:
+    enum class Verdict {
+        ALLOW,
+        THROTTLE,   // Drop the message
+        DISCONNECT  // Strike bucket empty: repeat offender
+    };
+
+    struct Stats {
+        uint64_t throttled = 0;
+        uint64_t disconnected = 0;
+        // Index of the type in kMessageTypes; kTypeCount = unknown types
+        std::array<uint64_t, message_types::kTypeCount + 1> throttledByType{};
+    };
+
+    explicit RateLimiter(const RateLimits& limits = RateLimits());
+
+    // Bucket shared by every connection of userId
+    std::shared_ptr<SharedTokenBucket> userBucket(const std::string& userId);
+
+    // Charge entry.cost to the connection (and its user); rejections are
+    // counted per type
+    Verdict check(ConnectionRate& rate, const MessageTypeEntry& entry, int64_t nowNs);
+
+    void recordDisconnect() { disconnected_.fetch_add(1, std::memory_order_relaxed); }
+
+    Stats stats() const;
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    TokenBucket::Rate connection_;
+    TokenBucket::Rate user_;
+    TokenBucket::Rate strike_;
+
+    std::mutex usersMutex_;
+    std::unordered_map<std::string, std::weak_ptr<SharedTokenBucket>> users_;
+    size_t lookupsSincePurge_ = 0;
+
+    std::array<std::atomic<uint64_t>, message_types::kTypeCount + 1> throttled_{};
+    std::atomic<uint64_t> disconnected_{0};
+};
+
+#endif // RATE_LIMITER_H
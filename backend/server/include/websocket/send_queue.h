@@ -0,0 +1,88 @@
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "websocket/prepared_message.h"
+
+/**
+ * Per-connection output limits (WS_SEND_* in .env)
+ *
+ * - Below highWatermark messages are written straight to the socket
+ * - At highWatermark the socket is congested: new messages queue here and
+ *   are written again once the socket drains below lowWatermark
+ * - Above hardLimit (socket buffer + queue) droppable messages are
+ *   discarded, and a socket that stays there for slowConsumerTimeout is
+ *   disconnected. Nothing is queued past twice the hard limit.
+ */
+struct SendLimits {
+    size_t lowWatermark = 64 * 1024;
+    size_t highWatermark = 256 * 1024;
+    size_t hardLimit = 4 * 1024 * 1024;
+    std::chrono::seconds slowConsumerTimeout{10};
+};
+
+/**
+ * How a queued message is treated while its socket is congested
+ */
+enum class MessageClass : uint8_t {
+    SIGNALING,  // Calls / WebRTC: written before anything else queued
+    CHAT,       // Everything else: kept, in order
+    DROPPABLE   // Typing, presence_batch, watch_sync...: newest per key replaces older
+};
+
+/**
+ * Send Queue
+ *
+ * Messages waiting for a congested socket. Signaling has its own lane so
+ * it overtakes queued chat; droppable messages are coalesced in place (one
+ * entry per key, e.g. one typing per user and room; queued presence_batch
+ * deltas are merged into one).
+ *
+ * Owned by the socket's PerSocketData, only touched from its loop thread.
+ */
+class SendQueue {
+public:
+    struct Entry {
+        PreparedMessage::Ptr message;
+        bool compress = false;
+    };
+
+    static MessageClass classify(std::string_view type);
+
+    /**
+     * Queue a message for a congested socket
+     * @param buffered bytes already buffered by the socket
+     * @return false if the message was dropped
+     */
+    bool push(const PreparedMessage::Ptr& message, bool compress, size_t buffered, const SendLimits& limits);
+
+    bool empty() const { return signaling_.empty() && ordered_.empty(); }
+    size_t bytes() const { return bytes_; }
+
+    // Next message to write (signaling first); only valid if !empty()
+    const Entry& front() const;
+    void pop();
+    void clear();
+
+private:
+    struct OrderedEntry {
+        Entry entry;
+        std::string coalesceKey;  // Empty for CHAT
+    };
+
+    std::deque<Entry> signaling_;
+    std::deque<OrderedEntry> ordered_;
+    uint64_t orderedFrontSeq_ = 0;  // Sequence number of ordered_.front()
+    std::unordered_map<std::string, uint64_t> coalesceIndex_;  // key -> sequence number
+    size_t bytes_ = 0;
+
+    static std::string coalesceKey(std::string_view payload, std::string_view type);
+    static PreparedMessage::Ptr mergePresenceBatches(std::string_view older, std::string_view newer);
+};
+
+#endif // SEND_QUEUE_H
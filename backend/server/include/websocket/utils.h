@@ -38,8 +38,7 @@ public:
     
     static std::string generateSessionId();
     static std::string getClientIp(uWS::HttpRequest* req);
-    static bool isRateLimited(const std::string& userId, int maxRequestsPerMinute = 60);
-    static void trackRequest(const std::string& userId);
+    // Rate limiting: see RateLimiter (websocket/rate_limiter.h)
 };
 
 /**
@@ -5,15 +5,39 @@
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <nlohmann/json.hpp>
 #include "pubsub/pubsub_broker.h"
 #include "auth/auth_manager.h"
 #include "handlers/webrtc_handler.h"
 #include "handlers/file_handler.h"
 #include "database/mysql_client.h"
+#include "database/db_executor.h"
+#include "ai/ai_scheduler.h"
+#include "websocket/connection_registry.h"
+#include "websocket/prepared_message.h"
+#include "websocket/message_trace.h"
+#include "websocket/loop_watchdog.h"
+#include "websocket/compression_policy.h"
+#include "websocket/send_queue.h"
+#include "websocket/presence_aggregator.h"
+#include "websocket/rate_limiter.h"
+#include "websocket/auth_admission.h"
+#include "websocket/bootstrap_snapshot.h"
 #include "../protocol_chatbox1.h"
 
 // Forward declarations
 class GeminiClient;
+struct MessageTypeEntry;
+struct SocketSession;
+struct BinaryMessage;
+class InboundMessage;
+namespace uWS { struct Loop; }
+struct us_timer_t;
 
 /**
  * WebSocket Server using uWebSockets
@@ -24,6 +48,9 @@ class GeminiClient;
  * - Integration with Pub/Sub broker
  * - Authentication via JWT tokens
  * - Per-connection state management
+ * - N event loops (one uWS::App per thread, SO_REUSEPORT on the same port)
+ * - Fan-out via uWS topics: "room:<id>", "user:<id>" and "broadcast"
+ *   (PubSubBroker stays the cross-node / extension hook)
  */
 class WebSocketServer {
 public:
@@ -34,9 +61,82 @@ public:
     
     ~WebSocketServer();
     
+    /**
+     * Number of event loop threads to run (0 = one per hardware core).
+     * Must be called before run().
+     */
+    void setEventLoopCount(unsigned count);
+    
+    /**
+     * permessage-deflate mode, threshold and excluded types.
+     * Must be called before run().
+     */
+    void setCompression(const CompressionSettings& settings);
+    
+    /**
+     * Per-connection watermarks and slow consumer timeout.
+     * Must be called before run().
+     */
+    void setSendLimits(const SendLimits& limits);
+    
+    /**
+     * How long presence changes are collected before one presence_batch
+     * goes out. Must be called before run().
+     */
+    void setPresenceWindow(std::chrono::milliseconds window);
+    
+    /**
+     * DB executor size: worker threads and queued task limit.
+     * Must be called before run().
+     */
+    void setDbExecutor(size_t workers, size_t queueLimit);
+    
+    /**
+     * AI scheduler size and admission limits.
+     * Must be called before run().
+     */
+    void setAiLimits(const AiScheduler::Limits& limits);
+    
+    /**
+     * Longest a frame may wait in its socket's cork batch when the loop
+     * iteration runs long (0 = write every frame immediately).
+     * Must be called before run().
+     */
+    void setCorkDeadline(std::chrono::microseconds deadline);
+    
+    /**
+     * Inbound token buckets per connection and per user.
+     * Must be called before run().
+     */
+    void setRateLimits(const RateLimits& limits);
+    
+    /**
+     * Pacing of auth/login (reconnect storms).
+     * Must be called before run().
+     */
+    void setAdmission(const AdmissionLimits& limits);
+    
+    /**
+     * How often the user directory is reloaded, and how long one rendered
+     * online_users reply is shared. Must be called before run().
+     */
+    void setBootstrapRefresh(std::chrono::seconds directory, std::chrono::milliseconds render);
+    
+    /**
+     * Chat latency tracing: sample rate and slow-message log threshold.
+     * Must be called before run().
+     */
+    void setTracing(const TraceSettings& settings);
+    
+    /**
+     * Event loop stall watchdog: report a loop that runs one iteration
+     * longer than `threshold` (0 = off). Must be called before run().
+     */
+    void setStallWatchdog(std::chrono::milliseconds threshold);
+    
     /**
      * Start the WebSocket server
-     * This is a blocking call
+     * This is a blocking call (returns when every event loop has exited)
      */
     void run();
     
@@ -54,11 +154,13 @@ public:
      * Broadcast message to all connected clients
      */
     void broadcast(const std::string& message);
+    void broadcast(const PreparedMessage::Ptr& message);
     
     /**
      * Broadcast to all users in a room (except excludeUserId)
      */
     void broadcastToRoom(const std::string& roomId, const std::string& message, const std::string& excludeUserId = "");
+    void broadcastToRoom(const std::string& roomId, const PreparedMessage::Ptr& message, const std::string& excludeUserId = "");
     
     /**
      * Send message to specific UserSession
@@ -69,24 +171,65 @@ public:
      * Send message to a specific user by userId
      */
     void sendToUser(const std::string& userId, const std::string& message);
+    void sendToUser(const std::string& userId, const PreparedMessage::Ptr& message);
     
 private:
-    // Connection state
-    struct ConnectionState {
-        std::string sessionId;
-        std::string userId;
-        std::string username;
-        std::string currentRoom;  // Currently joined room
-        bool authenticated;
-        uint64_t connectedAt;
-        void* wsPtr;  // WebSocket pointer for broadcasting
-        
-        ConnectionState() 
-            : authenticated(false), connectedAt(0), wsPtr(nullptr) {}
+    int port_;
+    std::atomic<bool> running_;
+    
+    // Event loops: each thread owns one uWS::App and the sockets it accepted
+    unsigned eventLoopCount_;
+    std::vector<std::thread> loopThreads_;
+    
+    // Running loops and their apps (uWS topics are per App, so a publish
+    // is posted to every loop). The mutex also orders publishes across loops.
+    struct LoopHandle {
+        uWS::Loop* loop;
+        void* app;  // uWS::App*
     };
+    std::vector<LoopHandle> loops_;
+    std::mutex loopsMutex_;
     
-    int port_;
-    bool running_;
+    // Outbound compression decision (read-only once the loops run)
+    CompressionPolicy compression_;
+    
+    // Backpressure limits applied to every socket
+    SendLimits sendLimits_;
+    
+    // Connect / disconnect / status changes, flushed every presenceWindow_
+    PresenceAggregator presence_;
+    std::chrono::milliseconds presenceWindow_{200};
+    
+    // Outbound corking: frames to a socket are batched until the loop
+    // iteration ends (or corkDeadline_ passes) and written with one send.
+    // Counters are summed over all loops for /health.
+    std::chrono::microseconds corkDeadline_{1000};
+    std::atomic<uint64_t> corkFrames_{0};
+    std::atomic<uint64_t> corkFlushes_{0};
+    std::atomic<uint64_t> corkDeadlineFlushes_{0};
+    
+    // Inbound flood protection (created by run())
+    std::unique_ptr<RateLimiter> rateLimiter_;
+    RateLimits rateLimits_;
+    
+    // auth/login pacing (created by run()) and the shared post-auth data
+    std::unique_ptr<AuthAdmission> admission_;
+    AdmissionLimits admissionLimits_;
+    BootstrapSnapshot bootstrap_;
+    std::chrono::seconds directoryRefresh_{30};
+    
+    // MySQL work from handlers (created by run())
+    std::unique_ptr<DbExecutor> dbExecutor_;
+    size_t dbWorkers_ = 4;
+    size_t dbQueueLimit_ = 10000;
+    
+    // Loop stall detection (created by run() unless the threshold is 0)
+    std::unique_ptr<LoopWatchdog> watchdog_;
+    std::chrono::milliseconds stallThreshold_{200};
+    
+    // Gemini calls (created by run() when geminiClient_ is set)
+    std::unique_ptr<AiScheduler> aiScheduler_;
+    AiScheduler::Limits aiLimits_;
     
     std::shared_ptr<PubSubBroker> broker_;
     std::shared_ptr<AuthManager> authManager_;
@@ -95,28 +238,136 @@ private:
     std::shared_ptr<FileHandler> fileHandler_;
     std::shared_ptr<MySQLClient> dbClient_;  // Database client shortcut
     
-    // WebSocket connections
-    // Store connections by void* since we use lambdas
-    std::unordered_map<void*, ConnectionState> connections_;
-    mutable std::mutex connectionsMutex_;
+    // WebSocket connections, indexed by socket, user, session and viewed room
+    ConnectionRegistry connections_;
+    
+    // Run one event loop (blocking); loopIndex 0 prints the startup banner
+    void runEventLoop(unsigned loopIndex);
+    
+    // Deliver to a connection owned by any loop. Sockets of other loops are
+    // only touched from their own thread via Loop::defer. With `ordered`, the
+    // local socket is deferred too, so every loop sees messages posted from
+    // registry visitors (which hold the registry lock) in the same order.
+    void deliver(const ConnectionState& state,
+                 const PreparedMessage::Ptr& message,
+                 bool ordered);
+    
+    // Publish to a uWS topic on every loop, skipping excludeUserId's sockets
+    void publish(const std::string& topic, const PreparedMessage::Ptr& message, const std::string& excludeUserId = "");
+    void publishLocal(void* app, const std::string& topic, const PreparedMessage::Ptr& message,
+                      const std::string& excludeUserId, bool compress);
+    
+    // Backpressure-aware send to a socket of the current loop: written now,
+    // or queued (per MessageClass) while the socket is congested
+    void sendQueued(void* ws, const PreparedMessage::Ptr& message, bool compress);
+    
+    // Write queued output until the socket is congested again (.drain)
+    void flushSendQueue(void* ws);
+    
+    // Add a frame to the socket's cork batch; uncork writes the batch now,
+    // flushCorked writes every batch of this loop (end of loop iteration)
+    void writeCorked(void* ws, const PreparedMessage::Ptr& message, bool compress);
+    void uncork(void* ws);
+    void flushCorked();
+    
+    // Per-loop timer: detect congestion from topic traffic, flush, and
+    // disconnect sockets stuck above the hard limit
+    void sweepSlowConsumers();
+    
+    // Publish pending presence as one presence_batch and store it in one UPDATE
+    void flushPresence();
+    
+    // Topic subscriptions: subscribeSocket runs on the socket's own loop after
+    // auth; setRoomSubscription updates every device of a user (any loop)
+    void subscribeSocket(void* ws, const std::string& userId);
+    void setRoomSubscription(const std::string& userId, const std::string& roomId, bool subscribed);
+    
+    // Rate limit of a message type; false = drop it (throttled or, for a
+    // repeat offender, the socket is being closed)
+    bool admit(void* ws, const MessageTypeEntry& entry);
+    
+    // DATABASE message held on the loop: a paced auth/login until its
+    // admission slot, or a later message of a socket whose auth is held
+    // (keeps its order). true = taken (held, or refused with retryAfterMs).
+    bool holdForAdmission(void* ws, const MessageTypeEntry& entry, nlohmann::json& msg);
+    
+    // Per-loop timer while messages are held: dispatch the due ones
+    void releaseHeldMessages();
+    static void onHeldTimer(us_timer_t* timer);
+    
+    // Reload the user directory on the DB executor (first loop's timer)
+    void refreshBootstrap();
+    
+    // Auth policy of a message type; false = drop it (error sent for REQUIRED)
+    bool authorize(void* ws, const MessageTypeEntry& entry, const SocketSession& session);
+    
+    // Dispatch one parsed message (auth policy + handler). Runs on the
+    // socket's loop, or on the DB executor for ExecPolicy::DATABASE types.
+    void handleMessage(void* ws, const MessageTypeEntry& entry, const nlohmann::json& msg);
+    
+    // Hot types (chat, typing, ping, ...) straight from the on-demand reader,
+    // without a document. false = not one of them: build the document and
+    // use handleMessage.
+    bool handleInbound(void* ws, const MessageTypeEntry& entry, InboundMessage& msg);
+    
+    // ChatBox1 BINARY frame (v1 PacketHeader or v2 compact header + payload),
+    // dispatched on msgType with the policies of the matching JSON type
+    // (no JSON parsing)
+    void handleBinaryFrame(void* ws, std::string_view frame);
+    void handleBinaryMessage(void* ws, const MessageTypeEntry& entry, const BinaryMessage& packet);
+    
+    // v2 MSG_INTERN from the client: assign a topic ID and announce it
+    void handleInternRequest(void* ws, std::string_view payload);
+    
+    // Queue a DATABASE message's handler on the DB executor (keyed by connection)
+    void runOnDbExecutor(void* ws, const MessageTypeEntry& entry, std::function<void()> handler);
+    
+    // From a DB task: post its session copy to the socket's loop if it changed
+    // since last posted (before any reply, and once more when the task ends)
+    void mirrorDbSession();
+    
+    // Run `action` on the socket's own loop (posted from a DB task, skipped
+    // if the socket closed in between)
+    void runOnSocketLoop(void* ws, std::function<void(void*)> action);
+    
+    // A socket as seen from another thread: captured on the loop or in a DB
+    // task, then used to post work back once it may have closed
+    struct SocketRef {
+        void* ws = nullptr;
+        uint64_t connectionId = 0;
+        uWS::Loop* loop = nullptr;
+    };
+    SocketRef socketRef(void* ws) const;
+    void postToSocket(const SocketRef& socket, std::function<void(void*)> action);
     
     // Protocol message handlers (templates need to be in header or explicit instantiation)
-    // We'll use type-erased helpers instead
-    void handleRegisterJson(void* ws, const std::string& jsonStr);
-    void handleLoginJson(void* ws, const std::string& jsonStr);
-    void handleChatMessageJson(void* ws, const std::string& jsonStr);
-    void handleTypingJson(void* ws, const std::string& jsonStr);
+    // We'll use type-erased helpers instead. Hot types are read on demand
+    // (handleInbound); these receive the document parsed once in .message.
+    void handleRegisterJson(void* ws, const nlohmann::json& msg);
+    void handleLoginJson(void* ws, const nlohmann::json& msg);
+    void handleChatMessageJson(void* ws, const nlohmann::json& msg);
     void handleGetOnlineUsersJson(void* ws);
-    void handleEditMessageJson(void* ws, const std::string& jsonStr);
-    void handleDeleteMessageJson(void* ws, const std::string& jsonStr);
-    void handleCreateRoomJson(void* ws, const std::string& jsonStr);
-    void handleJoinRoomJson(void* ws, const std::string& jsonStr);
-    void handleLeaveRoomJson(void* ws, const std::string& jsonStr);
+    void handleEditMessageJson(void* ws, const nlohmann::json& msg);
+    void handleDeleteMessageJson(void* ws, const nlohmann::json& msg);
+    void handleCreateRoomJson(void* ws, const nlohmann::json& msg);
+    void handleJoinRoomJson(void* ws, const nlohmann::json& msg);
+    void handleLeaveRoomJson(void* ws, const nlohmann::json& msg);
     void handleGetRoomsJson(void* ws);
-    void handleSearchMessagesJson(void* ws, const std::string& jsonStr);
-    void handleMarkReadJson(void* ws, const std::string& jsonStr);
+    void handleSearchMessagesJson(void* ws, const nlohmann::json& msg);
+    void handleMarkReadJson(void* ws, const nlohmann::json& msg);
+    
+    // Typed cores shared by the JSON handlers and the binary path
+    // (aiCommands = false: "@ai ..." is stored as plain chat, e.g. after the AI call failed)
+    void handleChatMessage(void* ws, const std::string& roomId, const std::string& content,
+                           const nlohmann::json& metadata, MessageTrace::Ptr trace = nullptr,
+                           bool aiCommands = true);
+    void handleTyping(void* ws, bool isTyping);
+    void handleReaction(void* ws, const std::string& messageId, const std::string& emoji,
+                        const std::string& roomId);
+    void handleMarkRead(void* ws, const std::string& messageId, const std::string& roomId);
     void sendErrorJson(void* ws, const std::string& error);
     void sendJsonMessage(void* ws, const std::string& jsonStr);
+    void sendJsonMessage(void* ws, const PreparedMessage::Ptr& message);
 };
 
 #endif // WEBSOCKET_SERVER_H
@@ -0,0 +1,138 @@
+#include "ai/ai_scheduler.h"
+#include "ai/gemini_client.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+#include <chrono>
+
+AiScheduler::AiScheduler(std::shared_ptr<GeminiClient> client, const Limits& limits)
+    : client_(std::move(client))
+    , limits_(limits) {
+    limits_.workers = std::max<size_t>(1, limits_.workers);
+    limits_.perUserInFlight = std::max<size_t>(1, limits_.perUserInFlight);
+    workers_.reserve(limits_.workers);
+    for (size_t i = 0; i < limits_.workers; i++) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+    Logger::info("✓ AI scheduler started (" + std::to_string(limits_.workers) + " workers, queue limit " +
+                 std::to_string(limits_.maxQueue) + ", " + std::to_string(limits_.perUserInFlight) + " per user)");
+}
+
+AiScheduler::~AiScheduler() {
+    stop();
+}
+
+AiScheduler::Admission AiScheduler::submit(const std::string& userId, std::string prompt, Completion done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || !client_) {
+            return Admission::UNAVAILABLE;
+        }
+        if (queue_.size() >= limits_.maxQueue) {
+            rejected_++;
+            return Admission::QUEUE_FULL;
+        }
+        size_t& userInFlight = inFlight_[userId];
+        if (userInFlight >= limits_.perUserInFlight) {
+            rejected_++;
+            return Admission::USER_LIMIT;
+        }
+        userInFlight++;
+        queue_.push_back(Request{userId, std::move(prompt), std::move(done)});
+    }
+    cv_.notify_one();
+    return Admission::ACCEPTED;
+}
+
+AiScheduler::Stats AiScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.workers = workers_.size();
+    stats.queueDepth = queue_.size();
+    stats.completed = completed_;
+    stats.failed = failed_;
+    stats.rejected = rejected_;
+    stats.avgRunMs = completed_ ? totalRunMs_ / completed_ : 0;
+    return stats;
+}
+
+void AiScheduler::stop() {
+    std::deque<Request> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        dropped.swap(queue_);
+        inFlight_.clear();
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (!dropped.empty()) {
+        Logger::warning("⚠️ AI scheduler stopped with " + std::to_string(dropped.size()) + " queued requests");
+    }
+}
+
+const char* AiScheduler::describe(Admission admission) {
+    switch (admission) {
+        case Admission::ACCEPTED:    return "Accepted";
+        case Admission::QUEUE_FULL:  return "AI service is busy, please try again shortly";
+        case Admission::USER_LIMIT:  return "Please wait for your previous AI request to finish";
+        case Admission::UNAVAILABLE: return "AI service not available";
+    }
+    return "AI service not available";
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+void AiScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (stopping_) {
+            return;
+        }
+
+        Request request = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+
+        auto startedAt = std::chrono::steady_clock::now();
+        std::optional<std::string> response;
+        try {
+            response = client_->sendMessage(request.prompt);
+        } catch (const std::exception& e) {
+            Logger::error("❌ AI request failed: " + std::string(e.what()));
+        }
+        double runMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startedAt).count();
+        bool failed = !response;
+
+        try {
+            request.done(std::move(response));
+        } catch (const std::exception& e) {
+            Logger::error("AI completion failed: " + std::string(e.what()));
+        }
+
+        lock.lock();
+        completed_++;
+        if (failed) {
+            failed_++;
+        }
+        totalRunMs_ += runMs;
+        releaseLocked(request.userId);
+    }
+}
+
+void AiScheduler::releaseLocked(const std::string& userId) {
+    auto it = inFlight_.find(userId);
+    if (it != inFlight_.end() && --it->second == 0) {
+        inFlight_.erase(it);
+    }
+}
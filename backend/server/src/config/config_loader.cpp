@@ -26,6 +26,46 @@ Config ConfigLoader::load(const std::string& envFile) {
     config.serverIP = getEnv(env, "SERVER_IP", "0.0.0.0");
     config.serverPort = getEnvInt(env, "SERVER_PORT", 8080);
     config.serverHost = getEnv(env, "SERVER_HOST", "0.0.0.0");
+    config.serverThreads = getEnvInt(env, "SERVER_THREADS", 1);
+    
+    // WebSocket compression
+    config.wsCompression = getEnv(env, "WS_COMPRESSION", "off");
+    config.wsCompressionWindowKb = getEnvInt(env, "WS_COMPRESSION_WINDOW_KB", 4);
+    config.wsCompressionThreshold = getEnvInt(env, "WS_COMPRESSION_THRESHOLD", 1024);
+    config.wsCompressionExclude = getEnv(env, "WS_COMPRESSION_EXCLUDE",
+                                         "webrtc_offer,webrtc_answer,webrtc_ice,typing,pong");
+    
+    // WebSocket backpressure
+    config.wsSendLowWatermarkKb = getEnvInt(env, "WS_SEND_LOW_WATERMARK_KB", 64);
+    config.wsSendHighWatermarkKb = getEnvInt(env, "WS_SEND_HIGH_WATERMARK_KB", 256);
+    config.wsSendHardLimitKb = getEnvInt(env, "WS_SEND_HARD_LIMIT_KB", 4096);
+    config.wsSlowConsumerTimeout = getEnvInt(env, "WS_SLOW_CONSUMER_TIMEOUT", 10);
+    config.wsPresenceWindowMs = getEnvInt(env, "WS_PRESENCE_WINDOW_MS", 200);
+    config.wsCorkDeadlineUs = getEnvInt(env, "WS_CORK_DEADLINE_US", 1000);
+    
+    // Inbound rate limits
+    config.wsRateConnection = getEnvInt(env, "WS_RATE_CONNECTION", 20);
+    config.wsRateConnectionBurst = getEnvInt(env, "WS_RATE_CONNECTION_BURST", 60);
+    config.wsRateUser = getEnvInt(env, "WS_RATE_USER", 40);
+    config.wsRateUserBurst = getEnvInt(env, "WS_RATE_USER_BURST", 120);
+    config.wsRateStrikes = getEnvInt(env, "WS_RATE_STRIKES", 30);
+    
+    // Reconnect storms
+    config.authAdmissionRate = getEnvInt(env, "AUTH_ADMISSION_RATE", 500);
+    config.authAdmissionMaxWaitMs = getEnvInt(env, "AUTH_ADMISSION_MAX_WAIT_MS", 5000);
+    config.bootstrapDirectoryRefreshS = getEnvInt(env, "BOOTSTRAP_DIRECTORY_REFRESH_S", 30);
+    config.bootstrapRenderMs = getEnvInt(env, "BOOTSTRAP_RENDER_MS", 1000);
+    
+    // Chat latency tracing
+    config.traceSampleEvery = getEnvInt(env, "TRACE_SAMPLE_EVERY", 100);
+    config.traceSlowMs = getEnvInt(env, "TRACE_SLOW_MS", 250);
+    
+    // Event loop stall watchdog
+    config.loopStallMs = getEnvInt(env, "LOOP_STALL_MS", 200);
+    
+    // Database executor
+    config.dbWorkers = getEnvInt(env, "DB_WORKERS", 4);
+    config.dbQueueLimit = getEnvInt(env, "DB_QUEUE_LIMIT", 10000);
     
     // JWT Configuration
     config.jwtSecret = getEnv(env, "JWT_SECRET");
@@ -33,6 +73,9 @@ Config ConfigLoader::load(const std::string& envFile) {
     
     // Gemini AI
     config.geminiApiKey = getEnv(env, "GEMINI_API_KEY");
+    config.aiWorkers = getEnvInt(env, "AI_WORKERS", 2);
+    config.aiQueueLimit = getEnvInt(env, "AI_QUEUE_LIMIT", 64);
+    config.aiMaxInFlightPerUser = getEnvInt(env, "AI_MAX_IN_FLIGHT_PER_USER", 2);
     
     // Debug
     config.debug = getEnvBool(env, "DEBUG", false);
@@ -0,0 +1,124 @@
+#include "database/db_executor.h"
+#include "utils/logger.h"
+
+#include <algorithm>
+
+DbExecutor::DbExecutor(size_t workerCount, size_t maxQueueDepth)
+    : maxQueueDepth_(maxQueueDepth) {
+    workerCount = std::max<size_t>(1, workerCount);
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+    Logger::info("✓ DB executor started (" + std::to_string(workerCount) + " workers, queue limit " +
+                 std::to_string(maxQueueDepth) + ")");
+}
+
+DbExecutor::~DbExecutor() {
+    stop();
+}
+
+bool DbExecutor::submit(uint64_t key, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queued_ >= maxQueueDepth_) {
+            rejected_++;
+            return false;
+        }
+
+        Task entry{key, std::move(task), std::chrono::steady_clock::now()};
+        queued_++;
+        peakDepth_ = std::max(peakDepth_, queued_);
+
+        if (key != 0) {
+            auto [it, idle] = strands_.try_emplace(key);
+            if (!idle) {
+                // Same connection already queued/running: wait behind it
+                it->second.push_back(std::move(entry));
+                return true;
+            }
+        }
+        ready_.push_back(std::move(entry));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+DbExecutor::Stats DbExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.workers = workers_.size();
+    stats.queueDepth = queued_;
+    stats.maxQueueDepth = peakDepth_;
+    stats.completed = completed_;
+    stats.rejected = rejected_;
+    stats.avgWaitMs = completed_ ? totalWaitMs_ / completed_ : 0;
+    stats.maxWaitMs = maxWaitMs_;
+    stats.avgRunMs = completed_ ? totalRunMs_ / completed_ : 0;
+    return stats;
+}
+
+void DbExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+void DbExecutor::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !ready_.empty(); });
+        if (ready_.empty()) {
+            return;  // Stopping and drained
+        }
+
+        Task task = std::move(ready_.front());
+        ready_.pop_front();
+        queued_--;
+
+        auto startedAt = std::chrono::steady_clock::now();
+        double waitMs = std::chrono::duration<double, std::milli>(startedAt - task.submittedAt).count();
+        totalWaitMs_ += waitMs;
+        maxWaitMs_ = std::max(maxWaitMs_, waitMs);
+
+        lock.unlock();
+        try {
+            task.run();
+        } catch (const std::exception& e) {
+            Logger::error("DB task failed: " + std::string(e.what()));
+        }
+        auto finishedAt = std::chrono::steady_clock::now();
+        lock.lock();
+
+        completed_++;
+        totalRunMs_ += std::chrono::duration<double, std::milli>(finishedAt - startedAt).count();
+
+        // Release the next task of this connection, if any
+        if (task.key != 0) {
+            auto it = strands_.find(task.key);
+            if (it != strands_.end()) {
+                if (it->second.empty()) {
+                    strands_.erase(it);
+                } else {
+                    ready_.push_back(std::move(it->second.front()));
+                    it->second.pop_front();
+                    cv_.notify_one();
+                }
+            }
+        }
+    }
+}
@@ -1,14 +1,32 @@
 #include "database/mysql_client.h"
 #include "utils/logger.h"
+#include "utils/logging.h"
 #include <mysqlx/xdevapi.h>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <functional>
 #include <algorithm>
+#include <stdexcept>
+#include <thread>
 
 // Real MySQL implementation using UserSession.sql() - cleaner than Table API
 
+// Latency of one data call (round trips included), chatbox_db_call_seconds{op}
+#define DB_CALL_TIMER(op) PERF_TIMER("chatbox_db_call_seconds", "op=\"" op "\"")
+
+// This thread's session, valid while owner / generation still match
+struct CachedSession {
+    const MySQLClient* owner = nullptr;
+    uint64_t generation = 0;
+    std::shared_ptr<mysqlx::Session> session;
+};
+static thread_local CachedSession cachedSession;
+
+// Unique across clients, so a client reallocated at the same address never
+// matches a stale cache entry
+static std::atomic<uint64_t> nextGeneration{1};
+
 MySQLClient::MySQLClient(const std::string& host,
                          const std::string& user,
                          const std::string& password,
@@ -25,16 +43,14 @@ MySQLClient::~MySQLClient() {
 
 bool MySQLClient::connect() {
     try {
-        // Create session using SessionSettings (proper mysqlx way)
-        mysqlx::SessionSettings settings(
-            mysqlx::SessionOption::HOST, host_,
-            mysqlx::SessionOption::PORT, port_,
-            mysqlx::SessionOption::USER, user_,
-            mysqlx::SessionOption::PWD, password_
-        );
-        
-        session_ = std::make_shared<mysqlx::Session>(settings);
-        session_->sql("USE " + database_).execute();
+        session_ = openSession();
+        uint64_t generation = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex_);
+            threadSessions_[std::this_thread::get_id()] = session_;
+            generation_.store(generation, std::memory_order_release);
+        }
+        cachedSession = CachedSession{this, generation, session_};
         
         // Migration: Check if avatar_url column exists
         try {
@@ -285,12 +301,62 @@ bool MySQLClient::connect() {
 
 void MySQLClient::disconnect() {
     if (session_) {
-        session_->close();
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        generation_.store(0, std::memory_order_release);
+        for (auto& [threadId, session] : threadSessions_) {
+            session->close();
+        }
+        threadSessions_.clear();
         session_ = nullptr;
         Logger::info("MySQL disconnected");
     }
 }
 
+std::shared_ptr<mysqlx::Session> MySQLClient::openSession() {
+    // Create session using SessionSettings (proper mysqlx way)
+    mysqlx::SessionSettings settings(
+        mysqlx::SessionOption::HOST, host_,
+        mysqlx::SessionOption::PORT, port_,
+        mysqlx::SessionOption::USER, user_,
+        mysqlx::SessionOption::PWD, password_
+    );
+    
+    auto session = std::make_shared<mysqlx::Session>(settings);
+    session->sql("USE " + database_).execute();
+    return session;
+}
+
+std::shared_ptr<mysqlx::Session> MySQLClient::getSession() {
+    if (!session_) {
+        return nullptr;
+    }
+    
+    // mysqlx::Session is not thread-safe: every thread (DB executor workers) gets its own
+    uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (cachedSession.owner == this && cachedSession.generation == generation) {
+        return cachedSession.session;
+    }
+    if (generation == 0) {
+        throw std::runtime_error("MySQL disconnected");
+    }
+    
+    // Connect + USE without the lock: a slow server only holds up this thread
+    auto session = openSession();
+    size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        if (generation_.load(std::memory_order_relaxed) != generation) {
+            session->close();  // Disconnected (or reconnected) meanwhile
+            throw std::runtime_error("MySQL disconnected");
+        }
+        threadSessions_[std::this_thread::get_id()] = session;
+        total = threadSessions_.size();
+    }
+    cachedSession = CachedSession{this, generation, session};
+    Logger::info("MySQL session opened for thread (" + std::to_string(total) + " total)");
+    return session;
+}
+
 bool MySQLClient::isConnected() const {
     return session_ != nullptr;
 }
@@ -309,9 +375,10 @@ std::string userStatusToString(UserStatus status) {
 
 // Users
 bool MySQLClient::createUser(const User& user) {
+    DB_CALL_TIMER("createUser");
     try {
         std::string statusStr = userStatusToString(user.status);
-        session_->sql("INSERT INTO users (user_id, username, email, password_hash, status, status_message, avatar_url) VALUES (?, ?, ?, ?, ?, ?, ?)")
+        getSession()->sql("INSERT INTO users (user_id, username, email, password_hash, status, status_message, avatar_url) VALUES (?, ?, ?, ?, ?, ?, ?)")
             .bind(user.userId, user.username, user.email, user.passwordHash, statusStr, user.statusMessage, user.avatarUrl)
             .execute();
         Logger::info("✓ User created: " + user.username);
@@ -323,8 +390,9 @@ bool MySQLClient::createUser(const User& user) {
 }
 
 std::optional<User> MySQLClient::getUser(const std::string& username) {
+    DB_CALL_TIMER("getUser");
     try {
-        auto result = session_->sql("SELECT user_id, username, email, password_hash, status, status_message, avatar_url FROM users WHERE username = ?")
+        auto result = getSession()->sql("SELECT user_id, username, email, password_hash, status, status_message, avatar_url FROM users WHERE username = ?")
             .bind(username).execute();
         auto row = result.fetchOne();
         if (!row) return std::nullopt;
@@ -355,8 +423,9 @@ std::optional<User> MySQLClient::getUser(const std::string& username) {
 }
 
 std::optional<User> MySQLClient::getUserById(const std::string& userId) {
+    DB_CALL_TIMER("getUserById");
     try {
-        auto result = session_->sql("SELECT user_id, username, email, password_hash, status, status_message, avatar_url FROM users WHERE user_id = ?")
+        auto result = getSession()->sql("SELECT user_id, username, email, password_hash, status, status_message, avatar_url FROM users WHERE user_id = ?")
             .bind(userId).execute();
         auto row = result.fetchOne();
         if (!row) return std::nullopt;
@@ -387,9 +456,10 @@ std::optional<User> MySQLClient::getUserById(const std::string& userId) {
 }
 
 std::vector<User> MySQLClient::getAllUsers() {
+    DB_CALL_TIMER("getAllUsers");
     std::vector<User> users;
     try {
-        auto result = session_->sql("SELECT user_id, username, email, status, status_message, avatar_url FROM users ORDER BY username")
+        auto result = getSession()->sql("SELECT user_id, username, email, status, status_message, avatar_url FROM users ORDER BY username")
             .execute();
         
         for (auto row : result) {
@@ -418,6 +488,7 @@ std::vector<User> MySQLClient::getAllUsers() {
 }
 
 bool MySQLClient::updateUserStatus(const std::string& userId, int status) {
+    DB_CALL_TIMER("updateUserStatus");
     try {
         // Convert int status to string enum value (database uses ENUM)
         std::string statusStr;
@@ -428,7 +499,7 @@ bool MySQLClient::updateUserStatus(const std::string& userId, int status) {
             case 0: 
             default: statusStr = "offline"; break;
         }
-        session_->sql("UPDATE users SET status = ? WHERE user_id = ?")
+        getSession()->sql("UPDATE users SET status = ? WHERE user_id = ?")
             .bind(statusStr, userId).execute();
         return true;
     } catch (const std::exception& e) {
@@ -437,9 +508,40 @@ bool MySQLClient::updateUserStatus(const std::string& userId, int status) {
     }
 }
 
+bool MySQLClient::updateUserStatuses(const std::vector<std::pair<std::string, std::string>>& statuses) {
+    DB_CALL_TIMER("updateUserStatuses");
+    if (statuses.empty()) {
+        return true;
+    }
+    try {
+        // UPDATE ... SET status = CASE user_id WHEN ? THEN ? ... END WHERE user_id IN (...)
+        std::string query = "UPDATE users SET status = CASE user_id";
+        std::string inList;
+        for (size_t i = 0; i < statuses.size(); i++) {
+            query += " WHEN ? THEN ?";
+            inList += (i == 0) ? "?" : ", ?";
+        }
+        query += " END WHERE user_id IN (" + inList + ")";
+        
+        auto statement = getSession()->sql(query);
+        for (const auto& [userId, status] : statuses) {
+            statement.bind(userId, status);
+        }
+        for (const auto& [userId, status] : statuses) {
+            statement.bind(userId);
+        }
+        statement.execute();
+        return true;
+    } catch (const std::exception& e) {
+        handleException(e, "updateUserStatuses");
+        return false;
+    }
+}
+
 bool MySQLClient::updateUserAvatar(const std::string& userId, const std::string& avatarUrl) {
+    DB_CALL_TIMER("updateUserAvatar");
     try {
-        session_->sql("UPDATE users SET avatar_url = ? WHERE user_id = ?")
+        getSession()->sql("UPDATE users SET avatar_url = ? WHERE user_id = ?")
             .bind(avatarUrl, userId).execute();
         Logger::info("Updated avatar for user: " + userId);
         return true;
@@ -450,8 +552,9 @@ bool MySQLClient::updateUserAvatar(const std::string& userId, const std::string&
 }
 
 bool MySQLClient::deleteUser(const std::string& userId) {
+    DB_CALL_TIMER("deleteUser");
     try {
-        session_->sql("DELETE FROM users WHERE user_id = ?")
+        getSession()->sql("DELETE FROM users WHERE user_id = ?")
             .bind(userId).execute();
         return true;
     } catch (const std::exception& e) {
@@ -462,8 +565,9 @@ bool MySQLClient::deleteUser(const std::string& userId) {
 
 // Sessions
 bool MySQLClient::createSession(const UserSession& UserSession) {
+    DB_CALL_TIMER("createSession");
     try {
-        session_->sql("INSERT INTO sessions (session_id, user_id, username, expires_at) VALUES (?, ?, ?, FROM_UNIXTIME(?))")
+        getSession()->sql("INSERT INTO sessions (session_id, user_id, username, expires_at) VALUES (?, ?, ?, FROM_UNIXTIME(?))")
             .bind(UserSession.sessionId, UserSession.userId, UserSession.username, UserSession.expiresAt).execute();
         Logger::info("✓ UserSession created: " + UserSession.sessionId);
         return true;
@@ -474,8 +578,9 @@ bool MySQLClient::createSession(const UserSession& UserSession) {
 }
 
 std::optional<UserSession> MySQLClient::getSession(const std::string& sessionId) {
+    DB_CALL_TIMER("getSession");
     try {
-        auto result = session_->sql("SELECT session_id, user_id, username, UNIX_TIMESTAMP(created_at), UNIX_TIMESTAMP(expires_at) FROM sessions WHERE session_id = ?")
+        auto result = getSession()->sql("SELECT session_id, user_id, username, UNIX_TIMESTAMP(created_at), UNIX_TIMESTAMP(expires_at) FROM sessions WHERE session_id = ?")
             .bind(sessionId).execute();
         auto row = result.fetchOne();
         if (!row) return std::nullopt;
@@ -494,9 +599,10 @@ std::optional<UserSession> MySQLClient::getSession(const std::string& sessionId)
 }
 
 std::vector<UserSession> MySQLClient::getUserSessions(const std::string& userId) {
+    DB_CALL_TIMER("getUserSessions");
     std::vector<UserSession> sessions;
     try {
-        auto result = session_->sql("SELECT session_id, user_id, username, UNIX_TIMESTAMP(created_at), UNIX_TIMESTAMP(expires_at) FROM sessions WHERE user_id = ?")
+        auto result = getSession()->sql("SELECT session_id, user_id, username, UNIX_TIMESTAMP(created_at), UNIX_TIMESTAMP(expires_at) FROM sessions WHERE user_id = ?")
             .bind(userId).execute();
         for (auto row : result) {
             UserSession sess;
@@ -514,8 +620,9 @@ std::vector<UserSession> MySQLClient::getUserSessions(const std::string& userId)
 }
 
 bool MySQLClient::updateSessionHeartbeat(const std::string& sessionId, uint64_t timestamp) {
+    DB_CALL_TIMER("updateSessionHeartbeat");
     try {
-        session_->sql("UPDATE sessions SET last_heartbeat = FROM_UNIXTIME(?) WHERE session_id = ?")
+        getSession()->sql("UPDATE sessions SET last_heartbeat = FROM_UNIXTIME(?) WHERE session_id = ?")
             .bind(timestamp, sessionId).execute();
         return true;
     } catch (const std::exception& e) {
@@ -525,8 +632,9 @@ bool MySQLClient::updateSessionHeartbeat(const std::string& sessionId, uint64_t
 }
 
 bool MySQLClient::deleteSession(const std::string& sessionId) {
+    DB_CALL_TIMER("deleteSession");
     try {
-        session_->sql("DELETE FROM sessions WHERE session_id = ?")
+        getSession()->sql("DELETE FROM sessions WHERE session_id = ?")
             .bind(sessionId).execute();
         return true;
     } catch (const std::exception& e) {
@@ -537,7 +645,8 @@ bool MySQLClient::deleteSession(const std::string& sessionId) {
 
 // Messages
 bool MySQLClient::createMessage(const Message& message) {
-    Logger::info("📝 START createMessage");
+    DB_CALL_TIMER("createMessage");
+    LOG_INFO_F("📝 START createMessage");
     
     if (!session_) {
         Logger::error("✗ MySQL session is NULL!");
@@ -545,42 +654,42 @@ bool MySQLClient::createMessage(const Message& message) {
     }
     
     try {
-        Logger::info("  Attempting to save message: " + message.messageId);
-        Logger::info("  Room: " + message.roomId + ", Sender: " + message.senderName + " (" + message.senderId + ")");
-        Logger::info("  Content: " + message.content);
-        Logger::info("  MessageType: " + std::to_string(message.messageType) + ", ReplyTo: " + message.replyToId);
+        LOG_INFO_F("  Attempting to save message: {}", message.messageId);
+        LOG_INFO_F("  Room: {}, Sender: {} ({})", message.roomId, message.senderName, message.senderId);
+        LOG_INFO_F("  Content: {}", message.content);
+        LOG_INFO_F("  MessageType: {}, ReplyTo: {}", message.messageType, message.replyToId);
         
     } catch(...) {
         Logger::error("Exception during logging!");
     }
     
     try {
-        Logger::info("📝 Preparing SQL statement...");
+        LOG_INFO_F("📝 Preparing SQL statement...");
         
         // Database has DEFAULT CURRENT_TIMESTAMP for created_at, so don't need to specify it
         // Include metadata column for file attachments
         // Use INSERT IGNORE to silently skip duplicate message IDs (can happen with frontend retries)
-        auto statement = session_->sql("INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, metadata) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+        auto statement = getSession()->sql("INSERT IGNORE INTO messages (message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, metadata) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
         
-        Logger::info("📝 Binding parameters...");
+        LOG_INFO_F("📝 Binding parameters...");
         statement.bind(message.messageId, message.roomId, message.senderId, message.senderName, 
                       message.content, message.messageType, message.replyToId.empty() ? "" : message.replyToId,
                       message.metadata.empty() ? mysqlx::nullvalue : mysqlx::Value(message.metadata));
         
-        Logger::info("📝 Executing INSERT...");
+        LOG_INFO_F("📝 Executing INSERT...");
         statement.execute();
         
-        Logger::info("✓ Message SQL executed successfully");
+        LOG_INFO_F("✓ Message SQL executed successfully");
         
         // Verify it was inserted
-        Logger::info("📝 Verifying insert...");
-        auto result = session_->sql("SELECT COUNT(*) FROM messages WHERE message_id = ?")
+        LOG_INFO_F("📝 Verifying insert...");
+        auto result = getSession()->sql("SELECT COUNT(*) FROM messages WHERE message_id = ?")
             .bind(message.messageId).execute();
         auto row = result.fetchOne();
         int count = row[0];
         
         if (count > 0) {
-            Logger::info("✓✓ Message VERIFIED in database (count=" + std::to_string(count) + ")");
+            LOG_INFO_F("✓✓ Message VERIFIED in database (count={})", count);
             return true;
         } else {
             Logger::error("✗ Message NOT found after insert!");
@@ -602,8 +711,9 @@ bool MySQLClient::createMessage(const Message& message) {
 }
 
 std::optional<Message> MySQLClient::getMessage(const std::string& messageId) {
+    DB_CALL_TIMER("getMessage");
     try {
-        auto result = session_->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE message_id = ?")
+        auto result = getSession()->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE message_id = ?")
             .bind(messageId).execute();
         auto row = result.fetchOne();
         if (!row) return std::nullopt;
@@ -635,9 +745,10 @@ std::optional<Message> MySQLClient::getMessage(const std::string& messageId) {
 }
 
 std::vector<Message> MySQLClient::getMessagesByRoom(const std::string& roomId, int limit) {
+    DB_CALL_TIMER("getMessagesByRoom");
     std::vector<Message> messages;
     try {
-        auto result = session_->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ?")
+        auto result = getSession()->sql("SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ?")
             .bind(roomId, limit).execute();
         
         for (auto row : result) {
@@ -671,11 +782,12 @@ std::vector<Message> MySQLClient::getMessagesByRoom(const std::string& roomId, i
 }
 
 std::vector<Message> MySQLClient::getRecentMessages(const std::string& roomId, int limit, int offset) {
+    DB_CALL_TIMER("getRecentMessages");
     std::vector<Message> messages;
     try {
         Logger::info("📚 Loading recent messages for room: " + roomId + " (limit=" + std::to_string(limit) + ", offset=" + std::to_string(offset) + ")");
         
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) "
             "FROM messages WHERE room_id = ? ORDER BY created_at DESC LIMIT ? OFFSET ?")
             .bind(roomId, limit, offset).execute();
@@ -717,11 +829,12 @@ std::vector<Message> MySQLClient::getRecentMessages(const std::string& roomId, i
 }
 
 std::vector<Message> MySQLClient::getMessageReplies(const std::string& messageId, int limit) {
+    DB_CALL_TIMER("getMessageReplies");
     std::vector<Message> replies;
     try {
         Logger::info("Loading replies for message: " + messageId);
         
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT message_id, room_id, sender_id, sender_name, content, COALESCE(message_type, 0), reply_to_id, UNIX_TIMESTAMP(created_at), CAST(metadata AS CHAR) "
             "FROM messages WHERE reply_to_id = ? ORDER BY created_at ASC LIMIT ?")
             .bind(messageId, limit).execute();
@@ -759,6 +872,7 @@ std::vector<Message> MySQLClient::getMessageReplies(const std::string& messageId
 }
 
 std::vector<Message> MySQLClient::searchMessages(const std::string& query, const std::string& roomId, int limit) {
+    DB_CALL_TIMER("searchMessages");
     std::vector<Message> results;
     try {
         Logger::info("Searching messages: '" + query + "' in room: " + (roomId.empty() ? "all" : roomId));
@@ -770,13 +884,13 @@ std::vector<Message> MySQLClient::searchMessages(const std::string& query, const
         mysqlx::SqlResult result;
         if (roomId.empty()) {
             // Search all rooms
-            result = session_->sql(
+            result = getSession()->sql(
                 "SELECT message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
                 "FROM messages WHERE content LIKE ? ORDER BY created_at DESC LIMIT ?"
             ).bind(searchPattern, limit).execute();
         } else {
             // Search specific room
-            result = session_->sql(
+            result = getSession()->sql(
                 "SELECT message_id, room_id, sender_id, sender_name, content, message_type, reply_to_id, UNIX_TIMESTAMP(created_at) "
                 "FROM messages WHERE room_id = ? AND content LIKE ? ORDER BY created_at DESC LIMIT ?"
             ).bind(roomId, searchPattern, limit).execute();
@@ -806,8 +920,9 @@ std::vector<Message> MySQLClient::searchMessages(const std::string& query, const
 }
 
 bool MySQLClient::deleteMessage(const std::string& messageId) {
+    DB_CALL_TIMER("deleteMessage");
     try {
-        session_->sql("DELETE FROM messages WHERE message_id = ?")
+        getSession()->sql("DELETE FROM messages WHERE message_id = ?")
             .bind(messageId).execute();
         return true;
     } catch (const std::exception& e) {
@@ -821,16 +936,18 @@ bool MySQLClient::deleteMessage(const std::string& messageId) {
 // ============================================================================
 
 bool MySQLClient::createRoom(const Room& room) {
+    DB_CALL_TIMER("createRoom");
     try {
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO rooms (room_id, name, creator_id, room_type, description) "
             "VALUES (?, ?, ?, 'public', '')"
         ).bind(room.roomId, room.name, room.creatorId).execute();
         
         // Also add creator as owner member
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO room_members (room_id, user_id, role) VALUES (?, ?, 'owner')"
         ).bind(room.roomId, room.creatorId).execute();
+        roomMembers_.createRoom(room.roomId, room.creatorId);
         
         Logger::info("✓ Room created: " + room.roomId + " (" + room.name + ")");
         return true;
@@ -841,8 +958,9 @@ bool MySQLClient::createRoom(const Room& room) {
 }
 
 std::optional<Room> MySQLClient::getRoom(const std::string& roomId) {
+    DB_CALL_TIMER("getRoom");
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT room_id, name, creator_id FROM rooms WHERE room_id = ?"
         ).bind(roomId).execute();
         
@@ -866,8 +984,9 @@ std::optional<Room> MySQLClient::getRoom(const std::string& roomId) {
 }
 
 bool MySQLClient::updateRoom(const Room& room) {
+    DB_CALL_TIMER("updateRoom");
     try {
-        session_->sql(
+        getSession()->sql(
             "UPDATE rooms SET name = ? WHERE room_id = ?"
         ).bind(room.name, room.roomId).execute();
         return true;
@@ -878,13 +997,15 @@ bool MySQLClient::updateRoom(const Room& room) {
 }
 
 bool MySQLClient::deleteRoom(const std::string& roomId) {
+    DB_CALL_TIMER("deleteRoom");
     try {
         // Delete members first (cascade should handle this, but being explicit)
-        session_->sql("DELETE FROM room_members WHERE room_id = ?").bind(roomId).execute();
+        getSession()->sql("DELETE FROM room_members WHERE room_id = ?").bind(roomId).execute();
         // Delete messages in room
-        session_->sql("DELETE FROM messages WHERE room_id = ?").bind(roomId).execute();
+        getSession()->sql("DELETE FROM messages WHERE room_id = ?").bind(roomId).execute();
         // Delete room
-        session_->sql("DELETE FROM rooms WHERE room_id = ?").bind(roomId).execute();
+        getSession()->sql("DELETE FROM rooms WHERE room_id = ?").bind(roomId).execute();
+        roomMembers_.eraseRoom(roomId);
         Logger::info("✓ Room deleted: " + roomId);
         return true;
     } catch (const std::exception& e) {
@@ -894,10 +1015,12 @@ bool MySQLClient::deleteRoom(const std::string& roomId) {
 }
 
 bool MySQLClient::addRoomMember(const std::string& roomId, const std::string& userId) {
+    DB_CALL_TIMER("addRoomMember");
     try {
-        session_->sql(
+        getSession()->sql(
             "INSERT IGNORE INTO room_members (room_id, user_id, role) VALUES (?, ?, 'member')"
         ).bind(roomId, userId).execute();
+        roomMembers_.addMemberIfAbsent(roomId, userId, "member");  // INSERT IGNORE keeps an existing role
         Logger::info("✓ User " + userId + " added to room " + roomId);
         return true;
     } catch (const std::exception& e) {
@@ -907,10 +1030,12 @@ bool MySQLClient::addRoomMember(const std::string& roomId, const std::string& us
 }
 
 bool MySQLClient::removeRoomMember(const std::string& roomId, const std::string& userId) {
+    DB_CALL_TIMER("removeRoomMember");
     try {
-        session_->sql(
+        getSession()->sql(
             "DELETE FROM room_members WHERE room_id = ? AND user_id = ?"
         ).bind(roomId, userId).execute();
+        roomMembers_.removeMember(roomId, userId);
         Logger::info("✓ User " + userId + " removed from room " + roomId);
         return true;
     } catch (const std::exception& e) {
@@ -920,19 +1045,62 @@ bool MySQLClient::removeRoomMember(const std::string& roomId, const std::string&
 }
 
 std::vector<std::string> MySQLClient::getRoomMembers(const std::string& roomId) {
-    std::vector<std::string> members;
+    auto members = getRoomMemberList(roomId);
+    return members ? *members : std::vector<std::string>();
+}
+
+RoomMemberCache::MemberList MySQLClient::getRoomMemberList(const std::string& roomId) {
+    if (auto members = roomMembers_.getMembers(roomId)) {
+        return members;
+    }
+    
+    // Cache miss: load the room (rows are returned even if the fill lost a race)
+    auto members = std::make_shared<std::vector<std::string>>();
+    if (auto rows = loadRoomMembers(roomId)) {
+        members->reserve(rows->size());
+        for (const auto& [userId, role] : *rows) {
+            members->push_back(userId);
+        }
+    }
+    return members;
+}
+
+std::vector<std::string> MySQLClient::getUserRoomIds(const std::string& userId) {
+    DB_CALL_TIMER("getUserRoomIds");
+    std::vector<std::string> roomIds;
     try {
-        auto result = session_->sql(
-            "SELECT user_id FROM room_members WHERE room_id = ?"
+        auto result = getSession()->sql(
+            "SELECT room_id FROM room_members WHERE user_id = ?"
+        ).bind(userId).execute();
+        
+        for (auto row : result) {
+            roomIds.push_back(row[0].get<std::string>());
+        }
+    } catch (const std::exception& e) {
+        handleException(e, "getUserRoomIds");
+    }
+    return roomIds;
+}
+
+std::optional<RoomMemberCache::MemberRows> MySQLClient::loadRoomMembers(const std::string& roomId) {
+    DB_CALL_TIMER("loadRoomMembers");
+    try {
+        uint64_t version = roomMembers_.version(roomId);
+        auto result = getSession()->sql(
+            "SELECT user_id, role FROM room_members WHERE room_id = ?"
         ).bind(roomId).execute();
         
+        RoomMemberCache::MemberRows rows;
         for (auto row : result) {
-            members.push_back(row[0].get<std::string>());
+            rows.emplace_back(row[0].get<std::string>(),
+                              row[1].isNull() ? std::string("member") : row[1].get<std::string>());
         }
+        roomMembers_.fill(roomId, rows, version);
+        return rows;
     } catch (const std::exception& e) {
-        handleException(e, "getRoomMembers");
+        handleException(e, "loadRoomMembers");
+        return std::nullopt;
     }
-    return members;
 }
 
 // ============================================================================
@@ -940,8 +1108,9 @@ std::vector<std::string> MySQLClient::getRoomMembers(const std::string& roomId)
 // ============================================================================
 
 bool MySQLClient::createFile(const FileInfo& file) {
+    DB_CALL_TIMER("createFile");
     try {
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO files (file_id, user_id, room_id, file_name, file_size, mime_type, storage_path) "
             "VALUES (?, ?, ?, ?, ?, ?, ?)"
         ).bind(file.fileId, file.userId, file.roomId, file.filename, (int64_t)file.fileSize, file.mimeType, file.s3Key).execute();
@@ -954,8 +1123,9 @@ bool MySQLClient::createFile(const FileInfo& file) {
 }
 
 std::optional<FileInfo> MySQLClient::getFile(const std::string& fileId) {
+    DB_CALL_TIMER("getFile");
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT file_id, user_id, room_id, file_name, file_size, mime_type, storage_path, UNIX_TIMESTAMP(uploaded_at) "
             "FROM files WHERE file_id = ?"
         ).bind(fileId).execute();
@@ -980,9 +1150,10 @@ std::optional<FileInfo> MySQLClient::getFile(const std::string& fileId) {
 }
 
 std::vector<FileInfo> MySQLClient::getRoomFiles(const std::string& roomId) {
+    DB_CALL_TIMER("getRoomFiles");
     std::vector<FileInfo> files;
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT file_id, user_id, room_id, file_name, file_size, mime_type, storage_path, UNIX_TIMESTAMP(uploaded_at) "
             "FROM files WHERE room_id = ? ORDER BY uploaded_at DESC"
         ).bind(roomId).execute();
@@ -1006,8 +1177,9 @@ std::vector<FileInfo> MySQLClient::getRoomFiles(const std::string& roomId) {
 }
 
 bool MySQLClient::deleteFile(const std::string& fileId) {
+    DB_CALL_TIMER("deleteFile");
     try {
-        session_->sql("DELETE FROM files WHERE file_id = ?").bind(fileId).execute();
+        getSession()->sql("DELETE FROM files WHERE file_id = ?").bind(fileId).execute();
         return true;
     } catch (const std::exception& e) {
         handleException(e, "deleteFile");
@@ -1020,12 +1192,14 @@ bool MySQLClient::deleteFile(const std::string& fileId) {
 // ============================================================================
 
 bool MySQLClient::setMemberRole(const std::string& roomId, const std::string& userId, const std::string& role) {
+    DB_CALL_TIMER("setMemberRole");
     try {
         // Use INSERT ON DUPLICATE KEY UPDATE for upsert
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO room_members (room_id, user_id, role) VALUES (?, ?, ?) "
             "ON DUPLICATE KEY UPDATE role = ?"
         ).bind(roomId, userId, role, role).execute();
+        roomMembers_.setMember(roomId, userId, role);
         
         Logger::info("Set role for " + userId + " in " + roomId + " to " + role);
         return true;
@@ -1036,20 +1210,19 @@ bool MySQLClient::setMemberRole(const std::string& roomId, const std::string& us
 }
 
 std::string MySQLClient::getMemberRole(const std::string& roomId, const std::string& userId) {
-    try {
-        auto result = session_->sql(
-            "SELECT role FROM room_members WHERE room_id = ? AND user_id = ?"
-        ).bind(roomId, userId).execute();
-        
-        auto row = result.fetchOne();
-        if (row) {
-            return row[0].get<std::string>();
+    auto role = roomMembers_.getRole(roomId, userId);
+    if (!role) {
+        role = "";
+        if (auto rows = loadRoomMembers(roomId)) {
+            for (const auto& [memberId, memberRole] : *rows) {
+                if (memberId == userId) {
+                    role = memberRole;
+                    break;
+                }
+            }
         }
-        return "member"; // Default role
-    } catch (const std::exception& e) {
-        handleException(e, "getMemberRole");
-        return "member";
     }
+    return role->empty() ? "member" : *role;  // Default role
 }
 
 bool MySQLClient::hasMemberPermission(const std::string& roomId, const std::string& userId, const std::string& action) {
@@ -1084,13 +1257,22 @@ bool MySQLClient::isRoomOwner(const std::string& roomId, const std::string& user
     return getMemberRole(roomId, userId) == "owner";
 }
 
+bool MySQLClient::isRoomMember(const std::string& roomId, const std::string& userId) {
+    if (auto role = roomMembers_.getRole(roomId, userId)) {
+        return !role->empty();
+    }
+    auto members = getRoomMemberList(roomId);
+    return std::find(members->begin(), members->end(), userId) != members->end();
+}
+
 // ============================================================================
 // PIN MESSAGES
 // ============================================================================
 
 bool MySQLClient::pinMessage(const std::string& roomId, const std::string& messageId) {
+    DB_CALL_TIMER("pinMessage");
     try {
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO pinned_messages (room_id, message_id, pinned_by) VALUES (?, ?, 'system') "
             "ON DUPLICATE KEY UPDATE pinned_at = CURRENT_TIMESTAMP"
         ).bind(roomId, messageId).execute();
@@ -1104,8 +1286,9 @@ bool MySQLClient::pinMessage(const std::string& roomId, const std::string& messa
 }
 
 bool MySQLClient::unpinMessage(const std::string& roomId, const std::string& messageId) {
+    DB_CALL_TIMER("unpinMessage");
     try {
-        session_->sql(
+        getSession()->sql(
             "DELETE FROM pinned_messages WHERE room_id = ? AND message_id = ?"
         ).bind(roomId, messageId).execute();
         
@@ -1118,9 +1301,10 @@ bool MySQLClient::unpinMessage(const std::string& roomId, const std::string& mes
 }
 
 std::vector<std::string> MySQLClient::getPinnedMessages(const std::string& roomId) {
+    DB_CALL_TIMER("getPinnedMessages");
     std::vector<std::string> pinnedIds;
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT message_id FROM pinned_messages WHERE room_id = ? ORDER BY pinned_at DESC"
         ).bind(roomId).execute();
         
@@ -1140,8 +1324,9 @@ std::vector<std::string> MySQLClient::getPinnedMessages(const std::string& roomI
 // ============================================================================
 
 bool MySQLClient::blockUser(const std::string& userId, const std::string& blockedUserId) {
+    DB_CALL_TIMER("blockUser");
     try {
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO blocked_users (user_id, blocked_user_id) VALUES (?, ?) "
             "ON DUPLICATE KEY UPDATE blocked_at = CURRENT_TIMESTAMP"
         ).bind(userId, blockedUserId).execute();
@@ -1155,8 +1340,9 @@ bool MySQLClient::blockUser(const std::string& userId, const std::string& blocke
 }
 
 bool MySQLClient::unblockUser(const std::string& userId, const std::string& blockedUserId) {
+    DB_CALL_TIMER("unblockUser");
     try {
-        session_->sql(
+        getSession()->sql(
             "DELETE FROM blocked_users WHERE user_id = ? AND blocked_user_id = ?"
         ).bind(userId, blockedUserId).execute();
         
@@ -1169,8 +1355,9 @@ bool MySQLClient::unblockUser(const std::string& userId, const std::string& bloc
 }
 
 bool MySQLClient::isUserBlocked(const std::string& userId, const std::string& targetUserId) {
+    DB_CALL_TIMER("isUserBlocked");
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT 1 FROM blocked_users WHERE user_id = ? AND blocked_user_id = ?"
         ).bind(userId, targetUserId).execute();
         
@@ -1182,9 +1369,10 @@ bool MySQLClient::isUserBlocked(const std::string& userId, const std::string& ta
 }
 
 std::vector<std::string> MySQLClient::getBlockedUsers(const std::string& userId) {
+    DB_CALL_TIMER("getBlockedUsers");
     std::vector<std::string> blockedIds;
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT blocked_user_id FROM blocked_users WHERE user_id = ?"
         ).bind(userId).execute();
         
@@ -1202,9 +1390,10 @@ std::vector<std::string> MySQLClient::getBlockedUsers(const std::string& userId)
 // ============== Polls ==============
 
 bool MySQLClient::createPoll(const Poll& poll) {
+    DB_CALL_TIMER("createPoll");
     try {
         // Insert poll
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO polls (poll_id, room_id, question, created_by, created_at, is_closed) "
             "VALUES (?, ?, ?, ?, ?, ?)"
         ).bind(poll.pollId, poll.roomId, poll.question, poll.createdBy, 
@@ -1212,7 +1401,7 @@ bool MySQLClient::createPoll(const Poll& poll) {
         
         // Insert options
         for (const auto& opt : poll.options) {
-            session_->sql(
+            getSession()->sql(
                 "INSERT INTO poll_options (option_id, poll_id, option_text, option_index) "
                 "VALUES (?, ?, ?, ?)"
             ).bind(opt.optionId, poll.pollId, opt.text, opt.index).execute();
@@ -1227,8 +1416,9 @@ bool MySQLClient::createPoll(const Poll& poll) {
 }
 
 std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
+    DB_CALL_TIMER("getPoll");
     try {
-        auto pollResult = session_->sql(
+        auto pollResult = getSession()->sql(
             "SELECT poll_id, room_id, question, created_by, created_at, is_closed "
             "FROM polls WHERE poll_id = ?"
         ).bind(pollId).execute();
@@ -1247,7 +1437,7 @@ std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
         poll.isClosed = row[5].get<int64_t>() != 0;
         
         // Get options with vote counts
-        auto optResult = session_->sql(
+        auto optResult = getSession()->sql(
             "SELECT o.option_id, o.option_text, o.option_index, "
             "COUNT(v.user_id) as vote_count "
             "FROM poll_options o "
@@ -1266,7 +1456,7 @@ std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
             opt.voteCount = static_cast<int>(optRow[3].get<int64_t>());
             
             // Get voters for this option
-            auto voterResult = session_->sql(
+            auto voterResult = getSession()->sql(
                 "SELECT user_id, username FROM poll_votes WHERE poll_id = ? AND option_id = ?"
             ).bind(pollId, opt.optionId).execute();
             
@@ -1287,6 +1477,7 @@ std::optional<Poll> MySQLClient::getPoll(const std::string& pollId) {
 }
 
 std::vector<Poll> MySQLClient::getRoomPolls(const std::string& roomId, bool activeOnly) {
+    DB_CALL_TIMER("getRoomPolls");
     std::vector<Poll> polls;
     try {
         std::string sql = "SELECT poll_id FROM polls WHERE room_id = ?";
@@ -1295,7 +1486,7 @@ std::vector<Poll> MySQLClient::getRoomPolls(const std::string& roomId, bool acti
         }
         sql += " ORDER BY created_at DESC";
         
-        auto result = session_->sql(sql).bind(roomId).execute();
+        auto result = getSession()->sql(sql).bind(roomId).execute();
         
         mysqlx::Row row;
         while ((row = result.fetchOne())) {
@@ -1314,9 +1505,10 @@ std::vector<Poll> MySQLClient::getRoomPolls(const std::string& roomId, bool acti
 }
 
 bool MySQLClient::votePoll(const PollVote& vote) {
+    DB_CALL_TIMER("votePoll");
     try {
         // Check if poll is closed
-        auto pollResult = session_->sql(
+        auto pollResult = getSession()->sql(
             "SELECT is_closed FROM polls WHERE poll_id = ?"
         ).bind(vote.pollId).execute();
         
@@ -1331,7 +1523,7 @@ bool MySQLClient::votePoll(const PollVote& vote) {
         }
         
         // Use REPLACE to update vote if user already voted (changes their vote)
-        session_->sql(
+        getSession()->sql(
             "REPLACE INTO poll_votes (poll_id, option_id, user_id, username) "
             "VALUES (?, ?, ?, ?)"
         ).bind(vote.pollId, vote.optionId, vote.userId, vote.username).execute();
@@ -1345,8 +1537,9 @@ bool MySQLClient::votePoll(const PollVote& vote) {
 }
 
 bool MySQLClient::closePoll(const std::string& pollId) {
+    DB_CALL_TIMER("closePoll");
     try {
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "UPDATE polls SET is_closed = 1 WHERE poll_id = ?"
         ).bind(pollId).execute();
         
@@ -1359,9 +1552,10 @@ bool MySQLClient::closePoll(const std::string& pollId) {
 }
 
 bool MySQLClient::deletePoll(const std::string& pollId) {
+    DB_CALL_TIMER("deletePoll");
     try {
         // CASCADE will delete options and votes
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "DELETE FROM polls WHERE poll_id = ?"
         ).bind(pollId).execute();
         
@@ -1376,6 +1570,7 @@ bool MySQLClient::deletePoll(const std::string& pollId) {
 // DM Conversations - Discord/Telegram style
 // Returns existing conversation_id or creates a new one
 std::string MySQLClient::getOrCreateDmConversation(const std::string& userId1, const std::string& userId2) {
+    DB_CALL_TIMER("getOrCreateDmConversation");
     try {
         // Sort user IDs for consistency (user1_id < user2_id)
         std::string smallerId = userId1 < userId2 ? userId1 : userId2;
@@ -1384,7 +1579,7 @@ std::string MySQLClient::getOrCreateDmConversation(const std::string& userId1, c
         Logger::info("🔍 getOrCreateDmConversation: " + smallerId + " <-> " + largerId);
         
         // First, try to find existing conversation
-        auto result = session_->sql(
+        auto result = getSession()->sql(
             "SELECT conversation_id FROM dm_conversations WHERE user1_id = ? AND user2_id = ?"
         ).bind(smallerId).bind(largerId).execute();
         
@@ -1407,7 +1602,7 @@ std::string MySQLClient::getOrCreateDmConversation(const std::string& userId1, c
         std::string newConversationId = ss.str();  // dm_ + 16 hex chars = 19 chars
         
         // Insert new conversation
-        session_->sql(
+        getSession()->sql(
             "INSERT INTO dm_conversations (conversation_id, user1_id, user2_id) VALUES (?, ?, ?)"
         ).bind(newConversationId).bind(smallerId).bind(largerId).execute();
         
@@ -0,0 +1,164 @@
+#include "database/room_member_cache.h"
+
+#include <functional>
+#include <mutex>
+
+RoomMemberCache::RoomMemberCache(size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1) {
+}
+
+RoomMemberCache::MemberList RoomMemberCache::getMembers(const std::string& roomId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return nullptr;
+    }
+    markRead(it->second);
+    return it->second.members;
+}
+
+std::optional<std::string> RoomMemberCache::getRole(const std::string& roomId, const std::string& userId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return std::nullopt;
+    }
+    markRead(it->second);
+    auto roleIt = it->second.roles.find(userId);
+    return roleIt != it->second.roles.end() ? roleIt->second : std::string();
+}
+
+uint64_t RoomMemberCache::version(const std::string& roomId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return versions_[stripe(roomId)];
+}
+
+void RoomMemberCache::fill(const std::string& roomId, const MemberRows& rows, uint64_t versionBefore) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (versions_[stripe(roomId)] != versionBefore) {
+        return;  // A write to this room raced with the query; next lookup reloads
+    }
+
+    RoomEntry& entry = insertLocked(roomId);
+    entry.roles.clear();
+    entry.roles.reserve(rows.size());
+    for (const auto& [userId, role] : rows) {
+        entry.roles[userId] = role;
+    }
+    rebuildMembers(entry);
+}
+
+void RoomMemberCache::setMember(const std::string& roomId, const std::string& userId, const std::string& role) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    touchLocked(roomId);
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;  // Not loaded: the next lookup reads it from the database
+    }
+    bool isNew = it->second.roles.find(userId) == it->second.roles.end();
+    it->second.roles[userId] = role;
+    if (isNew) {
+        rebuildMembers(it->second);
+    }
+}
+
+void RoomMemberCache::addMemberIfAbsent(const std::string& roomId, const std::string& userId, const std::string& role) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    touchLocked(roomId);
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;
+    }
+    if (it->second.roles.emplace(userId, role).second) {
+        rebuildMembers(it->second);
+    }
+}
+
+void RoomMemberCache::removeMember(const std::string& roomId, const std::string& userId) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    touchLocked(roomId);
+
+    auto it = rooms_.find(roomId);
+    if (it == rooms_.end()) {
+        return;
+    }
+    if (it->second.roles.erase(userId) > 0) {
+        rebuildMembers(it->second);
+    }
+}
+
+void RoomMemberCache::createRoom(const std::string& roomId, const std::string& ownerId) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    touchLocked(roomId);
+
+    // A new room's membership is fully known: just the owner
+    RoomEntry& entry = insertLocked(roomId);
+    entry.roles.clear();
+    entry.roles[ownerId] = "owner";
+    rebuildMembers(entry);
+}
+
+void RoomMemberCache::eraseRoom(const std::string& roomId) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    touchLocked(roomId);
+    rooms_.erase(roomId);
+}
+
+void RoomMemberCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto& version : versions_) {
+        version++;
+    }
+    rooms_.clear();
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+size_t RoomMemberCache::stripe(const std::string& roomId) {
+    return std::hash<std::string>{}(roomId) % kVersionStripes;
+}
+
+RoomMemberCache::RoomEntry& RoomMemberCache::insertLocked(const std::string& roomId) {
+    auto it = rooms_.find(roomId);
+    if (it != rooms_.end()) {
+        return it->second;
+    }
+
+    if (rooms_.size() >= capacity_) {
+        // Second chance: drop rooms not read since the last sweep, down to
+        // 3/4 full, so sweeps stay rare
+        size_t target = capacity_ - capacity_ / 4 - 1;
+        for (auto evict = rooms_.begin(); evict != rooms_.end() && rooms_.size() > target;) {
+            if (evict->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                ++evict;
+            } else {
+                evict = rooms_.erase(evict);
+            }
+        }
+        // Everything was in use: drop any
+        while (rooms_.size() > target) {
+            rooms_.erase(rooms_.begin());
+        }
+    }
+    return rooms_[roomId];  // Constructed in place (the atomic flag does not move)
+}
+
+void RoomMemberCache::markRead(const RoomEntry& entry) {
+    // Shared lock only: a relaxed flag, written once per sweep
+    if (!entry.referenced.load(std::memory_order_relaxed)) {
+        entry.referenced.store(true, std::memory_order_relaxed);
+    }
+}
+
+void RoomMemberCache::rebuildMembers(RoomEntry& entry) {
+    auto members = std::make_shared<std::vector<std::string>>();
+    members->reserve(entry.roles.size());
+    for (const auto& [userId, role] : entry.roles) {
+        members->push_back(userId);
+    }
+    entry.members = std::move(members);
+}
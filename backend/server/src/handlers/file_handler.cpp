@@ -1,8 +1,6 @@
 #include "handlers/file_handler.h"
 #include "pubsub/pubsub_broker.h"
 #include "utils/logger.h"
-#include "socket_data.h"
-#include <WebSocket.h>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -11,7 +9,6 @@
 #include <mutex>
 #include <unordered_map>
 
-using WebSocket = uWS::WebSocket<false, true, PerSocketData>;
 namespace fs = std::filesystem;
 
 // ============================================================================
@@ -120,12 +117,17 @@ void FileHandler::sendSuccess(void* wsPtr, uint8_t messageType, const void* payl
 }
 
 void FileHandler::sendError(void* wsPtr, uint8_t messageType, const std::string& error) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     nlohmann::json response = {
         {"type", "upload_error"},
         {"message", error}
     };
-    ws->send(response.dump(), uWS::OpCode::TEXT);
+    sendJson(wsPtr, response);
+}
+
+void FileHandler::sendJson(void* wsPtr, const nlohmann::json& message) {
+    if (sendCallback_) {
+        sendCallback_(wsPtr, PreparedMessage::create(message));
+    }
 }
 
 void FileHandler::sendPacket(void* wsPtr, const PacketHeader& header, const void* payload, size_t size) {
@@ -144,8 +146,6 @@ void FileHandler::handleUploadInit(void* wsPtr,
                      const nlohmann::json& data,
                      const std::string& userId,
                      const std::string& roomId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
-    
     try {
         // Parse request
         std::string uploadId = data.value("uploadId", generateFileId());
@@ -193,7 +193,7 @@ void FileHandler::handleUploadInit(void* wsPtr,
             {"totalChunks", totalChunks}
         };
 
-        ws->send(response.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, response);
 
     } catch (const std::exception& e) {
         Logger::error("Upload init failed: " + std::string(e.what()));
@@ -202,7 +202,7 @@ void FileHandler::handleUploadInit(void* wsPtr,
             {"type", "upload_error"},
             {"message", e.what()}
         };
-        ws->send(error.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, error);
     }
 }
 
@@ -213,14 +213,22 @@ void FileHandler::handleUploadInit(void* wsPtr,
 void FileHandler::handleUploadChunk(void* wsPtr,
                       const nlohmann::json& data,
                       const std::string& userId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
+    std::string uploadId = data.value("uploadId", "");
+    uint32_t chunkIndex = data.value("chunkIndex", 0);
+    std::string chunkData = data.value("chunkData", ""); // Base64 encoded
     
-    try {
-        std::string uploadId = data.value("uploadId", "");
-        uint32_t chunkIndex = data.value("chunkIndex", 0);
-        std::string chunkData = data.value("chunkData", ""); // Base64 encoded
-        uint32_t totalChunks = data.value("totalChunks", 1);
+    // Decode Base64 chunk
+    std::vector<uint8_t> chunkBytes = decodeBase64(chunkData);
+    handleUploadChunkData(wsPtr, uploadId, chunkIndex, chunkBytes.data(), chunkBytes.size(), userId);
+}
 
+void FileHandler::handleUploadChunkData(void* wsPtr,
+                          const std::string& uploadId,
+                          uint32_t chunkIndex,
+                          const uint8_t* bytes,
+                          size_t size,
+                          const std::string& userId) {
+    try {
         if (uploadId.empty()) {
             throw std::runtime_error("Missing uploadId");
         }
@@ -240,9 +248,7 @@ void FileHandler::handleUploadChunk(void* wsPtr,
                 throw std::runtime_error("Unauthorized upload");
             }
         }
-
-        // Decode Base64 chunk
-        std::vector<uint8_t> chunkBytes = decodeBase64(chunkData);
+        uint32_t totalChunks = session->totalChunks;
 
         // Save chunk to temp file
         std::string chunkPath = session->tempDir + "/chunk_" + std::to_string(chunkIndex);
@@ -250,7 +256,7 @@ void FileHandler::handleUploadChunk(void* wsPtr,
         if (!chunkFile) {
             throw std::runtime_error("Failed to create chunk file");
         }
-        chunkFile.write(reinterpret_cast<const char*>(chunkBytes.data()), chunkBytes.size());
+        chunkFile.write(reinterpret_cast<const char*>(bytes), size);
         chunkFile.close();
 
         // Update session
@@ -275,17 +281,17 @@ void FileHandler::handleUploadChunk(void* wsPtr,
             {"progress", progress}
         };
 
-        ws->send(response.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, response);
 
     } catch (const std::exception& e) {
         Logger::error("Upload chunk failed: " + std::string(e.what()));
         
         nlohmann::json error = {
             {"type", "upload_error"},
-            {"uploadId", data.value("uploadId", "")},
+            {"uploadId", uploadId},
             {"message", e.what()}
         };
-        ws->send(error.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, error);
     }
 }
 
@@ -296,7 +302,6 @@ void FileHandler::handleUploadChunk(void* wsPtr,
 void FileHandler::handleUploadFinalize(void* wsPtr,
                          const nlohmann::json& data,
                          const std::string& userId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     std::string uploadId = data.value("uploadId", "");
     
     try {
@@ -384,7 +389,7 @@ void FileHandler::handleUploadFinalize(void* wsPtr,
             {"isVoice", isVoiceMessage}
         };
 
-        ws->send(response.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, response);
 
         // Broadcast file to room
         broadcastFileMessage(session.roomId, fileId, session.fileName, 
@@ -409,7 +414,7 @@ void FileHandler::handleUploadFinalize(void* wsPtr,
             {"uploadId", uploadId},
             {"message", e.what()}
         };
-        ws->send(error.dump(), uWS::OpCode::TEXT);
+        sendJson(wsPtr, error);
     }
 }
 
@@ -454,11 +459,17 @@ void FileHandler::broadcastFileMessage(const std::string& roomId,
             }}
         };
 
-        // Broadcast to room via PubSub
+        // Render once, then deliver to the room's sockets
+        auto prepared = PreparedMessage::create(message);
+        if (roomBroadcastCallback_) {
+            roomBroadcastCallback_(roomId, prepared);
+        }
+        
+        // PubSub stays the extension hook (other nodes / services)
         if (broker_) {
-            broker_->publish(roomId, message.dump());
-            Logger::info("📢 Broadcasted " + msgType + " message to room: " + roomId);
+            broker_->publish(roomId, std::string(prepared->payload()));
         }
+        Logger::info("📢 Broadcasted " + msgType + " message to room: " + roomId);
 
     } catch (const std::exception& e) {
         Logger::error("Failed to broadcast file message: " + std::string(e.what()));
@@ -474,32 +485,28 @@ void FileHandler::handleFileUpload(void* wsPtr,
                       const std::vector<uint8_t>& fileData,
                       const std::string& userId,
                       const std::string& roomId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleFileUpload - Use HTTP /upload endpoint instead");
-    sendError(ws, 0, "Use HTTP /upload endpoint for file uploads");
+    sendError(wsPtr, 0, "Use HTTP /upload endpoint for file uploads");
 }
 
 void FileHandler::handleFileDownload(void* wsPtr,
                         const std::string& fileId,
                         const std::string& userId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleFileDownload - Use HTTP /uploads/:filename instead");
-    sendError(ws, 0, "Use HTTP /uploads/:filename for file downloads");
+    sendError(wsPtr, 0, "Use HTTP /uploads/:filename for file downloads");
 }
 
 void FileHandler::handleFileDelete(void* wsPtr,
                       const std::string& fileId,
                       const std::string& userId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleFileDelete not implemented");
-    sendError(ws, 0, "Not implemented");
+    sendError(wsPtr, 0, "Not implemented");
 }
 
 void FileHandler::handleFileList(void* wsPtr,
                     const std::string& roomId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleFileList not implemented");
-    sendError(ws, 0, "Not implemented");
+    sendError(wsPtr, 0, "Not implemented");
 }
 
 void FileHandler::handleRequestUploadUrl(void* wsPtr,
@@ -508,9 +515,8 @@ void FileHandler::handleRequestUploadUrl(void* wsPtr,
                             const std::string& contentType,
                             const std::string& userId,
                             const std::string& roomId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleRequestUploadUrl not implemented");
-    sendError(ws, 0, "Not implemented");
+    sendError(wsPtr, 0, "Not implemented");
 }
 
 void FileHandler::handleUploadNotify(void* wsPtr,
@@ -520,7 +526,6 @@ void FileHandler::handleUploadNotify(void* wsPtr,
                         const std::string& storedPath,
                         const std::string& userId,
                         const std::string& roomId) {
-    auto* ws = static_cast<WebSocket*>(wsPtr);
     Logger::info("FileHandler: handleUploadNotify not implemented");
-    sendError(ws, 0, "Not implemented");
+    sendError(wsPtr, 0, "Not implemented");
 }
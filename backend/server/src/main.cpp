@@ -2,6 +2,7 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <algorithm>
 #include <signal.h>
 #include "config/config_loader.h"
 #include "websocket/websocket_server.h"  // Re-enabled!
@@ -10,6 +11,7 @@
 #include "pubsub/pubsub_broker.h"
 #include "database/mysql_client.h"
 #include "utils/logger.h"
+#include "utils/crc32.h"
 
 using namespace std;
 
@@ -32,6 +34,11 @@ int main(int argc, char* argv[]) {
         // Load configuration
         Logger::info("Loading configuration...");
         Config config = ConfigLoader::load("../../config/.env");
+        if (auto level = Logger::parseLevel(config.logLevel)) {
+            Logger::setLevel(*level);
+        } else {
+            Logger::warning("⚠️ Unknown LOG_LEVEL '" + config.logLevel + "' - using info");
+        }
         
         // Initialize MySQL client
         // OVERRIDE: Port detection showed 33070 (X Protocol)
@@ -77,10 +84,65 @@ int main(int argc, char* argv[]) {
         // Create WebSocket server
         Logger::info("Starting WebSocket server on port " + to_string(config.serverPort) + "...");
         WebSocketServer server(config.serverPort, pubsubBroker, authManager, geminiClient);
+        server.setEventLoopCount(config.serverThreads < 0 ? 1 : static_cast<unsigned>(config.serverThreads));
+        
+        CompressionSettings compression;
+        auto compressionMode = CompressionPolicy::parseMode(config.wsCompression);
+        if (!compressionMode) {
+            Logger::warning("⚠️ Unknown WS_COMPRESSION '" + config.wsCompression + "' - compression disabled");
+        }
+        compression.mode = compressionMode.value_or(CompressionMode::OFF);
+        compression.windowKb = config.wsCompressionWindowKb;
+        compression.thresholdBytes = config.wsCompressionThreshold < 0 ? 0 : static_cast<size_t>(config.wsCompressionThreshold);
+        compression.excludedTypes = CompressionPolicy::parseTypeList(config.wsCompressionExclude);
+        server.setCompression(compression);
+        
+        SendLimits sendLimits;
+        sendLimits.lowWatermark = static_cast<size_t>(std::max(1, config.wsSendLowWatermarkKb)) * 1024;
+        sendLimits.highWatermark = std::max(sendLimits.lowWatermark, static_cast<size_t>(std::max(1, config.wsSendHighWatermarkKb)) * 1024);
+        sendLimits.hardLimit = std::max(sendLimits.highWatermark, static_cast<size_t>(std::max(1, config.wsSendHardLimitKb)) * 1024);
+        sendLimits.slowConsumerTimeout = chrono::seconds(std::max(1, config.wsSlowConsumerTimeout));
+        server.setSendLimits(sendLimits);
+        server.setPresenceWindow(chrono::milliseconds(std::max(10, config.wsPresenceWindowMs)));
+        server.setCorkDeadline(chrono::microseconds(std::max(0, config.wsCorkDeadlineUs)));
+        
+        RateLimits rateLimits;
+        rateLimits.connectionRate = std::max(0, config.wsRateConnection);
+        rateLimits.connectionBurst = std::max(1, config.wsRateConnectionBurst);
+        rateLimits.userRate = std::max(0, config.wsRateUser);
+        rateLimits.userBurst = std::max(1, config.wsRateUserBurst);
+        rateLimits.strikeBurst = std::max(1, config.wsRateStrikes);
+        server.setRateLimits(rateLimits);
+        
+        AdmissionLimits admission;
+        admission.ratePerSecond = std::max(0, config.authAdmissionRate);
+        admission.maxWait = chrono::milliseconds(std::max(0, config.authAdmissionMaxWaitMs));
+        server.setAdmission(admission);
+        server.setBootstrapRefresh(chrono::seconds(std::max(1, config.bootstrapDirectoryRefreshS)),
+                                   chrono::milliseconds(std::max(0, config.bootstrapRenderMs)));
+        
+        TraceSettings tracing;
+        tracing.sampleEvery = static_cast<uint32_t>(std::max(0, config.traceSampleEvery));
+        tracing.slowThreshold = chrono::milliseconds(std::max(0, config.traceSlowMs));
+        server.setTracing(tracing);
+        server.setStallWatchdog(chrono::milliseconds(std::max(0, config.loopStallMs)));
+        
+        server.setDbExecutor(static_cast<size_t>(std::max(1, config.dbWorkers)),
+                             static_cast<size_t>(std::max(1, config.dbQueueLimit)));
+        
+        AiScheduler::Limits aiLimits;
+        aiLimits.workers = static_cast<size_t>(std::max(1, config.aiWorkers));
+        aiLimits.maxQueue = static_cast<size_t>(std::max(1, config.aiQueueLimit));
+        aiLimits.perUserInFlight = static_cast<size_t>(std::max(1, config.aiMaxInFlightPerUser));
+        server.setAiLimits(aiLimits);
         
         Logger::info("=== ChatBox Server Started Successfully! ===");
         Logger::info("Server IP: " + config.serverIP);
         Logger::info("Port: " + to_string(config.serverPort));
+        Logger::info("Event loops: " + (config.serverThreads == 0 ? string("auto") : to_string(config.serverThreads)));
+        Logger::info("Compression: " + (compression.mode == CompressionMode::OFF ? string("off") : config.wsCompression +
+                     " (>= " + to_string(compression.thresholdBytes) + " bytes)"));
+        Logger::info("Packet CRC32: " + string(checksum::crc32Implementation()));
         Logger::info("WebSocket: ws://" + config.serverIP + ":" + to_string(config.serverPort));
         Logger::info("");
         Logger::info("✅ FULL WEBSOCKET SERVER RUNNING!");
@@ -92,10 +154,12 @@ int main(int argc, char* argv[]) {
         server.run();
         
         Logger::info("=== ChatBox Server Stopped ===");
+        Logger::flush();
         return 0;
         
     } catch (const exception& e) {
         Logger::error("Fatal error: " + string(e.what()));
+        Logger::flush();
         return 1;
     }
 }
@@ -0,0 +1,185 @@
+#include "protocol_chatbox1.h"
+#include "utils/crc32.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace ProtocolChatBox1 {
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+namespace {
+
+std::atomic<uint32_t> nextMessageId{1};
+
+void copyField(char* field, size_t size, const char* value) {
+    std::memset(field, 0, size);
+    if (value) {
+        std::strncpy(field, value, size - 1);
+    }
+}
+
+} // namespace
+
+uint32_t calculateChecksum(const void* data, size_t length) {
+    return checksum::crc32(data, length);
+}
+
+bool verifyPacket(const PacketHeader* header) {
+    // A v1 header carrying version 2 is the request to switch to v2
+    return header && (header->version == PROTOCOL_VERSION || header->version == PROTOCOL_VERSION_V2);
+}
+
+PacketHeader createHeader(MessageType type, const char* sender,
+                          const char* topic, uint32_t payloadLen) {
+    PacketHeader header{};
+    header.msgType = type;
+    header.payloadLength = payloadLen;
+    header.messageId = nextMessageId.fetch_add(1, std::memory_order_relaxed);
+    header.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header.version = PROTOCOL_VERSION;
+    header.flags = 0;
+    copyField(header.sender, sizeof(header.sender), sender);
+    copyField(header.topic, sizeof(header.topic), topic);
+    return header;
+}
+
+std::vector<uint8_t> serializePacket(const PacketHeader& header,
+                                     const void* payload, size_t payloadSize) {
+    PacketHeader out = header;
+    out.payloadLength = static_cast<uint32_t>(payloadSize);
+    out.checksum = calculateChecksum(payload, payloadSize);
+
+    std::vector<uint8_t> data(sizeof(PacketHeader) + payloadSize);
+    std::memcpy(data.data(), &out, sizeof(PacketHeader));
+    if (payloadSize > 0) {
+        std::memcpy(data.data() + sizeof(PacketHeader), payload, payloadSize);
+    }
+    return data;
+}
+
+bool deserializePacket(const std::vector<uint8_t>& data,
+                       PacketHeader& header, std::vector<uint8_t>& payload) {
+    std::string_view view;
+    if (!parsePacket(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()), header, view)) {
+        return false;
+    }
+    payload.assign(view.begin(), view.end());
+    return true;
+}
+
+bool parsePacket(std::string_view frame, PacketHeader& header, std::string_view& payload) {
+    if (frame.size() < sizeof(PacketHeader)) {
+        return false;
+    }
+    std::memcpy(&header, frame.data(), sizeof(PacketHeader));
+    if (!verifyPacket(&header) || header.payloadLength != frame.size() - sizeof(PacketHeader)) {
+        return false;
+    }
+
+    payload = frame.substr(sizeof(PacketHeader));
+    return calculateChecksum(payload.data(), payload.size()) == header.checksum;
+}
+
+std::string fieldString(const char* field, size_t size) {
+    size_t length = 0;
+    while (length < size && field[length] != '\0') {
+        length++;
+    }
+    return std::string(field, length);
+}
+
+std::string serializePacketV2(const PacketHeaderV2& header, std::string_view payload) {
+    std::string out;
+    out.reserve(16 + payload.size());
+    out.push_back(static_cast<char>(PROTOCOL_VERSION_V2));
+    appendVarint(out, header.msgType);
+    out.push_back(static_cast<char>(header.flags));
+    appendVarint(out, header.topicId);
+    appendVarint(out, payload.size());
+    out.append(payload);
+    if (header.flags & FLAG_CHECKSUM) {
+        uint32_t crc = calculateChecksum(payload.data(), payload.size());
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<char>(crc >> (8 * i)));
+        }
+    }
+    return out;
+}
+
+bool parsePacketV2(std::string_view frame, PacketHeaderV2& header, std::string_view& payload) {
+    if (frame.empty() || static_cast<uint8_t>(frame[0]) != PROTOCOL_VERSION_V2) {
+        return false;
+    }
+    frame.remove_prefix(1);
+
+    uint64_t msgType, topicId, length;
+    if (!readVarint(frame, msgType) || msgType > UINT32_MAX || frame.empty()) {
+        return false;
+    }
+    header.msgType = static_cast<uint32_t>(msgType);
+    header.flags = static_cast<uint8_t>(frame[0]);
+    frame.remove_prefix(1);
+    if (!readVarint(frame, topicId) || topicId > UINT32_MAX || !readVarint(frame, length)) {
+        return false;
+    }
+    header.topicId = static_cast<uint32_t>(topicId);
+
+    size_t trailer = (header.flags & FLAG_CHECKSUM) ? 4 : 0;
+    if (length > frame.size() || frame.size() - length != trailer) {
+        return false;
+    }
+    payload = frame.substr(0, length);
+    if (trailer) {
+        uint32_t crc = 0;
+        for (int i = 0; i < 4; i++) {
+            crc |= static_cast<uint32_t>(static_cast<uint8_t>(frame[length + i])) << (8 * i);
+        }
+        return calculateChecksum(payload.data(), payload.size()) == crc;
+    }
+    return true;
+}
+
+void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void appendString(std::string& out, std::string_view value) {
+    appendVarint(out, value.size());
+    out.append(value);
+}
+
+bool readVarint(std::string_view& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[0]);
+        in.remove_prefix(1);
+        if (shift == 63 && byte > 1) {
+            return false;  // Bits past 64
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;  // Truncated or longer than 10 bytes
+}
+
+bool readString(std::string_view& in, std::string_view& value) {
+    uint64_t length;
+    if (!readVarint(in, length) || length > in.size()) {
+        return false;
+    }
+    value = in.substr(0, length);
+    in.remove_prefix(length);
+    return true;
+}
+
+} // namespace ProtocolChatBox1
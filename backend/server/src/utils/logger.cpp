@@ -1,11 +1,380 @@
 #include "utils/logger.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 LogLevel Logger::currentLevel = LogLevel::Info;
 
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+namespace {
+
+constexpr size_t kRingBytes = 256 * 1024;             // Per thread
+constexpr size_t kMaxPayload = kRingBytes / 4;         // Longer messages are truncated
+constexpr size_t kWriteChunk = 64 * 1024;              // Flush the output buffer at this size
+constexpr auto kWriterIdle = std::chrono::milliseconds(5);
+
+std::atomic<int64_t> coarseNowMs{0};
+
+int64_t systemNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* levelLabel(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug:   return "\033[36m[DEBUG]\033[0m ";  // Cyan
+        case LogLevel::Info:    return "\033[32m[INFO]\033[0m ";   // Green
+        case LogLevel::Warning: return "\033[33m[WARN]\033[0m ";   // Yellow
+        case LogLevel::Error:   return "\033[31m[ERROR]\033[0m ";  // Red
+    }
+    return "[UNKNOWN] ";
+}
+
+void writeOut(const std::string& text) {
+    const char* data = text.data();
+    size_t left = text.size();
+    while (left > 0) {
+#ifdef _WIN32
+        int written = _write(1, data, static_cast<unsigned>(std::min<size_t>(left, 1 << 30)));
+#else
+        ssize_t written = ::write(STDOUT_FILENO, data, left);
+#endif
+        if (written <= 0) {
+            return;  // stdout gone: nothing sensible left to do
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+}
+
+// "YYYY-MM-DD HH:MM:SS.mmm ", local time; the seconds part is cached
+class TimestampFormatter {
+public:
+    void append(std::string& out, int64_t ms) {
+        int64_t seconds = ms / 1000;
+        if (seconds != cachedSecond_) {
+            std::time_t t = static_cast<std::time_t>(seconds);
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &t);
+#else
+            localtime_r(&t, &local);
+#endif
+            std::strftime(prefix_, sizeof(prefix_), "%Y-%m-%d %H:%M:%S", &local);
+            cachedSecond_ = seconds;
+        }
+        int millis = static_cast<int>(ms % 1000);
+        out.append(prefix_);
+        char tail[] = {'.', char('0' + millis / 100), char('0' + millis / 10 % 10), char('0' + millis % 10), ' '};
+        out.append(tail, sizeof(tail));
+    }
+
+private:
+    int64_t cachedSecond_ = -1;
+    char prefix_[32] = {};
+};
+
+/**
+ * Single-producer single-consumer byte ring of variable-size records.
+ * Positions only grow (offset = position % size); a record never wraps:
+ * when it does not fit before the end, a wrap marker fills the rest.
+ */
+class LogRing {
+public:
+    struct Header {
+        uint32_t size;     // Payload bytes, kWrapMarker = skip to the start
+        uint32_t level;
+        int64_t timeMs;
+    };
+    static_assert(sizeof(Header) == 16);
+    static constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+    struct Record {
+        int64_t timeMs;
+        LogLevel level;
+        std::string_view payload;
+    };
+
+    LogRing() : data_(new char[kRingBytes]) {}
+
+    // Producer: false = no room (dropped)
+    bool push(LogLevel level, int64_t timeMs, std::string_view payload) {
+        payload = payload.substr(0, kMaxPayload);
+        size_t total = align(sizeof(Header) + payload.size());
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t offset = head % kRingBytes;
+        size_t pad = offset + total > kRingBytes ? kRingBytes - offset : 0;
+
+        if (kRingBytes - (head - tail) < pad + total) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (pad) {
+            Header marker{kWrapMarker, 0, 0};
+            std::memcpy(data_.get() + offset, &marker, sizeof(marker));
+            head += pad;
+            offset = 0;
+        }
+        Header header{static_cast<uint32_t>(payload.size()), static_cast<uint32_t>(level), timeMs};
+        std::memcpy(data_.get() + offset, &header, sizeof(header));
+        std::memcpy(data_.get() + offset + sizeof(header), payload.data(), payload.size());
+        head_.store(head + total, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: records published so far (valid until release())
+    size_t collect(std::vector<Record>& out) {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (pos < head) {
+            Header header;
+            std::memcpy(&header, data_.get() + pos % kRingBytes, sizeof(header));
+            if (header.size == kWrapMarker) {
+                pos += kRingBytes - pos % kRingBytes;
+                continue;
+            }
+            out.push_back({header.timeMs, static_cast<LogLevel>(header.level),
+                           std::string_view(data_.get() + pos % kRingBytes + sizeof(Header), header.size)});
+            pos += align(sizeof(Header) + header.size);
+        }
+        return head;
+    }
+
+    // Consumer: give back everything before `position`
+    void release(size_t position) { tail_.store(position, std::memory_order_release); }
+
+    size_t head() const { return head_.load(std::memory_order_acquire); }
+    size_t tail() const { return tail_.load(std::memory_order_acquire); }
+    bool empty() const { return head() == tail(); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    std::atomic<bool> orphaned{false};  // Owning thread exited
+
+private:
+    std::unique_ptr<char[]> data_;
+    alignas(64) std::atomic<size_t> head_{0};  // Written by the producer
+    alignas(64) std::atomic<size_t> tail_{0};  // Written by the consumer
+    std::atomic<uint64_t> dropped_{0};
+
+    static size_t align(size_t bytes) { return (bytes + 15) & ~size_t(15); }
+};
+
+/**
+ * Rings of every logging thread and the writer thread draining them.
+ * Never destroyed (threads may log during static destruction); at exit
+ * the writer drains one last time and logging becomes synchronous.
+ */
+class LogBackend {
+public:
+    LogBackend() {
+        coarseNowMs.store(systemNowMs(), std::memory_order_relaxed);
+        writer_ = std::thread([this]() { run(); });
+        std::atexit([]() { instance().shutdown(); });
+    }
+
+    static LogBackend& instance() {
+        static LogBackend* backend = new LogBackend();
+        return *backend;
+    }
+
+    void log(LogLevel level, std::string_view message) {
+        if (stopped_.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(syncMutex_);
+            std::string line;
+            appendLine(line, {systemNowMs(), level, message});
+            writeOut(line);
+            written_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        threadRing().push(level, coarseNowMs.load(std::memory_order_relaxed), message);
+    }
+
+    void flush() {
+        if (stopped_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::vector<std::pair<std::shared_ptr<LogRing>, size_t>> targets;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            for (const auto& ring : rings_) {
+                targets.emplace_back(ring, ring->head());
+            }
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        for (const auto& [ring, head] : targets) {
+            while (ring->tail() < head && std::chrono::steady_clock::now() < deadline) {
+                wake_.notify_one();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    Logger::Stats stats() {
+        Logger::Stats stats;
+        stats.written = written_.load(std::memory_order_relaxed);
+        stats.dropped = droppedRetired_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        for (const auto& ring : rings_) {
+            stats.dropped += ring->dropped();
+        }
+        return stats;
+    }
+
+private:
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::thread writer_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+    std::mutex syncMutex_;  // Synchronous writes after shutdown
+
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> droppedRetired_{0};  // Drops of rings already removed
+    uint64_t droppedReported_ = 0;             // Writer thread only
+    TimestampFormatter timestamps_;            // Writer thread only
+
+    LogRing& threadRing() {
+        // Marks the ring orphaned when the thread exits; the writer drains
+        // and removes it
+        struct Handle {
+            std::shared_ptr<LogRing> ring;
+            ~Handle() {
+                if (ring) {
+                    ring->orphaned.store(true, std::memory_order_release);
+                }
+            }
+        };
+        thread_local Handle handle;
+        if (!handle.ring) {
+            handle.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            rings_.push_back(handle.ring);
+        }
+        return *handle.ring;
+    }
+
+    void appendLine(std::string& out, const LogRing::Record& record) {
+        timestamps_.append(out, record.timeMs);
+        out.append(levelLabel(record.level));
+        out.append(record.payload);
+        out.push_back('\n');
+    }
+
+    void run() {
+        std::string out;
+        out.reserve(kWriteChunk * 2);
+        std::vector<LogRing::Record> records;
+        std::vector<std::pair<LogRing*, size_t>> drained;
+        std::vector<std::shared_ptr<LogRing>> rings;
+
+        while (true) {
+            coarseNowMs.store(systemNowMs(), std::memory_order_relaxed);
+            bool stopping = stopping_.load(std::memory_order_acquire);
+
+            {
+                std::lock_guard<std::mutex> lock(ringsMutex_);
+                rings = rings_;
+            }
+            records.clear();
+            drained.clear();
+            for (const auto& ring : rings) {
+                drained.emplace_back(ring.get(), ring->collect(records));
+            }
+
+            // Threads' records interleaved by time (each ring is in order already)
+            std::stable_sort(records.begin(), records.end(),
+                             [](const LogRing::Record& a, const LogRing::Record& b) { return a.timeMs < b.timeMs; });
+            for (const auto& record : records) {
+                appendLine(out, record);
+                if (out.size() >= kWriteChunk) {
+                    writeOut(out);
+                    out.clear();
+                }
+            }
+            uint64_t dropped = stats().dropped;
+            if (dropped > droppedReported_) {
+                appendLine(out, {coarseNowMs.load(std::memory_order_relaxed), LogLevel::Warning,
+                                 "⚠️ Logger dropped " + std::to_string(dropped - droppedReported_) +
+                                 " records (ring buffer full)"});
+                droppedReported_ = dropped;
+            }
+            writeOut(out);
+            out.clear();
+            for (const auto& [ring, position] : drained) {
+                ring->release(position);
+            }
+            written_.fetch_add(records.size(), std::memory_order_relaxed);
+            retireOrphans();
+
+            if (stopping) {
+                return;
+            }
+            if (records.empty()) {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wake_.wait_for(lock, kWriterIdle);
+            }
+        }
+    }
+
+    void retireOrphans() {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        auto retired = std::remove_if(rings_.begin(), rings_.end(), [this](const std::shared_ptr<LogRing>& ring) {
+            if (ring->orphaned.load(std::memory_order_acquire) && ring->empty()) {
+                droppedRetired_.fetch_add(ring->dropped(), std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        });
+        rings_.erase(retired, rings_.end());
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            stopping_.store(true, std::memory_order_release);
+        }
+        wake_.notify_one();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+        stopped_.store(true, std::memory_order_release);
+    }
+};
+
+} // namespace
+
 void Logger::setLevel(LogLevel level) {
     currentLevel = level;
 }
 
+std::optional<LogLevel> Logger::parseLevel(std::string_view name) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warning" || name == "warn") return LogLevel::Warning;
+    if (name == "error") return LogLevel::Error;
+    return std::nullopt;
+}
+
 void Logger::debug(const std::string& message) {
     log(LogLevel::Debug, message);
 }
@@ -22,48 +391,21 @@ void Logger::error(const std::string& message) {
     log(LogLevel::Error, message);
 }
 
-void Logger::log(LogLevel level, const std::string& message) {
+void Logger::log(LogLevel level, std::string_view message) {
     if (level < currentLevel) {
         return;
     }
-    
-    std::string timestamp = getCurrentTimestamp();
-    std::string levelStr = levelToString(level);
-    
-    // Color codes
-    const char* color = "";
-    const char* reset = "\033[0m";
-    
-    switch (level) {
-        case LogLevel::Debug:   color = "\033[36m"; break;  // Cyan
-        case LogLevel::Info:    color = "\033[32m"; break;  // Green
-        case LogLevel::Warning: color = "\033[33m"; break;  // Yellow
-        case LogLevel::Error:   color = "\033[31m"; break;  // Red
-    }
-    
-    std::cout << timestamp << " " << color << "[" << levelStr << "]" << reset 
-              << " " << message << std::endl;
+    LogBackend::instance().log(level, message);
 }
 
-std::string Logger::getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    
-    return ss.str();
+void Logger::tick() {
+    coarseNowMs.store(systemNowMs(), std::memory_order_relaxed);
 }
 
-std::string Logger::levelToString(LogLevel level) {
-    switch (level) {
-        case LogLevel::Debug:   return "DEBUG";
-        case LogLevel::Info:    return "INFO";
-        case LogLevel::Warning: return "WARN";
-        case LogLevel::Error:   return "ERROR";
-        default:                return "UNKNOWN";
-    }
+void Logger::flush() {
+    LogBackend::instance().flush();
+}
+
+Logger::Stats Logger::stats() {
+    return LogBackend::instance().stats();
 }
@@ -0,0 +1,406 @@
+#include "utils/logging.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace chatbox {
+namespace logging {
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+namespace {
+
+constexpr size_t kMaxHistograms = 512;
+constexpr size_t kMaxCounters = 256;
+
+// Log-linear buckets: values 0-7 exact, then 8 sub-buckets per power of two
+constexpr int kSubBucketBits = 3;
+constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+// Index of the highest set bit (value != 0)
+int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+size_t bucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    int exponent = highestBit(value);
+    size_t sub = static_cast<size_t>(value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>(exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+// Smallest value that lands in bucket `index`, and how many values do
+uint64_t bucketLower(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int exponent = static_cast<int>(index / kSubBuckets) + kSubBucketBits - 1;
+    return (kSubBuckets + index % kSubBuckets) << (exponent - kSubBucketBits);
+}
+
+uint64_t bucketWidth(size_t index) {
+    if (index < kSubBuckets) {
+        return 1;
+    }
+    int exponent = static_cast<int>(index / kSubBuckets) + kSubBucketBits - 1;
+    return uint64_t(1) << (exponent - kSubBucketBits);
+}
+
+// One thread's values of one histogram
+struct HistogramCells {
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+};
+
+// Single writer (the owning thread): increments are a relaxed load + store
+inline void bump(std::atomic<uint64_t>& cell, uint64_t value) {
+    cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct Shard {
+    std::array<std::atomic<HistogramCells*>, kMaxHistograms> histograms{};
+    std::array<std::atomic<uint64_t>, kMaxCounters> counters{};
+
+    ~Shard() {
+        for (auto& cells : histograms) {
+            delete cells.load(std::memory_order_relaxed);
+        }
+    }
+
+    HistogramCells& cells(uint32_t id) {
+        HistogramCells* cells = histograms[id].load(std::memory_order_relaxed);
+        if (!cells) {
+            cells = new HistogramCells();
+            histograms[id].store(cells, std::memory_order_release);
+        }
+        return *cells;
+    }
+
+    // Add another shard's values (registry mutex held)
+    void absorb(const Shard& other) {
+        for (size_t id = 0; id < kMaxHistograms; id++) {
+            HistogramCells* from = other.histograms[id].load(std::memory_order_acquire);
+            if (!from) {
+                continue;
+            }
+            HistogramCells& to = cells(static_cast<uint32_t>(id));
+            for (size_t b = 0; b < kBuckets; b++) {
+                bump(to.buckets[b], from->buckets[b].load(std::memory_order_relaxed));
+            }
+            bump(to.sum, from->sum.load(std::memory_order_relaxed));
+        }
+        for (size_t id = 0; id < kMaxCounters; id++) {
+            bump(counters[id], other.counters[id].load(std::memory_order_relaxed));
+        }
+    }
+};
+
+struct MetricInfo {
+    std::string name;
+    std::string labels;
+    PerformanceMonitor::Unit unit;
+};
+
+/**
+ * Metric names and every thread's shard. Never destroyed: threads may
+ * record during static destruction.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::vector<MetricInfo> histogramInfo;
+    std::vector<MetricInfo> counterInfo;
+    std::deque<PerformanceMonitor::Histogram> histograms;  // Stable addresses
+    std::deque<PerformanceMonitor::Counter> counters;
+    std::unordered_map<std::string, size_t> histogramIds;  // name{labels} -> index
+    std::unordered_map<std::string, size_t> counterIds;
+    std::map<std::string, double> gauges;
+
+    std::vector<Shard*> shards;  // Live threads
+    Shard retired;               // Threads that exited
+
+    static Registry& instance() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+};
+
+Shard& threadShard() {
+    // Folded into Registry::retired when the thread exits
+    struct Handle {
+        Shard* shard = nullptr;
+        ~Handle() {
+            if (!shard) {
+                return;
+            }
+            Registry& registry = Registry::instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.retired.absorb(*shard);
+            registry.shards.erase(std::find(registry.shards.begin(), registry.shards.end(), shard));
+            delete shard;
+        }
+    };
+    thread_local Handle handle;
+    if (!handle.shard) {
+        handle.shard = new Shard();
+        Registry& registry = Registry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.shards.push_back(handle.shard);
+    }
+    return *handle.shard;
+}
+
+std::string metricKey(const std::string& name, const std::string& labels) {
+    return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+// Exported `le` bounds, in recorded units (nanoseconds for SECONDS)
+const std::vector<uint64_t>& exportBounds(PerformanceMonitor::Unit unit) {
+    static const std::vector<uint64_t> seconds = {
+        1'000, 2'500, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000,
+        1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000,
+        100'000'000, 250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000};
+    static const std::vector<uint64_t> values = {
+        1, 2, 5, 10, 20, 50, 100, 200, 500, 1'000, 2'000, 5'000, 10'000, 20'000, 50'000,
+        100'000, 200'000, 500'000, 1'000'000, 10'000'000};
+    return unit == PerformanceMonitor::Unit::SECONDS ? seconds : values;
+}
+
+std::string formatNumber(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+// `le="..."` label of every exported bound, formatted once
+const std::vector<std::string>& exportBoundLabels(PerformanceMonitor::Unit unit) {
+    auto build = [](PerformanceMonitor::Unit unit) {
+        double scale = unit == PerformanceMonitor::Unit::SECONDS ? 1e-9 : 1.0;
+        std::vector<std::string> labels;
+        for (uint64_t bound : exportBounds(unit)) {
+            labels.push_back("le=\"" + formatNumber(bound * scale) + "\"");
+        }
+        return labels;
+    };
+    static const std::vector<std::string> seconds = build(PerformanceMonitor::Unit::SECONDS);
+    static const std::vector<std::string> values = build(PerformanceMonitor::Unit::COUNT);
+    return unit == PerformanceMonitor::Unit::SECONDS ? seconds : values;
+}
+
+// Appends `name{labels,extra} value\n` (braces only if there are labels)
+void appendSample(std::string& out, std::string_view name, std::string_view labels,
+                  std::string_view extra, std::string_view value) {
+    out.append(name);
+    if (!labels.empty() || !extra.empty()) {
+        out.push_back('{');
+        out.append(labels);
+        if (!labels.empty() && !extra.empty()) {
+            out.push_back(',');
+        }
+        out.append(extra);
+        out.push_back('}');
+    }
+    out.push_back(' ');
+    out.append(value);
+    out.push_back('\n');
+}
+
+void appendSample(std::string& out, std::string_view name, std::string_view labels,
+                  std::string_view extra, uint64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    appendSample(out, name, labels, extra, std::string_view(digits, result.ptr - digits));
+}
+
+} // namespace
+
+// ============================================================================
+// PERFORMANCE MONITOR
+// ============================================================================
+
+void PerformanceMonitor::Histogram::record(uint64_t value) {
+    HistogramCells& cells = threadShard().cells(id);
+    bump(cells.buckets[bucketIndex(value)], 1);
+    bump(cells.sum, value);
+}
+
+void PerformanceMonitor::Counter::add(uint64_t value) {
+    bump(threadShard().counters[id], value);
+}
+
+PerformanceMonitor::Histogram& PerformanceMonitor::histogram(const std::string& name, const std::string& labels, Unit unit) {
+    Registry& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::string key = metricKey(name, labels);
+    auto it = registry.histogramIds.find(key);
+    if (it != registry.histogramIds.end()) {
+        return registry.histograms[it->second];
+    }
+    if (registry.histograms.size() == kMaxHistograms) {
+        return registry.histograms.back();  // Full: share the last one rather than fail
+    }
+    registry.histogramIds.emplace(key, registry.histograms.size());
+    registry.histogramInfo.push_back({name, labels, unit});
+    registry.histograms.push_back(Histogram(static_cast<uint32_t>(registry.histograms.size())));
+    return registry.histograms.back();
+}
+
+PerformanceMonitor::Counter& PerformanceMonitor::counter(const std::string& name, const std::string& labels) {
+    Registry& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::string key = metricKey(name, labels);
+    auto it = registry.counterIds.find(key);
+    if (it != registry.counterIds.end()) {
+        return registry.counters[it->second];
+    }
+    if (registry.counters.size() == kMaxCounters) {
+        return registry.counters.back();
+    }
+    registry.counterIds.emplace(key, registry.counters.size());
+    registry.counterInfo.push_back({name, labels, Unit::COUNT});
+    registry.counters.push_back(Counter(static_cast<uint32_t>(registry.counters.size())));
+    return registry.counters.back();
+}
+
+PerformanceMonitor::Timer::Timer(const std::string& name)
+    : histogram(&PerformanceMonitor::histogram(name))
+    , start(std::chrono::steady_clock::now()) {
+}
+
+PerformanceMonitor::Timer::Timer(Histogram* histogram)
+    : histogram(histogram)
+    , start(std::chrono::steady_clock::now()) {
+}
+
+PerformanceMonitor::Timer::~Timer() {
+    stop();
+}
+
+void PerformanceMonitor::Timer::stop() {
+    if (stopped) {
+        return;
+    }
+    stopped = true;
+    if (histogram) {
+        histogram->recordDuration(std::chrono::steady_clock::now() - start);
+    }
+}
+
+void PerformanceMonitor::recordDuration(const std::string& operation, long long durationMs) {
+    histogram(operation).recordDuration(std::chrono::milliseconds(durationMs));
+}
+
+void PerformanceMonitor::recordCount(const std::string& metric, int count) {
+    counter(metric).add(count > 0 ? static_cast<uint64_t>(count) : 0);
+}
+
+void PerformanceMonitor::recordGauge(const std::string& metric, double value) {
+    Registry& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.gauges[metric] = value;
+}
+
+std::string PerformanceMonitor::getMetrics() {
+    Registry& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Merge: retired threads plus every live shard
+    Shard total;
+    total.absorb(registry.retired);
+    for (const Shard* shard : registry.shards) {
+        total.absorb(*shard);
+    }
+
+    std::string out;
+    out.reserve(registry.histogramInfo.size() * 2048 + registry.counterInfo.size() * 64);
+    std::string lastName;
+    std::string family;
+
+    // Grouped by name (one TYPE line per family), registration order within
+    std::vector<size_t> order(registry.histogramInfo.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return registry.histogramInfo[a].name < registry.histogramInfo[b].name;
+    });
+    for (size_t id : order) {
+        const MetricInfo& info = registry.histogramInfo[id];
+        HistogramCells* cells = total.histograms[id].load(std::memory_order_relaxed);
+        if (info.name != lastName) {
+            out += "# TYPE " + info.name + " histogram\n";
+            lastName = info.name;
+        }
+        double scale = info.unit == Unit::SECONDS ? 1e-9 : 1.0;
+
+        // Whole HDR buckets up to the bound, plus a linear share of the one
+        // that straddles it
+        family = info.name + "_bucket";
+        const auto& bounds = exportBounds(info.unit);
+        const auto& boundLabels = exportBoundLabels(info.unit);
+        uint64_t cumulative = 0;
+        size_t bucket = 0;
+        for (size_t i = 0; i < bounds.size(); i++) {
+            uint64_t bound = bounds[i];
+            while (cells && bucket < kBuckets && bucketLower(bucket) + bucketWidth(bucket) - 1 <= bound) {
+                cumulative += cells->buckets[bucket++].load(std::memory_order_relaxed);
+            }
+            uint64_t partial = 0;
+            if (cells && bucket < kBuckets && bucketLower(bucket) <= bound) {
+                double share = static_cast<double>(bound - bucketLower(bucket) + 1) / bucketWidth(bucket);
+                partial = static_cast<uint64_t>(cells->buckets[bucket].load(std::memory_order_relaxed) * share);
+            }
+            appendSample(out, family, info.labels, boundLabels[i], cumulative + partial);
+        }
+        while (cells && bucket < kBuckets) {
+            cumulative += cells->buckets[bucket++].load(std::memory_order_relaxed);
+        }
+        uint64_t sum = cells ? cells->sum.load(std::memory_order_relaxed) : 0;
+        appendSample(out, family, info.labels, "le=\"+Inf\"", cumulative);
+        appendSample(out, info.name + "_sum", info.labels, "", formatNumber(sum * scale));
+        appendSample(out, info.name + "_count", info.labels, "", cumulative);
+    }
+
+    order.resize(registry.counterInfo.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return registry.counterInfo[a].name < registry.counterInfo[b].name;
+    });
+    lastName.clear();
+    for (size_t id : order) {
+        const MetricInfo& info = registry.counterInfo[id];
+        if (info.name != lastName) {
+            out += "# TYPE " + info.name + " counter\n";
+            lastName = info.name;
+        }
+        appendSample(out, info.name, info.labels, "", total.counters[id].load(std::memory_order_relaxed));
+    }
+
+    for (const auto& [name, value] : registry.gauges) {
+        out += "# TYPE " + name + " gauge\n" + name + " " + formatNumber(value) + "\n";
+    }
+    return out;
+}
+
+} // namespace logging
+} // namespace chatbox
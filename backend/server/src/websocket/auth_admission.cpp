@@ -0,0 +1,49 @@
+#include "websocket/auth_admission.h"
+
+#include <algorithm>
+
+AuthAdmission::AuthAdmission(const AdmissionLimits& limits)
+    : intervalNs_(limits.ratePerSecond > 0 ? std::max<int64_t>(1, static_cast<int64_t>(1e9 / limits.ratePerSecond)) : 0)
+    , maxWaitNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(limits.maxWait).count()) {
+}
+
+AuthAdmission::Ticket AuthAdmission::reserve(int64_t nowNs) {
+    if (intervalNs_ == 0) {
+        admitted_.fetch_add(1, std::memory_order_relaxed);
+        return Ticket{true, 0};
+    }
+
+    int64_t next = next_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t slot = std::max(next, nowNs);
+        int64_t wait = slot - nowNs;
+        if (wait > maxWaitNs_) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return Ticket{false, retryAfter(nowNs, wait - maxWaitNs_)};
+        }
+        if (next_.compare_exchange_weak(next, slot + intervalNs_, std::memory_order_relaxed)) {
+            admitted_.fetch_add(1, std::memory_order_relaxed);
+            return Ticket{true, wait};
+        }
+    }
+}
+
+int64_t AuthAdmission::retryAfter(int64_t nowNs, int64_t earliestNs) {
+    int64_t next = nextRetry_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t retryAt = std::max(next, nowNs + earliestNs);
+        if (nextRetry_.compare_exchange_weak(next, retryAt + intervalNs_, std::memory_order_relaxed)) {
+            return retryAt - nowNs;
+        }
+    }
+}
+
+AuthAdmission::Stats AuthAdmission::stats(int64_t nowNs) const {
+    Stats stats;
+    stats.admitted = admitted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    int64_t backlog = std::max<int64_t>(0, next_.load(std::memory_order_relaxed) - nowNs);
+    stats.backlogMs = backlog / 1'000'000;
+    stats.queued = intervalNs_ ? static_cast<uint64_t>(backlog / intervalNs_) : 0;
+    return stats;
+}
@@ -0,0 +1,147 @@
+#include "websocket/bootstrap_snapshot.h"
+#include <nlohmann/json.hpp>
+
+BootstrapSnapshot::BootstrapSnapshot(std::chrono::milliseconds renderInterval)
+    : renderInterval_(renderInterval) {
+}
+
+void BootstrapSnapshot::setRenderInterval(std::chrono::milliseconds interval) {
+    renderInterval_ = interval;
+}
+
+void BootstrapSnapshot::refresh(const Loader& load, bool onlyIfMissing) {
+    auto loaded = [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return directory_ != nullptr;
+    };
+    // Present: return without waiting for a periodic reload in progress
+    if (onlyIfMissing && loaded()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> loadLock(loadMutex_);
+    if (onlyIfMissing && loaded()) {
+        return;  // Loaded by the caller we waited for
+    }
+
+    auto directory = std::make_shared<const Directory>(load());
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = std::move(directory);
+    loadedAt_ = std::chrono::steady_clock::now();
+    loads_++;
+}
+
+std::optional<std::string> BootstrapSnapshot::onlineUsers(const std::string& userId, const OnlineSource& online) {
+    std::shared_ptr<const Directory> directory;
+    std::shared_ptr<const Rendering> rendering;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directory = directory_;
+        rendering = rendering_;
+    }
+    if (!directory) {
+        return std::nullopt;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto stale = [&]() {
+        return !rendering || rendering->directory != directory || now - rendering->renderedAt >= renderInterval_;
+    };
+    if (stale()) {
+        // While another thread renders, serve the previous rendering
+        std::unique_lock<std::mutex> renderLock(renderMutex_, std::defer_lock);
+        if (rendering) {
+            renderLock.try_lock();
+        } else {
+            renderLock.lock();
+        }
+        if (renderLock.owns_lock()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                directory = directory_;
+                rendering = rendering_;
+            }
+            if (stale()) {
+                auto ids = online();
+                rendering = render(directory, std::unordered_set<std::string>(ids.begin(), ids.end()));
+                std::lock_guard<std::mutex> lock(mutex_);
+                rendering_ = rendering;
+                renders_++;
+            }
+        }
+    }
+
+    // {"count":N,"type":"online_users","users":[...]} (key order of json::dump)
+    const std::string& users = rendering->users;
+    size_t count = rendering->count;
+    size_t skipBegin = users.size(), skipEnd = users.size();
+    auto self = rendering->spans.find(userId);
+    if (self != rendering->spans.end()) {
+        // The element and one separating comma
+        auto [begin, end] = self->second;
+        if (end < users.size()) {
+            skipBegin = begin;
+            skipEnd = end + 1;
+        } else {
+            skipBegin = begin > 0 ? begin - 1 : begin;
+            skipEnd = end;
+        }
+        count--;
+    }
+
+    std::string reply;
+    reply.reserve(users.size() + 64);
+    reply.append("{\"count\":").append(std::to_string(count)).append(",\"type\":\"online_users\",\"users\":[");
+    reply.append(users, 0, skipBegin);
+    reply.append(users, skipEnd, std::string::npos);
+    reply.append("]}");
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    served_++;
+    return reply;
+}
+
+BootstrapSnapshot::Stats BootstrapSnapshot::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.users = directory_ ? directory_->size() : 0;
+    stats.loads = loads_;
+    stats.renders = renders_;
+    stats.served = served_;
+    if (directory_) {
+        stats.directoryAgeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - loadedAt_).count();
+    }
+    return stats;
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+std::shared_ptr<const BootstrapSnapshot::Rendering> BootstrapSnapshot::render(
+        const std::shared_ptr<const Directory>& directory,
+        const std::unordered_set<std::string>& online) {
+    auto rendering = std::make_shared<Rendering>();
+    rendering->directory = directory;
+    rendering->renderedAt = std::chrono::steady_clock::now();
+    rendering->spans.reserve(directory->size());
+
+    for (const auto& user : *directory) {
+        bool isOnline = online.count(user.userId) > 0;
+        nlohmann::json element = {
+            {"userId", user.userId},
+            {"username", user.username},
+            {"online", isOnline},
+            {"status", isOnline ? "online" : "offline"}
+        };
+        if (!rendering->users.empty()) {
+            rendering->users.push_back(',');
+        }
+        size_t begin = rendering->users.size();
+        rendering->users.append(element.dump());
+        rendering->spans[user.userId] = {begin, rendering->users.size()};
+        rendering->count++;
+    }
+    return rendering;
+}
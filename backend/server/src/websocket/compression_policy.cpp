@@ -0,0 +1,51 @@
+#include "websocket/compression_policy.h"
+#include "websocket/json_peek.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+CompressionPolicy::CompressionPolicy(CompressionSettings settings)
+    : settings_(std::move(settings)) {
+}
+
+bool CompressionPolicy::shouldCompress(std::string_view payload) const {
+    if (!enabled() || payload.size() < settings_.thresholdBytes) {
+        return false;
+    }
+    if (settings_.excludedTypes.empty()) {
+        return true;
+    }
+    std::string_view type = json_peek::topLevelString(payload, "type");
+    return settings_.excludedTypes.find(std::string(type)) == settings_.excludedTypes.end();
+}
+
+std::optional<CompressionMode> CompressionPolicy::parseMode(const std::string& value) {
+    std::string mode = value;
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if (mode.empty() || mode == "off" || mode == "none" || mode == "false") {
+        return CompressionMode::OFF;
+    }
+    if (mode == "shared") {
+        return CompressionMode::SHARED;
+    }
+    if (mode == "dedicated") {
+        return CompressionMode::DEDICATED;
+    }
+    return std::nullopt;
+}
+
+std::unordered_set<std::string> CompressionPolicy::parseTypeList(const std::string& value) {
+    std::unordered_set<std::string> types;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) {
+            types.insert(item);
+        }
+    }
+    return types;
+}
@@ -0,0 +1,112 @@
+#include "websocket/connection_registry.h"
+
+#include <algorithm>
+
+uint64_t ConnectionRegistry::add(void* wsPtr, uWS::Loop* loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto existing = connections_.find(wsPtr);
+    if (existing != connections_.end()) {
+        unindexLocked(existing->second);
+    }
+
+    ConnectionState state;
+    state.wsPtr = wsPtr;
+    state.loop = loop;
+    state.connectionId = ++nextConnectionId_;
+    connections_[wsPtr] = state;
+    return state.connectionId;
+}
+
+bool ConnectionRegistry::authenticate(void* wsPtr,
+                                      const std::string& userId,
+                                      const std::string& username,
+                                      const std::string& sessionId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = connections_.find(wsPtr);
+    if (it == connections_.end()) {
+        return false;
+    }
+
+    // Re-auth on the same socket (e.g. login after auth) replaces old indexes
+    auto& state = it->second;
+    unindexLocked(state);
+
+    state.authenticated = true;
+    state.userId = userId;
+    state.username = username;
+    state.sessionId = sessionId;
+
+    byUser_[userId].push_back(&state);
+    if (!sessionId.empty()) {
+        bySession_[sessionId] = &state;
+    }
+    return true;
+}
+
+std::optional<ConnectionState> ConnectionRegistry::remove(void* wsPtr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = connections_.find(wsPtr);
+    if (it == connections_.end()) {
+        return std::nullopt;
+    }
+
+    unindexLocked(it->second);
+    ConnectionState state = std::move(it->second);
+    connections_.erase(it);
+    return state;
+}
+
+bool ConnectionRegistry::isAlive(void* wsPtr, uint64_t connectionId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = connections_.find(wsPtr);
+    return it != connections_.end() && it->second.connectionId == connectionId;
+}
+
+size_t ConnectionRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size();
+}
+
+size_t ConnectionRegistry::userConnectionCount(const std::string& userId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byUser_.find(userId);
+    return it != byUser_.end() ? it->second.size() : 0;
+}
+
+std::vector<std::string> ConnectionRegistry::getOnlineUserIds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::string> userIds;
+    userIds.reserve(byUser_.size());
+    for (const auto& [userId, sockets] : byUser_) {
+        userIds.push_back(userId);
+    }
+    return userIds;
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+void ConnectionRegistry::unindexLocked(ConnectionState& state) {
+    if (!state.userId.empty()) {
+        auto userIt = byUser_.find(state.userId);
+        if (userIt != byUser_.end()) {
+            auto& devices = userIt->second;
+            devices.erase(std::remove(devices.begin(), devices.end(), &state), devices.end());
+            if (devices.empty()) {
+                byUser_.erase(userIt);
+            }
+        }
+    }
+
+    if (!state.sessionId.empty()) {
+        auto sessionIt = bySession_.find(state.sessionId);
+        if (sessionIt != bySession_.end() && sessionIt->second == &state) {
+            bySession_.erase(sessionIt);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#include "websocket/inbound_message.h"
+
+bool InboundMessage::parse(std::string_view frame) {
+    buffer_.reserve(frame.size() + simdjson::SIMDJSON_PADDING);
+    buffer_.assign(frame.data(), frame.size());
+    frame_ = buffer_;
+    type_ = {};
+
+    if (parser_.iterate(buffer_.data(), buffer_.size(), buffer_.capacity()).get(document_) ||
+        document_.get_object().get(object_)) {
+        return false;
+    }
+    type_ = getString("type");
+    return true;
+}
+
+simdjson::simdjson_result<simdjson::ondemand::value> InboundMessage::field(std::string_view key) {
+    // Unordered: handlers ask in any order, each lookup resumes where the
+    // last one stopped and wraps around once
+    return object_.find_field_unordered(key);
+}
+
+std::string_view InboundMessage::getString(std::string_view key, std::string_view fallback) {
+    simdjson::ondemand::value value;
+    auto error = field(key).get(value);
+    if (error == simdjson::NO_SUCH_FIELD) {
+        return fallback;
+    }
+    if (error) {
+        throw simdjson::simdjson_error(error);
+    }
+    return value.get_string().value();
+}
+
+bool InboundMessage::getBool(std::string_view key, bool fallback) {
+    simdjson::ondemand::value value;
+    auto error = field(key).get(value);
+    if (error == simdjson::NO_SUCH_FIELD) {
+        return fallback;
+    }
+    if (error) {
+        throw simdjson::simdjson_error(error);
+    }
+    return value.get_bool().value();
+}
+
+double InboundMessage::getDouble(std::string_view key, double fallback) {
+    simdjson::ondemand::value value;
+    auto error = field(key).get(value);
+    if (error == simdjson::NO_SUCH_FIELD) {
+        return fallback;
+    }
+    if (error) {
+        throw simdjson::simdjson_error(error);
+    }
+    return value.get_double().value();
+}
+
+std::string_view InboundMessage::getRawObject(std::string_view key) {
+    simdjson::ondemand::value value;
+    if (field(key).get(value)) {
+        return {};
+    }
+    simdjson::ondemand::json_type type;
+    if (value.type().get(type) || type != simdjson::ondemand::json_type::object) {
+        return {};
+    }
+    simdjson::ondemand::object object;
+    std::string_view raw;
+    if (value.get_object().get(object) || object.raw_json().get(raw)) {
+        return {};
+    }
+    return raw;
+}
+
+nlohmann::json InboundMessage::toJson() const {
+    return nlohmann::json::parse(frame_.begin(), frame_.end());
+}
@@ -0,0 +1,39 @@
+#include "websocket/intern_table.h"
+
+#include <algorithm>
+
+InternTable::InternTable(size_t capacity)
+    : capacity_(std::max<size_t>(1, capacity)) {
+}
+
+InternTable::Interned InternTable::intern(std::string_view name) {
+    auto existing = byName_.find(std::string(name));
+    if (existing != byName_.end()) {
+        auto it = byId_.find(existing->second);
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return Interned{existing->second, std::nullopt};
+    }
+
+    Interned result{nextId_++, std::nullopt};
+    if (byId_.size() >= capacity_) {
+        const Entry& oldest = lru_.back();
+        result.evicted = oldest.first;
+        byName_.erase(oldest.second);
+        byId_.erase(oldest.first);
+        lru_.pop_back();
+    }
+
+    lru_.emplace_front(result.id, std::string(name));
+    byId_[result.id] = lru_.begin();
+    byName_[lru_.front().second] = result.id;
+    return result;
+}
+
+const std::string* InternTable::lookup(uint32_t id) {
+    auto it = byId_.find(id);
+    if (it == byId_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return &it->second->second;
+}
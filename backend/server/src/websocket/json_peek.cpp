@@ -0,0 +1,90 @@
+#include "websocket/json_peek.h"
+
+#include <cctype>
+
+namespace json_peek {
+
+namespace {
+
+void skipWhitespace(std::string_view json, size_t& pos) {
+    while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+        pos++;
+    }
+}
+
+// pos at the opening quote; returns the raw contents, pos after the closing quote
+std::string_view readString(std::string_view json, size_t& pos) {
+    size_t start = ++pos;
+    while (pos < json.size() && json[pos] != '"') {
+        pos += (json[pos] == '\\') ? 2 : 1;
+    }
+    if (pos >= json.size()) {
+        return {};
+    }
+    return json.substr(start, pos++ - start);
+}
+
+// Skip one value (string, object, array or scalar) starting at pos
+void skipValue(std::string_view json, size_t& pos) {
+    int depth = 0;
+    while (pos < json.size()) {
+        char c = json[pos];
+        if (c == '"') {
+            readString(json, pos);
+        } else if (c == '{' || c == '[') {
+            depth++;
+            pos++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                return;  // End of the enclosing object
+            }
+            depth--;
+            pos++;
+        } else if (c == ',' && depth == 0) {
+            return;
+        } else {
+            pos++;
+        }
+        if (depth == 0 && (c == '"' || c == '}' || c == ']')) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+std::string_view topLevelString(std::string_view json, std::string_view wanted) {
+    size_t pos = 0;
+    skipWhitespace(json, pos);
+    if (pos >= json.size() || json[pos] != '{') {
+        return {};
+    }
+    pos++;
+
+    while (pos < json.size()) {
+        skipWhitespace(json, pos);
+        if (pos >= json.size() || json[pos] != '"') {
+            return {};
+        }
+        std::string_view key = readString(json, pos);
+        skipWhitespace(json, pos);
+        if (pos >= json.size() || json[pos] != ':') {
+            return {};
+        }
+        pos++;
+        skipWhitespace(json, pos);
+
+        if (key == wanted) {
+            return (pos < json.size() && json[pos] == '"') ? readString(json, pos) : std::string_view();
+        }
+        skipValue(json, pos);
+        skipWhitespace(json, pos);
+        if (pos >= json.size() || json[pos] != ',') {
+            return {};
+        }
+        pos++;
+    }
+    return {};
+}
+
+} // namespace json_peek
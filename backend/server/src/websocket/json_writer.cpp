@@ -0,0 +1,93 @@
+#include "websocket/json_writer.h"
+
+#include <stdexcept>
+
+namespace json_writer {
+
+namespace {
+
+// Bytes that end a plain run: control characters, quote, backslash, non-ASCII
+constexpr bool needsAttention(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\' || c >= 0x80;
+}
+
+bool isContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Length of the UTF-8 sequence at pos (0 = invalid), same rules as nlohmann
+size_t utf8Length(std::string_view s, size_t pos) {
+    auto at = [&](size_t i) { return static_cast<unsigned char>(s[i]); };
+    unsigned char lead = at(pos);
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF;  // Range of the second byte
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;         // Overlong
+        if (lead == 0xED) high = 0x9F;        // Surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;         // Overlong
+        if (lead == 0xF4) high = 0x8F;        // Above U+10FFFF
+    } else {
+        return 0;
+    }
+    if (pos + length > s.size() || at(pos + 1) < low || at(pos + 1) > high) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if (!isContinuation(at(pos + i))) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+} // namespace
+
+void appendString(std::string& out, std::string_view value) {
+    static constexpr char kHex[] = "0123456789abcdef";
+
+    out.reserve(out.size() + value.size() + 2);
+    out.push_back('"');
+    size_t run = 0;  // Start of the pending plain run
+    size_t pos = 0;
+    while (pos < value.size()) {
+        unsigned char c = static_cast<unsigned char>(value[pos]);
+        if (!needsAttention(c)) {
+            pos++;
+            continue;
+        }
+        if (c >= 0x80) {
+            size_t length = utf8Length(value, pos);
+            if (length == 0) {
+                throw std::invalid_argument("invalid UTF-8 byte at index " + std::to_string(pos));
+            }
+            pos += length;  // Kept as is
+            continue;
+        }
+
+        out.append(value.data() + run, pos - run);
+        switch (c) {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default: {
+                char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+        run = ++pos;
+    }
+    out.append(value.data() + run, pos - run);
+    out.push_back('"');
+}
+
+} // namespace json_writer
@@ -0,0 +1,147 @@
+#include "websocket/loop_watchdog.h"
+#include "utils/logger.h"
+#include "utils/logging.h"
+
+#include <algorithm>
+#include <string>
+
+using chatbox::logging::PerformanceMonitor;
+
+namespace {
+
+const char* describe(const char* activity) {
+    return activity ? activity : "between handlers";
+}
+
+int64_t toMs(int64_t ns) {
+    return ns / 1'000'000;
+}
+
+} // namespace
+
+// ============================================================================
+// HEARTBEAT
+// ============================================================================
+
+LoopWatchdog::Heartbeat::Heartbeat(LoopWatchdog& owner, unsigned loopIndex)
+    : owner_(owner)
+    , loopIndex_(loopIndex)
+    , lastBeatNs_(LoopWatchdog::nowNs()) {
+}
+
+void LoopWatchdog::Heartbeat::beat() {
+    int64_t now = LoopWatchdog::nowNs();
+    int64_t previous = lastBeatNs_.load(std::memory_order_relaxed);
+    lastBeatNs_.store(now, std::memory_order_release);
+    if (now - previous >= owner_.thresholdNs_) {
+        // The watchdog's view if it caught this stall, else the last handler started
+        const char* activity = activity_.load(std::memory_order_relaxed);
+        if (stalledAfterNs_.load(std::memory_order_acquire) == previous) {
+            activity = stalledIn_.load(std::memory_order_relaxed);
+        }
+        owner_.recordStall(*this, activity, now - previous);
+    }
+    activity_.store(nullptr, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// WATCHDOG
+// ============================================================================
+
+LoopWatchdog::LoopWatchdog(std::chrono::milliseconds threshold)
+    : thresholdNs_(std::chrono::nanoseconds(threshold).count()) {
+    thread_ = std::thread([this]() { watch(); });
+}
+
+LoopWatchdog::~LoopWatchdog() {
+    stop();
+}
+
+LoopWatchdog::Heartbeat* LoopWatchdog::attach(unsigned loopIndex) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heartbeats_.push_back(std::unique_ptr<Heartbeat>(new Heartbeat(*this, loopIndex)));
+    return heartbeats_.back().get();
+}
+
+void LoopWatchdog::detach(Heartbeat* heartbeat) {
+    heartbeat->active_.store(false, std::memory_order_relaxed);
+}
+
+std::chrono::milliseconds LoopWatchdog::heartbeatPeriod() const {
+    // Four beats per threshold: an idle loop is never mistaken for a stall
+    auto period = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(thresholdNs_ / 4));
+    return std::max(period, std::chrono::milliseconds(5));
+}
+
+void LoopWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+LoopWatchdog::Stats LoopWatchdog::stats() const {
+    Stats stats;
+    stats.thresholdMs = toMs(thresholdNs_);
+    stats.stalls = stalls_.load(std::memory_order_relaxed);
+    stats.maxStallMs = toMs(maxStallNs_.load(std::memory_order_relaxed));
+    stats.detected = detected_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void LoopWatchdog::watch() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wakeup_.wait_for(lock, heartbeatPeriod());
+        int64_t now = nowNs();
+        for (auto& heartbeat : heartbeats_) {
+            check(*heartbeat, now);
+        }
+    }
+}
+
+void LoopWatchdog::check(Heartbeat& heartbeat, int64_t nowNs) {
+    if (!heartbeat.active_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    int64_t lastBeat = heartbeat.lastBeatNs_.load(std::memory_order_acquire);
+    int64_t blockedNs = nowNs - lastBeat;
+    if (blockedNs < thresholdNs_) {
+        return;
+    }
+
+    if (heartbeat.reportedBeatNs_ != lastBeat) {
+        // New stall: remember what the loop is running for its histogram
+        const char* activity = heartbeat.activity_.load(std::memory_order_relaxed);
+        heartbeat.stalledIn_.store(activity, std::memory_order_relaxed);
+        heartbeat.stalledAfterNs_.store(lastBeat, std::memory_order_release);
+        heartbeat.reportedBeatNs_ = lastBeat;
+        detected_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN_F("⚠️ Event loop stall: loop={} blocked_ms={} activity={}",
+                   heartbeat.loopIndex_, toMs(blockedNs), describe(activity));
+    } else if (nowNs >= heartbeat.nextReportNs_) {
+        LOG_WARN_F("⚠️ Event loop still stalled: loop={} blocked_ms={} activity={}",
+                   heartbeat.loopIndex_, toMs(blockedNs), describe(heartbeat.stalledIn_.load(std::memory_order_relaxed)));
+    } else {
+        return;
+    }
+    heartbeat.nextReportNs_ = lastBeat + 2 * blockedNs;  // Again each time it doubles
+}
+
+void LoopWatchdog::recordStall(Heartbeat& heartbeat, const char* activity, int64_t stallNs) {
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+    int64_t max = maxStallNs_.load(std::memory_order_relaxed);
+    while (stallNs > max && !maxStallNs_.compare_exchange_weak(max, stallNs, std::memory_order_relaxed)) {
+    }
+
+    // Rare: the registry lookup (mutex) is fine here
+    PerformanceMonitor::histogram("chatbox_loop_stall_seconds",
+                                  std::string("activity=\"") + describe(activity) + "\"")
+        .recordDuration(std::chrono::nanoseconds(stallNs));
+    LOG_WARN_F("⚠️ Event loop stall ended: loop={} stall_ms={} activity={}",
+               heartbeat.loopIndex_, toMs(stallNs), describe(activity));
+}
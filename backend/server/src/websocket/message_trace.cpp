@@ -0,0 +1,105 @@
+#include "websocket/message_trace.h"
+#include "utils/logger.h"
+#include "utils/logging.h"
+
+#include <atomic>
+
+using chatbox::logging::PerformanceMonitor;
+
+namespace {
+
+std::atomic<uint32_t> sampleEvery{0};
+std::atomic<int64_t> slowThresholdNs{250'000'000};
+
+// Messages seen by this thread since its last sampled one
+thread_local uint32_t sinceSample = 0;
+
+// Time spent reaching each stage from the previous one
+constexpr const char* kStageNames[MessageTrace::kStageCount] = {
+    "received", "parse", "queue", "resolve", "persist", "fanout", "write"
+};
+
+struct TraceHistograms {
+    std::array<PerformanceMonitor::Histogram*, MessageTrace::kStageCount> stages{};
+    PerformanceMonitor::Histogram* total = nullptr;
+};
+
+const TraceHistograms& traceHistograms() {
+    static const TraceHistograms histograms = [] {
+        TraceHistograms h;
+        for (size_t i = 1; i < MessageTrace::kStageCount; i++) {
+            h.stages[i] = &PerformanceMonitor::histogram("chatbox_chat_stage_seconds",
+                                                         std::string("stage=\"") + kStageNames[i] + "\"");
+        }
+        h.total = &PerformanceMonitor::histogram("chatbox_chat_latency_seconds");
+        return h;
+    }();
+    return histograms;
+}
+
+double toMs(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+void MessageTrace::configure(const TraceSettings& settings) {
+    sampleEvery.store(settings.sampleEvery, std::memory_order_relaxed);
+    slowThresholdNs.store(std::chrono::nanoseconds(settings.slowThreshold).count(), std::memory_order_relaxed);
+}
+
+MessageTrace::Ptr MessageTrace::sample(Clock::time_point receivedAt) {
+    uint32_t every = sampleEvery.load(std::memory_order_relaxed);
+    if (every == 0 || ++sinceSample < every) {
+        return nullptr;
+    }
+    sinceSample = 0;
+    return Ptr(new MessageTrace(receivedAt));
+}
+
+PreparedMessage::Ptr MessageTrace::track(const Ptr& trace, PreparedMessage::Ptr message) {
+    if (!trace) {
+        return message;
+    }
+    // Same message; the trace is released with the last copy of this pointer
+    const PreparedMessage* raw = message.get();
+    return PreparedMessage::Ptr(raw, [message = std::move(message), trace](const PreparedMessage*) {});
+}
+
+MessageTrace::MessageTrace(Clock::time_point receivedAt) {
+    stages_[static_cast<size_t>(Stage::RECEIVED)] = receivedAt;
+}
+
+void MessageTrace::describe(std::string messageId, std::string roomId) {
+    messageId_ = std::move(messageId);
+    roomId_ = std::move(roomId);
+}
+
+MessageTrace::~MessageTrace() {
+    if (stages_[static_cast<size_t>(Stage::FANOUT)] == Clock::time_point{}) {
+        return;  // Not delivered (empty content, @ai command, error)
+    }
+    mark(Stage::WRITTEN);
+
+    // A stage that was not reached (error path) takes no time
+    const TraceHistograms& histograms = traceHistograms();
+    std::array<std::chrono::nanoseconds, kStageCount> spent{};
+    Clock::time_point previous = stages_[0];
+    for (size_t i = 1; i < kStageCount; i++) {
+        if (stages_[i] == Clock::time_point{}) {
+            continue;
+        }
+        spent[i] = stages_[i] - previous;
+        histograms.stages[i]->recordDuration(spent[i]);
+        previous = stages_[i];
+    }
+    std::chrono::nanoseconds total = previous - stages_[0];
+    histograms.total->recordDuration(total);
+
+    if (total.count() >= slowThresholdNs.load(std::memory_order_relaxed)) {
+        LOG_WARN_F("🐢 Slow chat {} in room '{}': {:.2f} ms (parse {:.2f}, queue {:.2f}, resolve {:.2f}, "
+                   "persist {:.2f}, fanout {:.2f}, write {:.2f})",
+                   messageId_, roomId_, toMs(total), toMs(spent[1]), toMs(spent[2]), toMs(spent[3]),
+                   toMs(spent[4]), toMs(spent[5]), toMs(spent[6]));
+    }
+}
@@ -0,0 +1,17 @@
+#include "websocket/prepared_message.h"
+#include <App.h>
+
+PreparedMessage::Ptr PreparedMessage::create(std::string payload, uWS::OpCode opCode) {
+    std::shared_ptr<PreparedMessage> prepared(new PreparedMessage());
+    prepared->payload_ = std::move(payload);
+    prepared->opCode_ = opCode;
+    return prepared;
+}
+
+PreparedMessage::Ptr PreparedMessage::create(std::string payload) {
+    return create(std::move(payload), uWS::OpCode::TEXT);
+}
+
+PreparedMessage::Ptr PreparedMessage::create(const nlohmann::json& message) {
+    return create(message.dump(), uWS::OpCode::TEXT);
+}
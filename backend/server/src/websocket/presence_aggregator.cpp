@@ -0,0 +1,58 @@
+#include "websocket/presence_aggregator.h"
+
+void PresenceAggregator::online(const std::string& userId, const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recordLocked(userId, username, "online");
+}
+
+void PresenceAggregator::offline(const std::string& userId, const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recordLocked(userId, username, "offline");
+}
+
+void PresenceAggregator::setStatus(const std::string& userId, const std::string& username, const std::string& status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recordLocked(userId, username, status);
+}
+
+std::vector<PresenceAggregator::Change> PresenceAggregator::flush(const ConnectedCheck& connected) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Change> changes;
+    changes.reserve(order_.size());
+
+    for (const auto& userId : order_) {
+        Pending& entry = pending_[userId];
+        if (entry.status == "offline" && connected(userId)) {
+            // Still connected: keep what was published (online if nothing was)
+            entry.status = entry.publishedStatus == "offline" ? "online" : entry.publishedStatus;
+        }
+        if (entry.status == entry.publishedStatus) {
+            continue;  // Changed and changed back within the window
+        }
+        if (entry.status == "offline") {
+            published_.erase(userId);
+        } else {
+            published_[userId] = entry.status;
+        }
+        changes.push_back(Change{userId, std::move(entry.username), std::move(entry.status)});
+    }
+
+    pending_.clear();
+    order_.clear();
+    return changes;
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+void PresenceAggregator::recordLocked(const std::string& userId, const std::string& username, const std::string& status) {
+    auto [it, inserted] = pending_.try_emplace(userId);
+    if (inserted) {
+        auto publishedIt = published_.find(userId);
+        it->second.publishedStatus = publishedIt != published_.end() ? publishedIt->second : "offline";
+        order_.push_back(userId);
+    }
+    it->second.username = username;
+    it->second.status = status;
+}
@@ -0,0 +1,93 @@
+#include "websocket/rate_limiter.h"
+
+#include <algorithm>
+
+TokenBucket::Rate TokenBucket::Rate::of(double perSecond, double burst) {
+    Rate rate;
+    if (perSecond <= 0) {
+        return rate;  // Unlimited
+    }
+    rate.intervalNs = std::max<int64_t>(1, static_cast<int64_t>(1e9 / perSecond));
+    rate.toleranceNs = static_cast<int64_t>(std::max(1.0, burst) * rate.intervalNs);
+    return rate;
+}
+
+bool TokenBucket::tryConsume(const Rate& rate, uint32_t cost, int64_t nowNs) {
+    if (rate.intervalNs == 0) {
+        return true;
+    }
+    int64_t tat = std::max(tat_, nowNs) + cost * rate.intervalNs;
+    if (tat - nowNs > rate.toleranceNs) {
+        return false;
+    }
+    tat_ = tat;
+    return true;
+}
+
+bool SharedTokenBucket::tryConsume(const TokenBucket::Rate& rate, uint32_t cost, int64_t nowNs) {
+    if (rate.intervalNs == 0) {
+        return true;
+    }
+    int64_t current = tat_.load(std::memory_order_relaxed);
+    for (;;) {
+        int64_t tat = std::max(current, nowNs) + cost * rate.intervalNs;
+        if (tat - nowNs > rate.toleranceNs) {
+            return false;
+        }
+        if (tat_.compare_exchange_weak(current, tat, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+RateLimiter::RateLimiter(const RateLimits& limits)
+    : connection_(TokenBucket::Rate::of(limits.connectionRate, limits.connectionBurst))
+    , user_(TokenBucket::Rate::of(limits.userRate, limits.userBurst))
+    , strike_(TokenBucket::Rate::of(limits.strikeRate, limits.strikeBurst)) {
+}
+
+std::shared_ptr<SharedTokenBucket> RateLimiter::userBucket(const std::string& userId) {
+    std::lock_guard<std::mutex> lock(usersMutex_);
+
+    // Buckets live as long as one of the user's connections holds them
+    if (++lookupsSincePurge_ >= 1024) {
+        lookupsSincePurge_ = 0;
+        for (auto it = users_.begin(); it != users_.end();) {
+            it = it->second.expired() ? users_.erase(it) : std::next(it);
+        }
+    }
+
+    auto& slot = users_[userId];
+    auto bucket = slot.lock();
+    if (!bucket) {
+        bucket = std::make_shared<SharedTokenBucket>();
+        slot = bucket;
+    }
+    return bucket;
+}
+
+RateLimiter::Verdict RateLimiter::check(ConnectionRate& rate, const MessageTypeEntry& entry, int64_t nowNs) {
+    if (entry.cost == 0) {
+        return Verdict::ALLOW;
+    }
+    if (rate.requests.tryConsume(connection_, entry.cost, nowNs)) {
+        if (!rate.user || rate.user->tryConsume(user_, entry.cost, nowNs)) {
+            return Verdict::ALLOW;
+        }
+        // Rejected by the user bucket: the message costs the connection nothing
+        rate.requests.refund(connection_, entry.cost);
+    }
+
+    throttled_[messageTypeIndex(entry)].fetch_add(1, std::memory_order_relaxed);
+    return rate.strikes.tryConsume(strike_, 1, nowNs) ? Verdict::THROTTLE : Verdict::DISCONNECT;
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    Stats stats;
+    for (size_t i = 0; i < throttled_.size(); i++) {
+        stats.throttledByType[i] = throttled_[i].load(std::memory_order_relaxed);
+        stats.throttled += stats.throttledByType[i];
+    }
+    stats.disconnected = disconnected_.load(std::memory_order_relaxed);
+    return stats;
+}
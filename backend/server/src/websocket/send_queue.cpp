@@ -0,0 +1,113 @@
+#include "websocket/send_queue.h"
+#include "websocket/json_peek.h"
+#include <unordered_set>
+
+MessageClass SendQueue::classify(std::string_view type) {
+    if (type.rfind("webrtc_", 0) == 0 || type.rfind("call_", 0) == 0) {
+        return MessageClass::SIGNALING;
+    }
+    if (type == "typing" || type == "presence_batch" || type == "watch_sync" ||
+        type == "upload_progress" || type == "pong") {
+        return MessageClass::DROPPABLE;
+    }
+    return MessageClass::CHAT;
+}
+
+bool SendQueue::push(const PreparedMessage::Ptr& message, bool compress, size_t buffered, const SendLimits& limits) {
+    std::string_view payload = message->payload();
+    std::string_view type = json_peek::topLevelString(payload, "type");
+    MessageClass messageClass = classify(type);
+    size_t total = buffered + bytes_;
+
+    if (messageClass == MessageClass::DROPPABLE) {
+        std::string key = coalesceKey(payload, type);
+        auto it = coalesceIndex_.find(key);
+        if (it != coalesceIndex_.end()) {
+            // Still queued: the newer state replaces it in place. Presence
+            // batches are deltas, so the queued one is merged into the newer.
+            Entry& queued = ordered_[it->second - orderedFrontSeq_].entry;
+            PreparedMessage::Ptr replacement = type == "presence_batch"
+                ? mergePresenceBatches(queued.message->payload(), payload)
+                : message;
+            bytes_ = bytes_ - queued.message->payload().size() + replacement->payload().size();
+            queued = Entry{replacement, compress};
+            return true;
+        }
+        if (total + payload.size() > limits.hardLimit) {
+            return false;
+        }
+        coalesceIndex_[key] = orderedFrontSeq_ + ordered_.size();
+        ordered_.push_back(OrderedEntry{Entry{message, compress}, std::move(key)});
+        bytes_ += payload.size();
+        return true;
+    }
+
+    // Chat and signaling are kept until the socket is about to be cut off
+    if (total + payload.size() > 2 * limits.hardLimit) {
+        return false;
+    }
+    if (messageClass == MessageClass::SIGNALING) {
+        signaling_.push_back(Entry{message, compress});
+    } else {
+        ordered_.push_back(OrderedEntry{Entry{message, compress}, std::string()});
+    }
+    bytes_ += payload.size();
+    return true;
+}
+
+const SendQueue::Entry& SendQueue::front() const {
+    return !signaling_.empty() ? signaling_.front() : ordered_.front().entry;
+}
+
+void SendQueue::pop() {
+    if (!signaling_.empty()) {
+        bytes_ -= signaling_.front().message->payload().size();
+        signaling_.pop_front();
+        return;
+    }
+    OrderedEntry& entry = ordered_.front();
+    bytes_ -= entry.entry.message->payload().size();
+    if (!entry.coalesceKey.empty()) {
+        coalesceIndex_.erase(entry.coalesceKey);
+    }
+    ordered_.pop_front();
+    orderedFrontSeq_++;
+}
+
+void SendQueue::clear() {
+    signaling_.clear();
+    orderedFrontSeq_ += ordered_.size();
+    ordered_.clear();
+    coalesceIndex_.clear();
+    bytes_ = 0;
+}
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+std::string SendQueue::coalesceKey(std::string_view payload, std::string_view type) {
+    // One pending state per type and subject (user / room / upload)
+    std::string key(type);
+    for (std::string_view field : {"userId", "roomId", "uploadId"}) {
+        key.push_back('|');
+        key.append(json_peek::topLevelString(payload, field));
+    }
+    return key;
+}
+
+PreparedMessage::Ptr SendQueue::mergePresenceBatches(std::string_view older, std::string_view newer) {
+    // Newest status per user wins; users only in the older batch keep theirs
+    nlohmann::json merged = nlohmann::json::parse(newer);
+    nlohmann::json& users = merged["users"];
+    std::unordered_set<std::string> updated;
+    for (const auto& user : users) {
+        updated.insert(user.value("userId", ""));
+    }
+    for (const auto& user : nlohmann::json::parse(older)["users"]) {
+        if (!updated.count(user.value("userId", ""))) {
+            users.push_back(user);
+        }
+    }
+    return PreparedMessage::create(merged);
+}
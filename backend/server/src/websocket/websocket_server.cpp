@@ -1,5 +1,10 @@
 #include "websocket/websocket_server.h"
+#include "websocket/message_types.h"
+#include "websocket/inbound_message.h"
+#include "websocket/protocol_messages.h"
+#include "websocket/loop_watchdog.h"
 #include "utils/logger.h"
+#include "utils/logging.h"
 #include "database/types.h"
 #include "ai/gemini_client.h"
 #include <App.h>
@@ -8,11 +13,14 @@
 #include <filesystem>
 #include <fstream>
 #include <set>
+#include <unordered_set>
 #include <random>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <functional>  // for std::hash
+#include <algorithm>
+#include <array>
 
 // Helper function to create canonical DM roomId
 // Format: dm_<hash> - ensures consistent roomId regardless of who sends first
@@ -47,7 +55,6 @@ using json = nlohmann::json;
 // Helper: URL Decode
 std::string urlDecode(const std::string &SRC) {
     std::string ret;
-    char ch;
     for (size_t i=0; i<SRC.length(); i++) {
         if (SRC[i]=='%') {
             if (i+2 < SRC.length()) {
@@ -75,12 +82,313 @@ std::string urlDecode(const std::string &SRC) {
 // Per-socket user data
 #include "socket_data.h"
 
+using WebSocket = uWS::WebSocket<false, true, PerSocketData>;
+
+// Event loop running on the current thread (nullptr on non-loop threads)
+static thread_local uWS::Loop* currentLoop = nullptr;
+
+// Sockets owned by this loop, and the ones currently congested (output
+// above the high watermark; see SendLimits)
+static thread_local std::unordered_set<WebSocket*> loopSockets;
+static thread_local std::unordered_set<WebSocket*> congestedSockets;
+
+// Sockets with a cork batch on this loop (may repeat; emptied batches are
+// skipped), and when the loop's oldest batched frame was written
+static thread_local std::vector<WebSocket*> corkedSockets;
+static thread_local std::chrono::steady_clock::time_point corkedSince{};
+
+// A batch this large is written at once: it fills uWS's cork buffer
+static constexpr size_t kCorkFlushBytes = 16 * 1024;
+
+// DATABASE messages held for auth admission on this loop, in arrival
+// order, and the timer that releases them (armed while any are held)
+struct HeldMessage {
+    int64_t readyNs;
+    void* ws;
+    uint64_t connectionId;
+    const MessageTypeEntry* entry;
+    json msg;
+};
+static thread_local std::deque<HeldMessage> heldMessages;
+static thread_local us_timer_t* heldTimer = nullptr;
+static constexpr int kHeldTimerMs = 5;
+
+// Reader for this loop's JSON text frames (one frame at a time), and when
+// the frame being handled arrived
+static thread_local InboundMessage inbound;
+static thread_local std::chrono::steady_clock::time_point frameReceivedAt;
+
+// Set on a DB executor thread while it runs a task for one socket: the
+// socket, the loop that owns it and the task's session copy
+struct DbTaskContext {
+    void* ws;
+    uint64_t connectionId;
+    uWS::Loop* loop;
+    SocketSession* session;
+    SocketSession mirrored;  // Session as last posted to the loop
+};
+static thread_local DbTaskContext* dbTask = nullptr;
+
+// This loop's heartbeat (nullptr when the stall watchdog is off)
+static thread_local LoopWatchdog::Heartbeat* loopHeartbeat = nullptr;
+
+// What this loop is running, reported if it stalls (a string literal)
+static void setLoopActivity(const char* activity) {
+    if (loopHeartbeat) {
+        loopHeartbeat->setActivity(activity);
+    }
+}
+
+// Message type names are string literals: usable as an activity
+static const char* activityOf(const MessageTypeEntry& entry) {
+    return entry.kind == MessageKind::UNKNOWN ? "unknown message" : entry.name.data();
+}
+
+// Session state of a socket: the task's copy on a DB thread, the live
+// PerSocketData on the socket's loop
+static SocketSession* sessionOf(WebSocket* ws) {
+    if (dbTask && dbTask->ws == ws) {
+        return dbTask->session;
+    }
+    return ws->getUserData();
+}
+
+// ============================================================================
+// METRICS (served on /metrics)
+// ============================================================================
+
+using chatbox::logging::PerformanceMonitor;
+
+// Handler latency by message type (messageTypeIndex) and where it ran:
+// "loop" is the event loop's share (parse, dispatch, inline handlers),
+// "db" the handler's run on a DB executor thread
+struct HandlerHistograms {
+    std::array<PerformanceMonitor::Histogram*, message_types::kTypeCount + 1> loop;
+    std::array<PerformanceMonitor::Histogram*, message_types::kTypeCount + 1> db;
+};
+
+static const HandlerHistograms& handlerHistograms() {
+    static const HandlerHistograms histograms = [] {
+        HandlerHistograms h;
+        for (size_t i = 0; i <= message_types::kTypeCount; i++) {
+            std::string type = i < message_types::kTypeCount ? std::string(kMessageTypes[i].name) : "unknown";
+            h.loop[i] = &PerformanceMonitor::histogram("chatbox_handler_seconds", "type=\"" + type + "\",exec=\"loop\"");
+            h.db[i] = &PerformanceMonitor::histogram("chatbox_handler_seconds", "type=\"" + type + "\",exec=\"db\"");
+        }
+        return h;
+    }();
+    return histograms;
+}
+
+static PerformanceMonitor::Histogram& fanoutHistogram() {
+    static auto& histogram = PerformanceMonitor::histogram("chatbox_fanout_recipients", "",
+                                                           PerformanceMonitor::Unit::COUNT);
+    return histogram;
+}
+
+static PerformanceMonitor::Counter& sendBytesCounter(bool publish) {
+    static auto& direct = PerformanceMonitor::counter("chatbox_send_bytes_total", "path=\"direct\"");
+    static auto& published = PerformanceMonitor::counter("chatbox_send_bytes_total", "path=\"publish\"");
+    return publish ? published : direct;
+}
+
+// Does a Sec-WebSocket-Protocol list ("a, b, c") offer `protocol`?
+static bool offersSubprotocol(std::string_view offered, std::string_view protocol) {
+    while (!offered.empty()) {
+        size_t comma = offered.find(',');
+        std::string_view item = offered.substr(0, comma);
+        size_t first = item.find_first_not_of(' ');
+        size_t last = item.find_last_not_of(' ');
+        if (first != std::string_view::npos && item.substr(first, last - first + 1) == protocol) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        offered.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// ChatBox1 packet types accepted in BINARY frames, mapped to the JSON type
+// whose auth/exec policy they share
+static const MessageTypeEntry& binaryMessageType(uint32_t msgType) {
+    switch (msgType) {
+        case MSG_CHAT_TEXT:     return lookupMessageType("chat");
+        case MSG_TYPING_START:
+        case MSG_TYPING_STOP:   return lookupMessageType("typing");
+        case MSG_ADD_REACTION:  return lookupMessageType("add_reaction");
+        case MSG_MESSAGE_READ:  return lookupMessageType("mark_read");
+        case MSG_HEARTBEAT:
+        case MSG_PING:          return lookupMessageType("ping");
+        case MSG_FILE_CHUNK:    return lookupMessageType("upload_chunk");
+        default:                return message_types::kUnknown;
+    }
+}
+
+// Fixed-size payload struct at the start of a packet payload
+template <typename T>
+static bool readPayload(std::string_view payload, T& out) {
+    if (payload.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&out, payload.data(), sizeof(T));
+    return true;
+}
+
+// Hot-path packet decoded from either header version; handled the same way
+struct BinaryMessage {
+    uint32_t msgType = 0;
+    std::string roomId;
+    std::string messageId;
+    std::string emoji;
+    std::string text;
+    std::string transferId;
+    uint32_t chunkIndex = 0;
+    std::string_view chunk;  // Into the frame: file chunks are handled on the loop
+};
+
+// v1: fixed-size payload structs (room in the payload, or the header topic)
+static bool decodeV1(const PacketHeader& header, std::string_view payload, BinaryMessage& out) {
+    using ProtocolChatBox1::fieldString;
+    out.msgType = header.msgType;
+    out.roomId = fieldString(header.topic, sizeof(header.topic));
+    
+    switch (header.msgType) {
+        case MSG_CHAT_TEXT: {
+            ChatTextPayload chat;
+            if (!readPayload(payload, chat) || payload.size() - sizeof(chat) < chat.messageLen) {
+                return false;
+            }
+            out.roomId = fieldString(chat.roomId, sizeof(chat.roomId));
+            out.text = std::string(payload.substr(sizeof(chat), chat.messageLen));
+            return true;
+        }
+        case MSG_ADD_REACTION: {
+            ReactionPayload reaction;
+            if (!readPayload(payload, reaction)) {
+                return false;
+            }
+            out.messageId = fieldString(reaction.messageId, sizeof(reaction.messageId));
+            out.emoji = fieldString(reaction.emoji, sizeof(reaction.emoji));
+            return true;
+        }
+        case MSG_MESSAGE_READ: {
+            ReadReceiptPayload receipt;
+            if (!readPayload(payload, receipt)) {
+                return false;
+            }
+            out.roomId = fieldString(receipt.roomId, sizeof(receipt.roomId));
+            out.messageId = fieldString(receipt.messageId, sizeof(receipt.messageId));
+            return true;
+        }
+        case MSG_FILE_CHUNK: {
+            FileChunkPayload chunk;
+            if (!readPayload(payload, chunk) || payload.size() - sizeof(chunk) < chunk.chunkSize) {
+                return false;
+            }
+            out.transferId = fieldString(chunk.transferId, sizeof(chunk.transferId));
+            out.chunkIndex = chunk.chunkIndex;
+            out.chunk = payload.substr(sizeof(chunk), chunk.chunkSize);
+            return true;
+        }
+        default:
+            return true;  // No payload used (typing, ping) or not a binary type
+    }
+}
+
+// v2: varint / length-prefixed fields, room = interned topic
+static bool decodeV2(const PacketHeaderV2& header, const std::string& topic, std::string_view payload,
+                     BinaryMessage& out) {
+    out.msgType = header.msgType;
+    out.roomId = topic;
+    
+    std::string_view field;
+    switch (header.msgType) {
+        case MSG_CHAT_TEXT:
+            out.text = std::string(payload);
+            return true;
+        case MSG_ADD_REACTION:
+            if (!ProtocolChatBox1::readString(payload, field)) {
+                return false;
+            }
+            out.messageId = std::string(field);
+            if (!ProtocolChatBox1::readString(payload, field)) {
+                return false;
+            }
+            out.emoji = std::string(field);
+            return true;
+        case MSG_MESSAGE_READ:
+            if (!ProtocolChatBox1::readString(payload, field)) {
+                return false;
+            }
+            out.messageId = std::string(field);
+            return true;
+        case MSG_FILE_CHUNK: {
+            uint64_t chunkIndex;
+            if (!ProtocolChatBox1::readString(payload, field) || !ProtocolChatBox1::readVarint(payload, chunkIndex)) {
+                return false;
+            }
+            out.transferId = std::string(field);
+            out.chunkIndex = static_cast<uint32_t>(chunkIndex);
+            out.chunk = payload;
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+// uWS topics used for fan-out (every authenticated socket joins kBroadcastTopic)
+static const std::string kBroadcastTopic = "broadcast";
+
+static std::string roomTopic(const std::string& roomId) {
+    return "room:" + roomId;
+}
+
+static std::string userTopic(const std::string& userId) {
+    return "user:" + userId;
+}
+
+// The payload is shared by every recipient; WebSocket::send frames it and
+// keeps uWS's bookkeeping (closed sockets, maxBackpressure, idle timeout).
+// Compressed frames use the socket's deflate state (sliding window or shared).
+static void writeMessage(WebSocket* ws, const PreparedMessage& message, bool compress) {
+    ws->send(message.payload(), message.opCode(), compress);
+}
+
+// uWS compressor option for the configured mode. Inbound frames always use
+// the shared decompressor: clients rarely send large messages.
+static uWS::CompressOptions compressOptions(const CompressionSettings& settings) {
+    switch (settings.mode) {
+        case CompressionMode::SHARED:
+            return uWS::CompressOptions(uWS::SHARED_COMPRESSOR | uWS::SHARED_DECOMPRESSOR);
+        case CompressionMode::DEDICATED: {
+            uWS::CompressOptions window = uWS::DEDICATED_COMPRESSOR_4KB;
+            switch (settings.windowKb) {
+                case 3: window = uWS::DEDICATED_COMPRESSOR_3KB; break;
+                case 8: window = uWS::DEDICATED_COMPRESSOR_8KB; break;
+                case 16: window = uWS::DEDICATED_COMPRESSOR_16KB; break;
+                case 32: window = uWS::DEDICATED_COMPRESSOR_32KB; break;
+                case 64: window = uWS::DEDICATED_COMPRESSOR_64KB; break;
+                case 128: window = uWS::DEDICATED_COMPRESSOR_128KB; break;
+                case 256: window = uWS::DEDICATED_COMPRESSOR_256KB; break;
+                default: break;
+            }
+            return uWS::CompressOptions(window | uWS::SHARED_DECOMPRESSOR);
+        }
+        default:
+            return uWS::DISABLED;
+    }
+}
+
 WebSocketServer::WebSocketServer(int port,
                                    std::shared_ptr<PubSubBroker> broker,
                                    std::shared_ptr<AuthManager> authManager,
                                    std::shared_ptr<GeminiClient> geminiClient)
     : port_(port)
     , running_(false)
+    , eventLoopCount_(1)
     , broker_(broker)
     , authManager_(authManager)
     , geminiClient_(geminiClient)
@@ -93,6 +401,14 @@ WebSocketServer::WebSocketServer(int port,
         this->sendToUser(userId, message);
     });
     
+    // File/voice messages fan out through the room topic like chat messages
+    fileHandler_->setRoomBroadcastCallback([this](const std::string& roomId, const PreparedMessage::Ptr& message) {
+        this->broadcastToRoom(roomId, message);
+    });
+    fileHandler_->setSendCallback([this](void* ws, const PreparedMessage::Ptr& message) {
+        this->sendJsonMessage(ws, message);
+    });
+    
     Logger::info("✓ WebSocket server khởi tạo với Protocol Support trên port " + std::to_string(port));
 }
 
@@ -101,24 +417,128 @@ WebSocketServer::~WebSocketServer() {
     Logger::info("WebSocket server destroyed");
 }
 
+void WebSocketServer::setEventLoopCount(unsigned count) {
+    eventLoopCount_ = count;
+}
+
+void WebSocketServer::setCompression(const CompressionSettings& settings) {
+    compression_ = CompressionPolicy(settings);
+}
+
+void WebSocketServer::setSendLimits(const SendLimits& limits) {
+    sendLimits_ = limits;
+}
+
+void WebSocketServer::setPresenceWindow(std::chrono::milliseconds window) {
+    presenceWindow_ = window;
+}
+
+void WebSocketServer::setDbExecutor(size_t workers, size_t queueLimit) {
+    dbWorkers_ = workers;
+    dbQueueLimit_ = queueLimit;
+}
+
+void WebSocketServer::setAiLimits(const AiScheduler::Limits& limits) {
+    aiLimits_ = limits;
+}
+
+void WebSocketServer::setCorkDeadline(std::chrono::microseconds deadline) {
+    corkDeadline_ = deadline;
+}
+
+void WebSocketServer::setRateLimits(const RateLimits& limits) {
+    rateLimits_ = limits;
+}
+
+void WebSocketServer::setAdmission(const AdmissionLimits& limits) {
+    admissionLimits_ = limits;
+}
+
+void WebSocketServer::setTracing(const TraceSettings& settings) {
+    MessageTrace::configure(settings);
+}
+
+void WebSocketServer::setStallWatchdog(std::chrono::milliseconds threshold) {
+    stallThreshold_ = threshold;
+}
+
+void WebSocketServer::setBootstrapRefresh(std::chrono::seconds directory, std::chrono::milliseconds render) {
+    directoryRefresh_ = directory;
+    bootstrap_.setRenderInterval(render);
+}
+
 void WebSocketServer::run() {
     running_ = true;
     
+    if (eventLoopCount_ == 0) {
+        eventLoopCount_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
     Logger::info("========================================");
     Logger::info("Starting REAL WebSocket with Protocol...");
     Logger::info("Port: " + std::to_string(port_));
+    Logger::info("Event loops: " + std::to_string(eventLoopCount_));
     Logger::info("========================================");
     
+    // Ensure "uploads" directory exists (once, before any loop serves /upload)
     try {
-        // Create uWebSockets app
-        uWS::App app;
-        
-        // Ensure "uploads" directory exists
         namespace fs = std::filesystem;
         if (!fs::exists("uploads")) {
             fs::create_directory("uploads");
             Logger::info("Created uploads directory");
         }
+    } catch (const std::exception& e) {
+        Logger::error("Failed to create uploads directory: " + std::string(e.what()));
+    }
+    
+    rateLimiter_ = std::make_unique<RateLimiter>(rateLimits_);
+    admission_ = std::make_unique<AuthAdmission>(admissionLimits_);
+    
+    // Blocking MySQL work runs here, never on a loop thread
+    dbExecutor_ = std::make_unique<DbExecutor>(dbWorkers_, dbQueueLimit_);
+    
+    // Loops that stop beating (a blocking call on a loop thread) are reported
+    if (stallThreshold_.count() > 0) {
+        watchdog_ = std::make_unique<LoopWatchdog>(stallThreshold_);
+    }
+    
+    // Gemini calls take seconds: own pool, so they never hold a loop or a DB worker
+    if (geminiClient_) {
+        aiScheduler_ = std::make_unique<AiScheduler>(geminiClient_, aiLimits_);
+    }
+    
+    // Each extra loop runs its own uWS::App on its own thread. uSockets opens
+    // listen sockets with SO_REUSEPORT, so the kernel spreads new connections
+    // across loops and each loop owns the sockets it accepted.
+    for (unsigned i = 1; i < eventLoopCount_; i++) {
+        loopThreads_.emplace_back([this, i]() { runEventLoop(i); });
+    }
+    runEventLoop(0);
+    
+    for (auto& thread : loopThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    loopThreads_.clear();
+    if (aiScheduler_) {
+        aiScheduler_->stop();
+    }
+    dbExecutor_->stop();
+    if (watchdog_) {
+        watchdog_->stop();
+    }
+    
+    Logger::info("WebSocket server stopped");
+}
+
+void WebSocketServer::runEventLoop(unsigned loopIndex) {
+    // uWS::Loop::get() lazily creates the thread-local loop the App will use
+    currentLoop = uWS::Loop::get();
+    
+    try {
+        // Create uWebSockets app
+        uWS::App app;
         
         // CORS helper
         auto addCors = [](auto* res) {
@@ -129,6 +549,7 @@ void WebSocketServer::run() {
 
         // POST /upload - Streaming mode for LARGE files (1GB+)
         app.post("/upload", [addCors](auto* res, auto* req) {
+            setLoopActivity("POST /upload");
             std::string rawFilename = std::string(req->getHeader("x-filename"));
             std::string originalFilename = urlDecode(rawFilename);
             
@@ -153,9 +574,9 @@ void WebSocketServer::run() {
             }
             
             // Simple random number
-            static std::random_device rd;
-            static std::mt19937 gen(rd());
-            static std::uniform_int_distribution<> dis(0, 9999);
+            static thread_local std::random_device rd;
+            static thread_local std::mt19937 gen(rd());
+            static thread_local std::uniform_int_distribution<> dis(0, 9999);
             
             std::string storageFilename = "file_" + std::to_string(timestamp) + "_" + std::to_string(dis(gen)) + extension;
             std::string path = "uploads/" + storageFilename;
@@ -187,6 +608,7 @@ void WebSocketServer::run() {
             Logger::info("Starting large file upload: " + originalFilename);
 
             res->onData([res, state, addCors](std::string_view chunk, bool isLast) {
+                setLoopActivity("POST /upload (data)");
                 // Write chunk directly to disk (no RAM buffering)
                 state->file.write(chunk.data(), chunk.size());
                 state->totalBytes += chunk.size();
@@ -241,6 +663,7 @@ void WebSocketServer::run() {
 
         // GET /uploads/:filename
         app.get("/uploads/:filename", [addCors](auto* res, auto* req) {
+            setLoopActivity("GET /uploads/:filename");
             std::string filename = std::string(req->getParameter(0));
             std::string path = "uploads/" + filename;
             
@@ -261,6 +684,7 @@ void WebSocketServer::run() {
 
         // POST /user/avatar (Update Profile Picture)
         app.post("/user/avatar", [this, addCors](auto* res, auto* req) {
+            setLoopActivity("POST /user/avatar");
             std::string authHeader = std::string(req->getHeader("authorization"));
             
             // Basic validation
@@ -280,38 +704,54 @@ void WebSocketServer::run() {
                 return;
             }
 
-            res->onData([this, res, userId = sessionInfo->userId, addCors, buffer = std::make_shared<std::string>()](std::string_view chunk, bool isLast) mutable {
+            auto aborted = std::make_shared<bool>(false);
+            res->onData([this, res, aborted, userId = sessionInfo->userId, addCors, buffer = std::make_shared<std::string>()](std::string_view chunk, bool isLast) mutable {
+                setLoopActivity("POST /user/avatar (data)");
                 // Buffer the JSON body
                 buffer->append(chunk);
                 
                 if (isLast) {
+                    std::string avatarUrl;
                     try {
                         json j = json::parse(*buffer);
-                        std::string avatarUrl = j["avatarUrl"];
-                        
-                        if (authManager_->updateAvatar(userId, avatarUrl)) {
-                            json response = {
-                                {"status", "ok"},
-                                {"message", "Avatar updated"}
-                            };
-                            addCors(res);
-                            res->writeHeader("Content-Type", "application/json");
-                            res->end(response.dump());
-                            Logger::info("Avatar updated for user: " + userId);
-                        } else {
-                            addCors(res);
-                            res->writeStatus("500 Internal Server Error")->end("Failed to update avatar");
-                        }
+                        avatarUrl = j["avatarUrl"];
                     } catch (const std::exception& e) {
                         addCors(res);
                         res->writeStatus("400 Bad Request")->end("Invalid JSON");
+                        return;
                     }
                     buffer->clear();
+                    
+                    // UPDATE on the DB executor, response back on this loop
+                    bool queued = dbExecutor_->submit(0, [this, res, aborted, userId, avatarUrl, addCors, loop = currentLoop]() {
+                        bool updated = authManager_->updateAvatar(userId, avatarUrl);
+                        loop->defer([res, aborted, userId, updated, addCors]() {
+                            if (*aborted) {
+                                return;
+                            }
+                            addCors(res);
+                            if (updated) {
+                                json response = {
+                                    {"status", "ok"},
+                                    {"message", "Avatar updated"}
+                                };
+                                res->writeHeader("Content-Type", "application/json");
+                                res->end(response.dump());
+                                Logger::info("Avatar updated for user: " + userId);
+                            } else {
+                                res->writeStatus("500 Internal Server Error")->end("Failed to update avatar");
+                            }
+                        });
+                    });
+                    if (!queued) {
+                        addCors(res);
+                        res->writeStatus("503 Service Unavailable")->end("Server busy");
+                    }
                 }
             });
             
-            res->onAborted([]() {
-                // Handle abortion
+            res->onAborted([aborted]() {
+                *aborted = true;  // res is gone: a pending DB completion must not touch it
             });
         });
 
@@ -323,1209 +763,1673 @@ void WebSocketServer::run() {
 
         // WebSocket route với PerSocketData
         app.ws<PerSocketData>("/*", {
+            .compression = compressOptions(compression_.settings()),
             .maxPayloadLength = 16 * 1024 * 1024,
             .idleTimeout = 120,
+            // Only topic publishes can reach this: direct sends queue at the
+            // high watermark (sweepSlowConsumers diverts congested sockets)
+            .maxBackpressure = static_cast<unsigned int>(sendLimits_.hardLimit),
+            .closeOnBackpressureLimit = false,
+            
+            // Upgrade: clients offering CHATBOX1_SUBPROTOCOL may send binary packets
+            .upgrade = [](auto* res, auto* req, auto* context) {
+                std::string_view protocols = req->getHeader("sec-websocket-protocol");
+                bool binary = offersSubprotocol(protocols, CHATBOX1_SUBPROTOCOL);
+                
+                PerSocketData data;
+                data.binaryProtocol = binary;
+                res->template upgrade<PerSocketData>(std::move(data),
+                                                     req->getHeader("sec-websocket-key"),
+                                                     binary ? std::string_view(CHATBOX1_SUBPROTOCOL) : protocols,
+                                                     req->getHeader("sec-websocket-extensions"),
+                                                     context);
+            },
             
             // Connection opened
             .open = [this](auto* ws) {
+                setLoopActivity("ws open");
                 PerSocketData* data = ws->getUserData();
                 data->authenticated = false;
                 
                 Logger::info("✓ Client connected (WebSocket)");
                 
                 // Store connection - cast to void* and store websocket pointer
-                {
-                    std::lock_guard<std::mutex> lock(connectionsMutex_);
-                    ConnectionState state;
-                    state.wsPtr = (void*)ws;  // Store raw pointer for broadcast
-                    connections_[(void*)ws] = state;
-                    
-                    Logger::info("  Total connections: " + std::to_string(connections_.size()));
-                }
+                data->connectionId = connections_.add((void*)ws, currentLoop);
+                data->dbSession = std::make_shared<SocketSession>(static_cast<const SocketSession&>(*data));
+                loopSockets.insert(ws);
+                Logger::info("  Total connections: " + std::to_string(connections_.size()));
             },
             
             // Message received - PROTOCOL HANDLING
             .message = [this](auto* ws, std::string_view message, uWS::OpCode opCode) {
-                PerSocketData* data = ws->getUserData();
-                
+                if (opCode == uWS::OpCode::BINARY) {
+                    handleBinaryFrame((void*)ws, message);
+                    return;
+                }
+                PerformanceMonitor::Timer timer;  // Loop time, once the type is known
+                frameReceivedAt = timer.startedAt();
+                setLoopActivity("ws message (parse)");
                 try {
-                    // Convert string_view to string for JSON parsing
-                    std::string msgStr(message.data(), message.size());
-                    
-                    // Parse JSON message
-                    json msg = json::parse(msgStr);
-                    std::string type = msg.value("type", "");
-                    
-                    Logger::info("📨 Message type: " + type);
-                    
-                    if (type == "register") {
-                        handleRegisterJson((void*)ws, msgStr);
-                    }
-                    else if (type == "login") {
-                        handleLoginJson((void*)ws, msgStr);
-                    }
-                    else if (type == "auth") {
-                        // Authenticate WebSocket with existing JWT token
-                        std::string token = msg.value("token", "");
-                        if (!token.empty()) {
-                            auto sessionInfo = authManager_->getSessionFromToken(token);
-                            if (sessionInfo) {
-                                data->authenticated = true;
-                                data->userId = sessionInfo->userId;
-                                data->username = sessionInfo->username;
-                                data->sessionId = "ws-session-" + sessionInfo->userId;
-                                
-                                // IMPORTANT: Also update connections_ map for sendToUser to work
-                                {
-                                    std::lock_guard<std::mutex> lock(connectionsMutex_);
-                                    connections_[(void*)ws].authenticated = true;
-                                    connections_[(void*)ws].userId = sessionInfo->userId;
-                                    connections_[(void*)ws].username = sessionInfo->username;
-                                }
-                                
-                                json response = {
-                                    {"type", "auth_response"},
-                                    {"success", true},
-                                    {"userId", sessionInfo->userId},
-                                    {"username", sessionInfo->username}
-                                };
-                                sendJsonMessage((void*)ws, response.dump());
-                                Logger::info("✓ WebSocket authenticated via token: " + sessionInfo->username);
-                                
-                                // Auto-send online users list after auth success
-                                handleGetOnlineUsersJson((void*)ws);
-                            } else {
-                                sendErrorJson((void*)ws, "Invalid token");
-                                Logger::warning("✗ WebSocket auth failed: invalid token");
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Token required");
-                        }
-                    }
-                    else if (type == "chat") {
-                        if (data->authenticated) {
-                            handleChatMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "typing") {
-                        if (data->authenticated) {
-                            handleTypingJson((void*)ws, msgStr);
-                        }
-                    }
-                    else if (type == "get_online_users") {
-                        if (data->authenticated) {
-                            handleGetOnlineUsersJson((void*)ws);
-                        }
-                    }
-                    else if (type == "edit_message") {
-                        if (data->authenticated) {
-                            handleEditMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "delete_message") {
-                        if (data->authenticated) {
-                            handleDeleteMessageJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "add_reaction") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string emoji = msg.value("emoji", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "reaction_added"},
-                                {"messageId", messageId},
-                                {"emoji", emoji},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            // Send to sender
-                            sendJsonMessage((void*)ws, response.dump());
-                            // Broadcast to room
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("👍 Reaction added by " + data->username + ": " + emoji);
-                        }
-                    }
-                    else if (type == "pin_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "message_pinned"},
-                                {"messageId", messageId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("📌 Message pinned by " + data->username);
-                        }
-                    }
-                    else if (type == "unpin_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            json response = {
-                                {"type", "message_unpinned"},
-                                {"messageId", messageId},
-                                {"roomId", roomId}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("📌 Message unpinned by " + data->username);
-                        }
-                    }
-                    else if (type == "reply_message") {
-                        if (data->authenticated) {
-                            std::string content = msg.value("content", "");
-                            std::string replyToId = msg.value("replyToId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            // Create message with replyToId
-                            std::string messageId = "msg-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
-                            
-                            json response = {
-                                {"type", "chat"},
-                                {"messageId", messageId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username},
-                                {"content", content},
-                                {"replyToId", replyToId},
-                                {"timestamp", std::time(nullptr) * 1000}
-                            };
-                            
-                            sendJsonMessage((void*)ws, response.dump());
-                            broadcastToRoom(roomId, response.dump(), data->sessionId);
-                            Logger::info("↩️ Reply sent by " + data->username);
-                        }
-                    }
-                    else if (type == "create_room") {
-                        if (data->authenticated) {
-                            handleCreateRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "join_room") {
-                        if (data->authenticated) {
-                            handleJoinRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
+                    // On-demand read: the type first, hot types then pull their
+                    // fields straight from the frame; the rest get a full document
+                    if (!inbound.parse(message)) {
+                        if (admit((void*)ws, message_types::kUnknown)) {
+                            sendErrorJson((void*)ws, "Invalid JSON");
                         }
+                        return;
                     }
-                    else if (type == "leave_room") {
-                        if (data->authenticated) {
-                            handleLeaveRoomJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
+                    std::string_view type = inbound.type();
+                    
+                    LOG_INFO_F("📨 Message type: {}", type);
+                    
+                    const MessageTypeEntry& entry = lookupMessageType(type);
+                    timer.setHistogram(*handlerHistograms().loop[messageTypeIndex(entry)]);
+                    setLoopActivity(activityOf(entry));
+                    if (!admit((void*)ws, entry)) {
+                        return;
                     }
-                    else if (type == "get_rooms") {
-                        if (data->authenticated) {
-                            handleGetRoomsJson((void*)ws);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
+                    if (entry.kind == MessageKind::UNKNOWN) {
+                        LOG_WARN_F("Unknown message type: {}", type);
+                        sendErrorJson((void*)ws, "Unknown message type");
+                        return;
                     }
-                    else if (type == "search_messages") {
-                        if (data->authenticated) {
-                            handleSearchMessagesJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
+                    if (handleInbound((void*)ws, entry, inbound)) {
+                        return;
                     }
-                    else if (type == "mark_read") {
-                        if (data->authenticated) {
-                            handleMarkReadJson((void*)ws, msgStr);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
+                    json msg = inbound.toJson();
+                    
+                    // MySQL work never runs on the loop (policy lives in kMessageTypes)
+                    if (entry.exec == ExecPolicy::DATABASE) {
+                        if (holdForAdmission((void*)ws, entry, msg)) {
+                            return;
                         }
+                        runOnDbExecutor((void*)ws, entry, [this, ws, &entry, msg = std::move(msg)]() {
+                            handleMessage((void*)ws, entry, msg);
+                        });
+                        return;
                     }
-                    else if (type == "ping") {
-                        // Respond with pong
-                        json response = {
-                            {"type", "pong"},
-                            {"timestamp", std::time(nullptr)}
-                        };
-                        std::string responseStr = response.dump();
-                        ws->send(responseStr, opCode);
-                    }
-                    // ============== WebRTC Call Signaling ==============
-                    else if (type == "call_init") {
-                        if (data->authenticated) {
-                            std::string targetId = msg.value("targetId", "");
-                            std::string callType = msg.value("callType", "video");
-                            
-                            // Generate a simple call ID
-                            std::string callId = "call-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
-                            
-                            // Send call_incoming directly to target user
-                            json incomingCall = {
-                                {"type", "call_incoming"},
-                                {"callId", callId},
-                                {"callerId", data->userId},
-                                {"callerName", data->username},
-                                {"callType", callType}
-                            };
-                            sendToUser(targetId, incomingCall.dump());
-                            
-                            // Send confirmation to caller
-                            json response = {
-                                {"type", "call_init_response"},
-                                {"success", true},
-                                {"callId", callId},
-                                {"message", "Calling " + targetId + "..."}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("📞 Call initiated by " + data->username + " to " + targetId + " (callId: " + callId + ")");
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_accept") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string callerId = msg.value("callerId", "");
-                            
-                            // Send call_accepted to caller
-                            json acceptMsg = {
-                                {"type", "call_accepted"},
-                                {"callId", callId},
-                                {"accepterId", data->userId},
-                                {"accepterName", data->username}
-                            };
-                            sendToUser(callerId, acceptMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_accept_response"},
-                                {"success", true},
-                                {"message", "Call accepted"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("✅ Call accepted: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_reject") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string callerId = msg.value("callerId", "");
-                            std::string reason = msg.value("reason", "declined");
-                            
-                            // Send call_rejected to caller
-                            json rejectMsg = {
-                                {"type", "call_rejected"},
-                                {"callId", callId},
-                                {"rejecterId", data->userId},
-                                {"reason", reason}
-                            };
-                            sendToUser(callerId, rejectMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_reject_response"},
-                                {"success", true},
-                                {"message", "Call rejected"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("❌ Call rejected: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "call_end") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            
-                            // Send call_ended to other party
-                            json endMsg = {
-                                {"type", "call_ended"},
-                                {"callId", callId},
-                                {"endedBy", data->userId}
-                            };
-                            sendToUser(targetId, endMsg.dump());
-                            
-                            json response = {
-                                {"type", "call_end_response"},
-                                {"success", true},
-                                {"message", "Call ended"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                            Logger::info("📴 Call ended: " + callId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "webrtc_offer") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string sdp = msg.value("sdp", "");
-                            
-                            webrtcHandler_->sendOffer(callId, data->userId, targetId, sdp);
-                            Logger::info("📡 WebRTC Offer forwarded: " + callId);
-                        }
+                    handleMessage((void*)ws, entry, msg);
+                    
+                } catch (const json::exception& e) {
+                    Logger::error("JSON parse error: " + std::string(e.what()));
+                    sendErrorJson((void*)ws, "Invalid JSON");
+                } catch (const simdjson::simdjson_error& e) {
+                    Logger::error("JSON parse error: " + std::string(e.what()));
+                    sendErrorJson((void*)ws, "Invalid JSON");
+                } catch (const std::exception& e) {
+                    Logger::error("Message handling error: " + std::string(e.what()));
+                    sendErrorJson((void*)ws, "Internal error");
+                }
+            },
+            
+            // Socket flushed part of its buffer: resume queued output
+            .drain = [this](auto* ws) {
+                setLoopActivity("ws drain");
+                if (ws->getBufferedAmount() <= sendLimits_.lowWatermark) {
+                    flushSendQueue((void*)ws);
+                }
+            },
+            .ping = [](auto* ws, std::string_view) {},
+            .pong = [](auto* ws, std::string_view) {},
+            
+            // Connection closed
+            .close = [this](auto* ws, int code, std::string_view message) {
+                setLoopActivity("ws close");
+                PerSocketData* data = ws->getUserData();
+                
+                // Remove connection (drops it from the user/session/room indexes).
+                // The registry entry is authoritative: a DB task may have
+                // authenticated the socket before its session copy came back.
+                auto removed = connections_.remove((void*)ws);
+                loopSockets.erase(ws);
+                congestedSockets.erase(ws);
+                std::erase(corkedSockets, ws);
+                data->sendQueue.clear();
+                data->corked.clear();
+                
+                if (removed && removed->authenticated && connections_.userConnectionCount(removed->userId) > 0) {
+                    // Another device of this user is still connected: stay online
+                    Logger::info("Client disconnected: " + removed->username + " (other devices still online)");
+                } else if (removed && removed->authenticated) {
+                    Logger::info("Client disconnected: " + removed->username);
+                    
+                    // Offline presence (broadcast + DB) goes out with the next batch
+                    presence_.offline(removed->userId, removed->username);
+                } else {
+                    Logger::info("Client disconnected (not authenticated)");
+                }
+            }
+        });
+        
+        // HTTP health check
+        app.get("/health", [this](auto* res, auto* req) {
+            setLoopActivity("GET /health");
+            auto stats = dbExecutor_->stats();
+            json health = {
+                {"status", "ok"},
+                {"service", "chatbox-websocket"},
+                {"eventLoops", eventLoopCount_},
+                {"dbExecutor", {
+                    {"workers", stats.workers},
+                    {"queueDepth", stats.queueDepth},
+                    {"maxQueueDepth", stats.maxQueueDepth},
+                    {"completed", stats.completed},
+                    {"rejected", stats.rejected},
+                    {"avgWaitMs", stats.avgWaitMs},
+                    {"maxWaitMs", stats.maxWaitMs},
+                    {"avgRunMs", stats.avgRunMs}
+                }}
+            };
+            uint64_t frames = corkFrames_.load(std::memory_order_relaxed);
+            uint64_t flushes = corkFlushes_.load(std::memory_order_relaxed);
+            health["writeCork"] = {
+                {"deadlineUs", corkDeadline_.count()},
+                {"frames", frames},
+                {"flushes", flushes},
+                {"deadlineFlushes", corkDeadlineFlushes_.load(std::memory_order_relaxed)},
+                {"framesPerFlush", flushes ? static_cast<double>(frames) / flushes : 0.0}
+            };
+            auto rate = rateLimiter_->stats();
+            json throttledByType = json::object();
+            for (size_t i = 0; i < message_types::kTypeCount; i++) {
+                if (rate.throttledByType[i] > 0) {
+                    throttledByType[std::string(kMessageTypes[i].name)] = rate.throttledByType[i];
+                }
+            }
+            if (rate.throttledByType[message_types::kTypeCount] > 0) {
+                throttledByType["unknown"] = rate.throttledByType[message_types::kTypeCount];
+            }
+            health["rateLimit"] = {
+                {"throttled", rate.throttled},
+                {"disconnected", rate.disconnected},
+                {"throttledByType", throttledByType}
+            };
+            auto admission = admission_->stats(RateLimiter::nowNs());
+            health["admission"] = {
+                {"ratePerSecond", admission_->ratePerSecond()},
+                {"admitted", admission.admitted},
+                {"rejected", admission.rejected},
+                {"queued", admission.queued},
+                {"backlogMs", admission.backlogMs}
+            };
+            auto bootstrap = bootstrap_.stats();
+            health["bootstrap"] = {
+                {"users", bootstrap.users},
+                {"directoryLoads", bootstrap.loads},
+                {"directoryAgeMs", bootstrap.directoryAgeMs},
+                {"renders", bootstrap.renders},
+                {"served", bootstrap.served}
+            };
+            if (watchdog_) {
+                auto watchdog = watchdog_->stats();
+                health["loopWatchdog"] = {
+                    {"thresholdMs", watchdog.thresholdMs},
+                    {"stalls", watchdog.stalls},
+                    {"detected", watchdog.detected},
+                    {"maxStallMs", watchdog.maxStallMs}
+                };
+            }
+            if (aiScheduler_) {
+                auto ai = aiScheduler_->stats();
+                health["ai"] = {
+                    {"workers", ai.workers},
+                    {"queueDepth", ai.queueDepth},
+                    {"completed", ai.completed},
+                    {"failed", ai.failed},
+                    {"rejected", ai.rejected},
+                    {"avgRunMs", ai.avgRunMs}
+                };
+            }
+            res->writeStatus("200 OK")
+               ->writeHeader("Content-Type", "application/json")
+               ->end(health.dump());
+        });
+
+        // Prometheus scrape: histograms / counters merged across threads,
+        // plus point-in-time gauges
+        app.get("/metrics", [this](auto* res, auto* req) {
+            setLoopActivity("GET /metrics");
+            auto db = dbExecutor_->stats();
+            auto logs = Logger::stats();
+            PerformanceMonitor::recordGauge("chatbox_connections", static_cast<double>(connections_.size()));
+            PerformanceMonitor::recordGauge("chatbox_db_queue_depth", static_cast<double>(db.queueDepth));
+            PerformanceMonitor::recordGauge("chatbox_log_written", static_cast<double>(logs.written));
+            PerformanceMonitor::recordGauge("chatbox_log_dropped", static_cast<double>(logs.dropped));
+            res->writeStatus("200 OK")
+               ->writeHeader("Content-Type", "text/plain; version=0.0.4")
+               ->end(PerformanceMonitor::getMetrics());
+        });
+
+        // Listen (every loop binds the same port; SO_REUSEPORT is the uSockets default)
+        bool listening = false;
+        app.listen(port_, [this, loopIndex, &listening](auto* listenSocket) {
+            listening = listenSocket != nullptr;
+            if (listenSocket && loopIndex > 0) {
+                Logger::info("✅ Event loop " + std::to_string(loopIndex) + " listening on port " + std::to_string(port_));
+            } else if (listenSocket) {
+                Logger::info("========================================");
+                Logger::info("✅ WebSocket server LIVE!");
+                Logger::info("========================================"); 
+                Logger::info("Listening on: 0.0.0.0:" + std::to_string(port_));
+                Logger::info("WebSocket: ws://localhost:" + std::to_string(port_) + "/");
+                Logger::info("Health: http://localhost:" + std::to_string(port_) + "/health");
+                Logger::info("Metrics: http://localhost:" + std::to_string(port_) + "/metrics");
+                Logger::info("");
+                Logger::info("Protocol: ChatBox v1");
+                Logger::info("  - register: Create new account");
+                Logger::info("  - login: Authenticate user");
+                Logger::info("  - chat: Send message");
+                Logger::info("  - ping: Keep-alive");
+                Logger::info("========================================");
+                Logger::info("");
+                Logger::info("Ready for protocol messages! 🚀");
+                Logger::info("");
+            } else {
+                Logger::error("❌ Failed to listen on port " + std::to_string(port_) +
+                              " (event loop " + std::to_string(loopIndex) + ")");
+                running_ = false;
+            }
+        });
+        
+        // Without a listen socket, armed timers would keep app.run() spinning
+        // forever: arm nothing and leave
+        if (!listening) {
+            currentLoop = nullptr;
+            return;
+        }
+        
+        // Make this loop's app visible to publish()
+        {
+            std::lock_guard<std::mutex> lock(loopsMutex_);
+            loops_.push_back({currentLoop, &app});
+        }
+        
+        // Cork batches go out once per loop iteration, after every handler,
+        // deferred delivery and timer of the iteration has written
+        currentLoop->addPostHandler(&corkedSockets, [this](uWS::Loop*) {
+            // Handlers done (stall watchdog): a stall so far is theirs, and
+            // the flush gets its own beat so it is only blamed for itself
+            if (loopHeartbeat) {
+                loopHeartbeat->beat();
+            }
+            setLoopActivity("flush_corked");
+            flushCorked();
+            if (loopHeartbeat) {
+                loopHeartbeat->beat();
+            }
+        });
+        
+        // Log timestamps come from a clock cached once per iteration
+        currentLoop->addPreHandler(this, [](uWS::Loop*) {
+            Logger::tick();
+        });
+        
+        // Slow consumer sweep, once per second on this loop
+        us_timer_t* sweepTimer = us_create_timer((us_loop_t*)currentLoop, 0, sizeof(WebSocketServer*));
+        *static_cast<WebSocketServer**>(us_timer_ext(sweepTimer)) = this;
+        us_timer_set(sweepTimer, [](us_timer_t* timer) {
+            (*static_cast<WebSocketServer**>(us_timer_ext(timer)))->sweepSlowConsumers();
+        }, 1000, 1000);
+        
+        // Presence batches are flushed by the first loop only
+        us_timer_t* presenceTimer = nullptr;
+        us_timer_t* bootstrapTimer = nullptr;
+        if (loopIndex == 0) {
+            int windowMs = static_cast<int>(presenceWindow_.count());
+            presenceTimer = us_create_timer((us_loop_t*)currentLoop, 0, sizeof(WebSocketServer*));
+            *static_cast<WebSocketServer**>(us_timer_ext(presenceTimer)) = this;
+            us_timer_set(presenceTimer, [](us_timer_t* timer) {
+                (*static_cast<WebSocketServer**>(us_timer_ext(timer)))->flushPresence();
+            }, windowMs, windowMs);
+            
+            // User directory: loaded now (before the reconnect storm), then kept fresh
+            refreshBootstrap();
+            int refreshMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(directoryRefresh_).count());
+            bootstrapTimer = us_create_timer((us_loop_t*)currentLoop, 0, sizeof(WebSocketServer*));
+            *static_cast<WebSocketServer**>(us_timer_ext(bootstrapTimer)) = this;
+            us_timer_set(bootstrapTimer, [](us_timer_t* timer) {
+                (*static_cast<WebSocketServer**>(us_timer_ext(timer)))->refreshBootstrap();
+            }, refreshMs, refreshMs);
+        }
+        
+        // Held auth/login messages (armed on demand by holdForAdmission)
+        heldTimer = us_create_timer((us_loop_t*)currentLoop, 0, sizeof(WebSocketServer*));
+        *static_cast<WebSocketServer**>(us_timer_ext(heldTimer)) = this;
+        
+        // Stall watchdog: the wakeup alone beats the heartbeat of an idle loop
+        us_timer_t* heartbeatTimer = nullptr;
+        if (watchdog_) {
+            loopHeartbeat = watchdog_->attach(loopIndex);
+            int periodMs = static_cast<int>(watchdog_->heartbeatPeriod().count());
+            heartbeatTimer = us_create_timer((us_loop_t*)currentLoop, 0, 0);
+            us_timer_set(heartbeatTimer, [](us_timer_t*) {}, periodMs, periodMs);
+        }
+        
+        app.run();
+        
+        if (heartbeatTimer) {
+            watchdog_->detach(loopHeartbeat);
+            loopHeartbeat = nullptr;
+            us_timer_close(heartbeatTimer);
+        }
+        currentLoop->removePostHandler(&corkedSockets);
+        currentLoop->removePreHandler(this);
+        us_timer_close(sweepTimer);
+        if (presenceTimer) {
+            us_timer_close(presenceTimer);
+        }
+        if (bootstrapTimer) {
+            us_timer_close(bootstrapTimer);
+        }
+        us_timer_close(heldTimer);
+        heldTimer = nullptr;
+        heldMessages.clear();
+        
+    } catch (const std::exception& e) {
+        Logger::error("WebSocket server error (event loop " + std::to_string(loopIndex) + "): " + std::string(e.what()));
+        running_ = false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(loopsMutex_);
+        loops_.erase(std::remove_if(loops_.begin(), loops_.end(),
+                                    [](const LoopHandle& handle) { return handle.loop == currentLoop; }),
+                     loops_.end());
+    }
+    currentLoop = nullptr;
+}
+
+bool WebSocketServer::admit(void* wsPtr, const MessageTypeEntry& entry) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    int64_t now = RateLimiter::nowNs();
+    
+    switch (rateLimiter_->check(data->rate, entry, now)) {
+        case RateLimiter::Verdict::ALLOW:
+            return true;
+        case RateLimiter::Verdict::THROTTLE: {
+            // Rendered once; at most one reply per second while flooding
+            static const PreparedMessage::Ptr kRateLimited = PreparedMessage::create(json{
+                {"type", "error"},
+                {"code", "rate_limited"},
+                {"message", "Too many requests, slow down"}
+            });
+            if (now - data->rate.lastReplyNs >= 1'000'000'000) {
+                data->rate.lastReplyNs = now;
+                sendQueued(wsPtr, kRateLimited, false);
+            }
+            return false;
+        }
+        case RateLimiter::Verdict::DISCONNECT:
+            rateLimiter_->recordDisconnect();
+            Logger::warning("⚠️ Disconnecting flooding client " +
+                            (data->username.empty() ? std::string("(not authenticated)") : data->username));
+            ws->end(1008, "Rate limit exceeded");
+            return false;
+    }
+    return false;
+}
+
+bool WebSocketServer::holdForAdmission(void* wsPtr, const MessageTypeEntry& entry, json& msg) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    bool paced = entry.kind == MessageKind::AUTH || entry.kind == MessageKind::LOGIN;
+    if (!paced && data->heldMessages == 0) {
+        return false;
+    }
+    
+    int64_t now = RateLimiter::nowNs();
+    int64_t readyNs = now;  // Not paced: released right after the held auth
+    if (paced) {
+        auto ticket = admission_->reserve(now);
+        if (!ticket.admitted) {
+            json response = {
+                {"type", entry.kind == MessageKind::LOGIN ? "login_response" : "auth_response"},
+                {"success", false},
+                {"message", "Server busy, please retry"},
+                {"retryAfterMs", ticket.waitNs / 1'000'000 + 1}
+            };
+            sendJsonMessage(wsPtr, response.dump());
+            return true;
+        }
+        if (ticket.waitNs == 0 && data->heldMessages == 0) {
+            return false;
+        }
+        readyNs = now + ticket.waitNs;
+    }
+    
+    heldMessages.push_back({readyNs, wsPtr, data->connectionId, &entry, std::move(msg)});
+    data->heldMessages++;
+    if (heldMessages.size() == 1) {
+        us_timer_set(heldTimer, onHeldTimer, kHeldTimerMs, kHeldTimerMs);
+    }
+    return true;
+}
+
+void WebSocketServer::releaseHeldMessages() {
+    setLoopActivity("release_held_messages");
+    // Slots only grow, so the front is due first (a message held behind a
+    // later auth waits for it: at most a few ms)
+    int64_t now = RateLimiter::nowNs();
+    while (!heldMessages.empty() && heldMessages.front().readyNs <= now) {
+        HeldMessage held = std::move(heldMessages.front());
+        heldMessages.pop_front();
+        if (!connections_.isAlive(held.ws, held.connectionId)) {
+            continue;  // Closed while waiting
+        }
+        static_cast<WebSocket*>(held.ws)->getUserData()->heldMessages--;
+        runOnDbExecutor(held.ws, *held.entry, [this, wsPtr = held.ws, entry = held.entry, msg = std::move(held.msg)]() {
+            handleMessage(wsPtr, *entry, msg);
+        });
+    }
+    if (heldMessages.empty()) {
+        us_timer_set(heldTimer, onHeldTimer, 0, 0);  // Disarm
+    }
+}
+
+void WebSocketServer::onHeldTimer(us_timer_t* timer) {
+    (*static_cast<WebSocketServer**>(us_timer_ext(timer)))->releaseHeldMessages();
+}
+
+bool WebSocketServer::authorize(void* wsPtr, const MessageTypeEntry& entry, const SocketSession& session) {
+    // Auth check for every type in one place (policy lives in kMessageTypes)
+    if (entry.auth != AuthPolicy::NONE && !session.authenticated) {
+        if (entry.auth == AuthPolicy::REQUIRED) {
+            sendErrorJson(wsPtr, "Not authenticated");
+        }
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketServer::handleInbound(void* wsPtr, const MessageTypeEntry& entry, InboundMessage& msg) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+
+    switch (entry.kind) {
+        case MessageKind::CHAT:
+        case MessageKind::MARK_READ: {
+            if (data->heldMessages > 0) {
+                return false;  // Queued behind a held auth (holdForAdmission)
+            }
+            // Fields copied out on the loop; the task carries no frame views
+            std::string roomId(msg.getString("roomId", "global"));
+            if (entry.kind == MessageKind::MARK_READ) {
+                runOnDbExecutor(wsPtr, entry, [this, wsPtr, &entry, roomId = std::move(roomId),
+                                               messageId = std::string(msg.getString("messageId"))]() {
+                    if (authorize(wsPtr, entry, *sessionOf(static_cast<WebSocket*>(wsPtr)))) {
+                        handleMarkRead(wsPtr, messageId, roomId);
                     }
-                    else if (type == "webrtc_answer") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string sdp = msg.value("sdp", "");
-                            
-                            webrtcHandler_->sendAnswer(callId, data->userId, targetId, sdp);
-                            Logger::info("📡 WebRTC Answer forwarded: " + callId);
+                });
+                return true;
+            }
+            // Attachments only: small, and parsed here so the task cannot throw on it
+            std::string_view rawMetadata = msg.getRawObject("metadata");
+            json metadata = rawMetadata.empty() ? json(nullptr) : json::parse(rawMetadata);
+            MessageTrace::Ptr trace = MessageTrace::sample(frameReceivedAt);
+            if (trace) {
+                trace->mark(MessageTrace::Stage::PARSED);
+            }
+            runOnDbExecutor(wsPtr, entry, [this, wsPtr, &entry, roomId = std::move(roomId),
+                                           content = std::string(msg.getString("content")),
+                                           metadata = std::move(metadata), trace = std::move(trace)]() mutable {
+                if (trace) {
+                    trace->mark(MessageTrace::Stage::DEQUEUED);
+                }
+                if (authorize(wsPtr, entry, *sessionOf(static_cast<WebSocket*>(wsPtr)))) {
+                    handleChatMessage(wsPtr, roomId, content, metadata, std::move(trace));
+                }
+            });
+            return true;
+        }
+        case MessageKind::TYPING:
+        case MessageKind::PING:
+        case MessageKind::ADD_REACTION:
+        case MessageKind::PRESENCE_UPDATE:
+        case MessageKind::WEBRTC_ICE:
+        case MessageKind::WATCH_SYNC:
+            break;
+        default:
+            return false;  // Cold type: full document
+    }
+
+    if (!authorize(wsPtr, entry, *data)) {
+        return true;
+    }
+    switch (entry.kind) {
+        case MessageKind::TYPING: {
+            handleTyping(wsPtr, msg.getBool("isTyping", false));
+            break;
+        }
+        case MessageKind::PING: {
+            sendJsonMessage(wsPtr, "{\"type\":\"pong\",\"timestamp\":" + std::to_string(std::time(nullptr)) + "}");
+            break;
+        }
+        case MessageKind::ADD_REACTION: {
+            std::string messageId(msg.getString("messageId"));
+            std::string emoji(msg.getString("emoji"));
+            handleReaction(wsPtr, messageId, emoji, std::string(msg.getString("roomId")));
+            break;
+        }
+        case MessageKind::PRESENCE_UPDATE: {
+            std::string status(msg.getString("status", "online"));
+            LOG_INFO_F("👤 Presence update from {}: {}", data->username, status);
+
+            // Goes out with the next presence_batch
+            presence_.setStatus(data->userId, data->username, status);
+            break;
+        }
+        case MessageKind::WEBRTC_ICE: {
+            std::string callId(msg.getString("callId"));
+            std::string targetId(msg.getString("targetId"));
+            webrtcHandler_->sendIceCandidate(callId, data->userId, targetId, std::string(msg.getString("candidate")));
+            LOG_DEBUG_F("🧊 ICE Candidate forwarded: {}", callId);
+            break;
+        }
+        case MessageKind::WATCH_SYNC: {
+            json syncMsg = {
+                {"type", "watch_sync"},
+                {"action", msg.getString("action")},
+                {"time", msg.getDouble("time", 0.0)},
+                {"syncedBy", data->username}
+            };
+            broadcast(syncMsg.dump());
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
+
+void WebSocketServer::handleMessage(void* wsPtr, const MessageTypeEntry& entry, const json& msg) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    SocketSession* data = sessionOf(ws);
+    
+    try {
+        if (!authorize(wsPtr, entry, *data)) {
+            return;
+        }
+        
+        switch (entry.kind) {
+            case MessageKind::REGISTER: {
+                handleRegisterJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::LOGIN: {
+                handleLoginJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::AUTH: {
+                // Authenticate WebSocket with existing JWT token
+                std::string token = msg.value("token", "");
+                if (!token.empty()) {
+                    auto sessionInfo = authManager_->getSessionFromToken(token);
+                    if (sessionInfo) {
+                        data->authenticated = true;
+                        data->userId = sessionInfo->userId;
+                        data->username = sessionInfo->username;
+                        data->sessionId = "ws-session-" + sessionInfo->userId + "-" + std::to_string(data->connectionId);
+                        
+                        // IMPORTANT: Also index in connections_ for sendToUser to work
+                        // (false if the socket closed while this task was queued)
+                        if (connections_.authenticate((void*)ws, data->userId, data->username, data->sessionId)) {
+                            presence_.online(data->userId, data->username);
                         }
+                        subscribeSocket((void*)ws, data->userId);
+                        
+                        json response = {
+                            {"type", "auth_response"},
+                            {"success", true},
+                            {"userId", sessionInfo->userId},
+                            {"username", sessionInfo->username}
+                        };
+                        sendJsonMessage((void*)ws, response.dump());
+                        Logger::info("✓ WebSocket authenticated via token: " + sessionInfo->username);
+                        
+                        // Auto-send online users list after auth success
+                        handleGetOnlineUsersJson((void*)ws);
+                    } else {
+                        sendErrorJson((void*)ws, "Invalid token");
+                        Logger::warning("✗ WebSocket auth failed: invalid token");
                     }
-                    else if (type == "webrtc_ice") {
-                        if (data->authenticated) {
-                            std::string callId = msg.value("callId", "");
-                            std::string targetId = msg.value("targetId", "");
-                            std::string candidate = msg.value("candidate", "");
-                            
-                            webrtcHandler_->sendIceCandidate(callId, data->userId, targetId, candidate);
-                            Logger::debug("🧊 ICE Candidate forwarded: " + callId);
-                        }
+                } else {
+                    sendErrorJson((void*)ws, "Token required");
+                }
+                break;
+            }
+            case MessageKind::CHAT: {
+                handleChatMessageJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::GET_ONLINE_USERS: {
+                handleGetOnlineUsersJson((void*)ws);
+                break;
+            }
+            case MessageKind::EDIT_MESSAGE: {
+                handleEditMessageJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::DELETE_MESSAGE: {
+                handleDeleteMessageJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::PIN_MESSAGE: {
+                std::string messageId = msg.value("messageId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                json response = {
+                    {"type", "message_pinned"},
+                    {"messageId", messageId},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username}
+                };
+                
+                sendJsonMessage((void*)ws, response.dump());
+                broadcastToRoom(roomId, response.dump(), data->sessionId);
+                Logger::info("📌 Message pinned by " + data->username);
+                break;
+            }
+            case MessageKind::UNPIN_MESSAGE: {
+                std::string messageId = msg.value("messageId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                json response = {
+                    {"type", "message_unpinned"},
+                    {"messageId", messageId},
+                    {"roomId", roomId}
+                };
+                
+                sendJsonMessage((void*)ws, response.dump());
+                broadcastToRoom(roomId, response.dump(), data->sessionId);
+                Logger::info("📌 Message unpinned by " + data->username);
+                break;
+            }
+            case MessageKind::REPLY_MESSAGE: {
+                std::string content = msg.value("content", "");
+                std::string replyToId = msg.value("replyToId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                // Create message with replyToId
+                std::string messageId = "msg-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
+                
+                json response = {
+                    {"type", "chat"},
+                    {"messageId", messageId},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username},
+                    {"content", content},
+                    {"replyToId", replyToId},
+                    {"timestamp", std::time(nullptr) * 1000}
+                };
+                
+                sendJsonMessage((void*)ws, response.dump());
+                broadcastToRoom(roomId, response.dump(), data->sessionId);
+                Logger::info("↩️ Reply sent by " + data->username);
+                break;
+            }
+            case MessageKind::CREATE_ROOM: {
+                handleCreateRoomJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::JOIN_ROOM: {
+                handleJoinRoomJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::LEAVE_ROOM: {
+                handleLeaveRoomJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::GET_ROOMS: {
+                handleGetRoomsJson((void*)ws);
+                break;
+            }
+            case MessageKind::SEARCH_MESSAGES: {
+                handleSearchMessagesJson((void*)ws, msg);
+                break;
+            }
+            case MessageKind::MARK_READ: {
+                handleMarkReadJson((void*)ws, msg);
+                break;
+            }
+            // ============== WebRTC Call Signaling ==============
+            case MessageKind::CALL_INIT: {
+                std::string targetId = msg.value("targetId", "");
+                std::string callType = msg.value("callType", "video");
+                
+                // Generate a simple call ID
+                std::string callId = "call-" + std::to_string(std::time(nullptr)) + "-" + data->userId.substr(0, 8);
+                
+                // Send call_incoming directly to target user
+                json incomingCall = {
+                    {"type", "call_incoming"},
+                    {"callId", callId},
+                    {"callerId", data->userId},
+                    {"callerName", data->username},
+                    {"callType", callType}
+                };
+                sendToUser(targetId, incomingCall.dump());
+                
+                // Send confirmation to caller
+                json response = {
+                    {"type", "call_init_response"},
+                    {"success", true},
+                    {"callId", callId},
+                    {"message", "Calling " + targetId + "..."}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("📞 Call initiated by " + data->username + " to " + targetId + " (callId: " + callId + ")");
+                break;
+            }
+            case MessageKind::CALL_ACCEPT: {
+                std::string callId = msg.value("callId", "");
+                std::string callerId = msg.value("callerId", "");
+                
+                // Send call_accepted to caller
+                json acceptMsg = {
+                    {"type", "call_accepted"},
+                    {"callId", callId},
+                    {"accepterId", data->userId},
+                    {"accepterName", data->username}
+                };
+                sendToUser(callerId, acceptMsg.dump());
+                
+                json response = {
+                    {"type", "call_accept_response"},
+                    {"success", true},
+                    {"message", "Call accepted"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("✅ Call accepted: " + callId);
+                break;
+            }
+            case MessageKind::CALL_REJECT: {
+                std::string callId = msg.value("callId", "");
+                std::string callerId = msg.value("callerId", "");
+                std::string reason = msg.value("reason", "declined");
+                
+                // Send call_rejected to caller
+                json rejectMsg = {
+                    {"type", "call_rejected"},
+                    {"callId", callId},
+                    {"rejecterId", data->userId},
+                    {"reason", reason}
+                };
+                sendToUser(callerId, rejectMsg.dump());
+                
+                json response = {
+                    {"type", "call_reject_response"},
+                    {"success", true},
+                    {"message", "Call rejected"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("❌ Call rejected: " + callId);
+                break;
+            }
+            case MessageKind::CALL_END: {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                
+                // Send call_ended to other party
+                json endMsg = {
+                    {"type", "call_ended"},
+                    {"callId", callId},
+                    {"endedBy", data->userId}
+                };
+                sendToUser(targetId, endMsg.dump());
+                
+                json response = {
+                    {"type", "call_end_response"},
+                    {"success", true},
+                    {"message", "Call ended"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                Logger::info("📴 Call ended: " + callId);
+                break;
+            }
+            case MessageKind::WEBRTC_OFFER: {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                std::string sdp = msg.value("sdp", "");
+                
+                webrtcHandler_->sendOffer(callId, data->userId, targetId, sdp);
+                Logger::info("📡 WebRTC Offer forwarded: " + callId);
+                break;
+            }
+            case MessageKind::WEBRTC_ANSWER: {
+                std::string callId = msg.value("callId", "");
+                std::string targetId = msg.value("targetId", "");
+                std::string sdp = msg.value("sdp", "");
+                
+                webrtcHandler_->sendAnswer(callId, data->userId, targetId, sdp);
+                Logger::info("📡 WebRTC Answer forwarded: " + callId);
+                break;
+            }
+            // ============== Profile Update ==============
+            case MessageKind::PROFILE_UPDATE: {
+                std::string displayName = msg.value("displayName", "");
+                std::string statusMessage = msg.value("statusMessage", "");
+                std::string avatar = msg.value("avatar", "");
+                
+                Logger::info("👤 Profile update from " + data->username);
+                
+                // Save to database
+                bool saved = false;
+                try {
+                    auto session = dbClient_->getSession();
+                    if (session) {
+                        session->sql(
+                            "UPDATE users SET "
+                            "display_name = COALESCE(NULLIF(?, ''), display_name), "
+                            "status_message = ?, "
+                            "avatar_url = COALESCE(NULLIF(?, ''), avatar_url) "
+                            "WHERE user_id = ?"
+                        ).bind(displayName, statusMessage, avatar, data->userId).execute();
+                        saved = true;
+                        Logger::info("✅ Profile saved to database");
                     }
-                    // ============== Presence Status ==============
-                    else if (type == "presence_update") {
-                        if (data->authenticated) {
-                            std::string status = msg.value("status", "online");
-                            Logger::info("👤 Presence update from " + data->username + ": " + status);
-                            
-                            // Broadcast to all connections
-                            json broadcastMsg = {
-                                {"type", "presence_update"},
-                                {"userId", data->userId},
-                                {"username", data->username},
-                                {"status", status}
-                            };
-                            broadcast(broadcastMsg.dump());
-                        }
+                } catch (const std::exception& e) {
+                    Logger::warning("Failed to save profile: " + std::string(e.what()));
+                }
+                
+                // Broadcast the update
+                json broadcastMsg = {
+                    {"type", "profile_updated"},
+                    {"userId", data->userId},
+                    {"displayName", displayName.empty() ? data->username : displayName},
+                    {"statusMessage", statusMessage},
+                    {"avatar", avatar}
+                };
+                broadcast(broadcastMsg.dump());
+                
+                // Confirm to sender
+                json response = {
+                    {"type", "profile_update_response"},
+                    {"success", saved},
+                    {"message", saved ? "Profile updated successfully" : "Profile updated (broadcast only)"}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                break;
+            }
+            // ============== Change Password ==============
+            case MessageKind::CHANGE_PASSWORD: {
+                std::string currentPassword = msg.value("currentPassword", "");
+                std::string newPassword = msg.value("newPassword", "");
+                
+                Logger::info("🔐 Change password request from " + data->username);
+                
+                // Use AuthManager's changePassword method
+                std::string error = authManager_->changePassword(data->userId, currentPassword, newPassword);
+                bool success = error.empty();
+                
+                if (success) {
+                    Logger::info("✅ Password changed successfully for " + data->username);
+                } else {
+                    Logger::warning("❌ Password change failed for " + data->username + ": " + error);
+                }
+                
+                json response = {
+                    {"type", "change_password_response"},
+                    {"success", success},
+                    {"message", success ? "Password changed successfully" : error}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                break;
+            }
+            // ============== AI Chat (Gemini) ==============
+            case MessageKind::AI_REQUEST: {
+                if (!aiScheduler_) {
+                    sendErrorJson((void*)ws, "AI service not available");
+                    break;
+                }
+                
+                std::string message = msg.value("message", "");
+                Logger::info("🤖 AI request from " + data->username + ": " + message.substr(0, 50) + "...");
+                
+                // Answered from an AI worker, delivered on this socket's loop
+                auto admission = aiScheduler_->submit(data->userId, message,
+                    [this, socket = socketRef((void*)ws)](std::optional<std::string> result) {
+                        json responseJson = {
+                            {"type", "ai_response"},
+                            {"response", result.value_or("No response from AI")}
+                        };
+                        postToSocket(socket, [this, payload = responseJson.dump()](void* socketWs) {
+                            sendJsonMessage(socketWs, payload);
+                        });
+                    });
+                
+                if (admission != AiScheduler::Admission::ACCEPTED) {
+                    json errorJson = {
+                        {"type", "ai_error"},
+                        {"message", AiScheduler::describe(admission)}
+                    };
+                    sendJsonMessage((void*)ws, errorJson.dump());
+                }
+                break;
+            }
+            // ============== Polls ==============
+            case MessageKind::POLL_CREATE: {
+                std::string roomId = msg.value("roomId", "global");
+                std::string question = msg.value("question", "");
+                auto options = msg.value("options", json::array());
+                
+                uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                std::string pollId = "poll-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
+                
+                // Create poll struct for database
+                Poll pollData;
+                pollData.pollId = pollId;
+                pollData.roomId = roomId;
+                pollData.question = question;
+                pollData.createdBy = data->userId;
+                pollData.createdAt = now;
+                pollData.isClosed = false;
+                
+                json pollOptions = json::array();
+                int optIdx = 0;
+                for (const auto& opt : options) {
+                    // Include pollId in optId to make it unique across polls
+                    std::string optId = pollId + "-opt-" + std::to_string(optIdx);
+                    PollOption optData;
+                    optData.optionId = optId;
+                    optData.text = opt.get<std::string>();
+                    optData.index = optIdx;
+                    optData.voteCount = 0;
+                    pollData.options.push_back(optData);
+                    
+                    pollOptions.push_back({
+                        {"id", optId},
+                        {"text", opt.get<std::string>()},
+                        {"votes", 0},
+                        {"voters", json::array()}
+                    });
+                    optIdx++;
+                }
+                
+                // Save to database
+                auto db = authManager_->getDatabase();
+                if (db && db->createPoll(pollData)) {
+                    Logger::info("✅ Poll saved to database: " + pollId);
+                }
+                
+                json poll = {
+                    {"id", pollId},
+                    {"question", question},
+                    {"options", pollOptions},
+                    {"createdBy", data->userId},
+                    {"createdAt", now},
+                    {"isClosed", false}
+                };
+                
+                json broadcastMsg = {
+                    {"type", "poll_created"},
+                    {"roomId", roomId},
+                    {"poll", poll}
+                };
+                
+                // For DM rooms, send to both users
+                if (roomId.substr(0, 3) == "dm_") {
+                    // Extract target user ID from dm_targetUserId format
+                    std::string targetUserId = roomId.substr(3);
+                    // Send to target user with their perspective roomId
+                    std::string targetRoomId = "dm_" + data->userId;
+                    json targetMsg = broadcastMsg;
+                    targetMsg["roomId"] = targetRoomId;
+                    sendToUser(targetUserId, targetMsg.dump());
+                    // Send to sender
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                    Logger::info("📊 Poll sent to DM: " + roomId + " and " + targetRoomId);
+                } else {
+                    // Broadcast to ALL users in room (including creator for confirmation)
+                    broadcastToRoom(roomId, broadcastMsg.dump());
+                }
+                Logger::info("📊 Poll created by " + data->username + ": " + question);
+                break;
+            }
+            case MessageKind::POLL_VOTE: {
+                std::string pollId = msg.value("pollId", "");
+                std::string optionId = msg.value("optionId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                // Save vote to database
+                PollVote vote;
+                vote.pollId = pollId;
+                vote.optionId = optionId;
+                vote.userId = data->userId;
+                vote.username = data->username;
+                
+                auto db = authManager_->getDatabase();
+                if (db && db->votePoll(vote)) {
+                    Logger::info("✅ Vote saved to database");
+                }
+                
+                json broadcastMsg = {
+                    {"type", "poll_vote"},
+                    {"pollId", pollId},
+                    {"optionId", optionId},
+                    {"roomId", roomId},
+                    {"userId", data->userId},
+                    {"username", data->username}
+                };
+                
+                // For DM rooms, send to both users
+                if (!roomId.empty() && roomId.substr(0, 3) == "dm_") {
+                    std::string targetUserId = roomId.substr(3);
+                    std::string targetRoomId = "dm_" + data->userId;
+                    json targetMsg = broadcastMsg;
+                    targetMsg["roomId"] = targetRoomId;
+                    sendToUser(targetUserId, targetMsg.dump());
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                } else if (!roomId.empty()) {
+                    broadcastToRoom(roomId, broadcastMsg.dump());
+                } else {
+                    sendJsonMessage((void*)ws, broadcastMsg.dump());
+                }
+                Logger::info("🗳️ Vote cast by " + data->username + " in room " + roomId);
+                break;
+            }
+            case MessageKind::POLL_CLOSE: {
+                std::string pollId = msg.value("pollId", "");
+                
+                auto db = authManager_->getDatabase();
+                if (db) {
+                    auto poll = db->getPoll(pollId);
+                    if (poll && poll->createdBy == data->userId) {
+                        db->closePoll(pollId);
+                        
+                        json broadcastMsg = {
+                            {"type", "poll_closed"},
+                            {"pollId", pollId}
+                        };
+                        broadcast(broadcastMsg.dump());
+                        Logger::info("📊 Poll closed: " + pollId);
+                    } else {
+                        sendErrorJson((void*)ws, "Only poll creator can close the poll");
                     }
-                    // ============== Profile Update ==============
-                    else if (type == "profile_update") {
-                        if (data->authenticated) {
-                            std::string displayName = msg.value("displayName", "");
-                            std::string statusMessage = msg.value("statusMessage", "");
-                            std::string avatar = msg.value("avatar", "");
-                            
-                            Logger::info("👤 Profile update from " + data->username);
-                            
-                            // Save to database
-                            bool saved = false;
-                            try {
-                                auto session = dbClient_->getSession();
-                                if (session) {
-                                    session->sql(
-                                        "UPDATE users SET "
-                                        "display_name = COALESCE(NULLIF(?, ''), display_name), "
-                                        "status_message = ?, "
-                                        "avatar_url = COALESCE(NULLIF(?, ''), avatar_url) "
-                                        "WHERE user_id = ?"
-                                    ).bind(displayName, statusMessage, avatar, data->userId).execute();
-                                    saved = true;
-                                    Logger::info("✅ Profile saved to database");
-                                }
-                            } catch (const std::exception& e) {
-                                Logger::warning("Failed to save profile: " + std::string(e.what()));
+                }
+                break;
+            }
+            case MessageKind::GET_ROOM_POLLS: {
+                std::string roomId = msg.value("roomId", "global");
+                bool activeOnly = msg.value("activeOnly", false);
+                
+                auto db = authManager_->getDatabase();
+                if (db) {
+                    auto polls = db->getRoomPolls(roomId, activeOnly);
+                    json pollsJson = json::array();
+                    
+                    for (const auto& poll : polls) {
+                        json optionsJson = json::array();
+                        for (const auto& opt : poll.options) {
+                            json votersJson = json::array();
+                            for (size_t i = 0; i < opt.voterIds.size(); i++) {
+                                votersJson.push_back(opt.voterNames[i]);
                             }
-                            
-                            // Broadcast the update
-                            json broadcastMsg = {
-                                {"type", "profile_updated"},
-                                {"userId", data->userId},
-                                {"displayName", displayName.empty() ? data->username : displayName},
-                                {"statusMessage", statusMessage},
-                                {"avatar", avatar}
-                            };
-                            broadcast(broadcastMsg.dump());
-                            
-                            // Confirm to sender
-                            json response = {
-                                {"type", "profile_update_response"},
-                                {"success", saved},
-                                {"message", saved ? "Profile updated successfully" : "Profile updated (broadcast only)"}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
+                            optionsJson.push_back({
+                                {"id", opt.optionId},
+                                {"text", opt.text},
+                                {"votes", opt.voteCount},
+                                {"voters", votersJson}
+                            });
                         }
+                        pollsJson.push_back({
+                            {"id", poll.pollId},
+                            {"question", poll.question},
+                            {"options", optionsJson},
+                            {"createdBy", poll.createdBy},
+                            {"createdAt", poll.createdAt},
+                            {"isClosed", poll.isClosed}
+                        });
                     }
-                    // ============== Change Password ==============
-                    else if (type == "change_password") {
-                        if (data->authenticated) {
-                            std::string currentPassword = msg.value("currentPassword", "");
-                            std::string newPassword = msg.value("newPassword", "");
-                            
-                            Logger::info("🔐 Change password request from " + data->username);
-                            
-                            // Use AuthManager's changePassword method
-                            std::string error = authManager_->changePassword(data->userId, currentPassword, newPassword);
-                            bool success = error.empty();
-                            
-                            if (success) {
-                                Logger::info("✅ Password changed successfully for " + data->username);
-                            } else {
-                                Logger::warning("❌ Password change failed for " + data->username + ": " + error);
-                            }
-                            
+                    
+                    json response = {
+                        {"type", "room_polls"},
+                        {"roomId", roomId},
+                        {"polls", pollsJson}
+                    };
+                    sendJsonMessage((void*)ws, response.dump());
+                }
+                break;
+            }
+            // ============== Games ==============
+            case MessageKind::GAME_INVITE: {
+                std::string gameType = msg.value("gameType", "tictactoe");
+                std::string opponentId = msg.value("opponentId", "");
+                std::string gameId = "game-" + std::to_string(std::time(nullptr));
+                
+                json inviteMsg = {
+                    {"type", "game_invite"},
+                    {"gameId", gameId},
+                    {"gameType", gameType},
+                    {"fromUser", data->username},
+                    {"fromUserId", data->userId}
+                };
+                
+                // Send to opponent
+                sendToUser(opponentId, inviteMsg.dump());
+                Logger::info("🎮 Game invite from " + data->username + " to " + opponentId);
+                break;
+            }
+            case MessageKind::GAME_ACCEPT: {
+                std::string gameId = msg.value("gameId", "");
+                
+                // Create initial game state
+                json gameState = {
+                    {"id", gameId},
+                    {"type", "tictactoe"},
+                    {"board", json::array({nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr})},
+                    {"currentTurn", data->userId},
+                    {"players", {{"X", data->userId}, {"O", ""}}},
+                    {"winner", nullptr},
+                    {"status", "playing"}
+                };
+                
+                json gameStartMsg = {
+                    {"type", "game_start"},
+                    {"gameId", gameId},
+                    {"game", gameState}
+                };
+                broadcast(gameStartMsg.dump());
+                Logger::info("🎮 Game started: " + gameId);
+                break;
+            }
+            case MessageKind::GAME_REJECT: {
+                std::string gameId = msg.value("gameId", "");
+                Logger::info("🎮 Game rejected: " + gameId);
+                break;
+            }
+            case MessageKind::GAME_MOVE: {
+                std::string gameId = msg.value("gameId", "");
+                int position = msg.value("position", -1);
+                
+                json moveMsg = {
+                    {"type", "game_state"},
+                    {"gameId", gameId},
+                    {"position", position},
+                    {"playerId", data->userId}
+                };
+                broadcast(moveMsg.dump());
+                Logger::info("🎮 Game move in " + gameId);
+                break;
+            }
+            // ============== Watch Together ==============
+            case MessageKind::WATCH_CREATE: {
+                std::string roomId = msg.value("roomId", "global");
+                std::string videoUrl = msg.value("videoUrl", "");
+                
+                json watchMsg = {
+                    {"type", "watch_session_created"},
+                    {"roomId", roomId},
+                    {"videoUrl", videoUrl},
+                    {"createdBy", data->username},
+                    {"viewerCount", 1}
+                };
+                broadcastToRoom(roomId, watchMsg.dump(), "");
+                Logger::info("📺 Watch session created by " + data->username);
+                break;
+            }
+            case MessageKind::WATCH_END: {
+                json endMsg = {
+                    {"type", "watch_ended"}
+                };
+                broadcast(endMsg.dump());
+                Logger::info("📺 Watch session ended");
+                break;
+            }
+            // ============== Chunked File Upload ==============
+            case MessageKind::UPLOAD_INIT: {
+                std::string roomId = msg.value("roomId", "global");
+                Logger::info("📤 Upload init from " + data->username);
+                
+                // Call FileHandler to initialize upload
+                fileHandler_->handleUploadInit((void*)ws, msg, data->userId, roomId);
+                break;
+            }
+            case MessageKind::UPLOAD_CHUNK: {
+                std::string uploadId = msg.value("uploadId", "");
+                int chunkIndex = msg.value("chunkIndex", 0);
+                Logger::debug("📦 Upload chunk " + std::to_string(chunkIndex) + " from " + data->username);
+                
+                // Call FileHandler to process chunk
+                fileHandler_->handleUploadChunk((void*)ws, msg, data->userId);
+                break;
+            }
+            case MessageKind::UPLOAD_FINALIZE: {
+                std::string uploadId = msg.value("uploadId", "");
+                Logger::info("✅ Upload finalize from " + data->username + " (" + uploadId + ")");
+                
+                // Call FileHandler to finalize upload
+                fileHandler_->handleUploadFinalize((void*)ws, msg, data->userId);
+                break;
+            }
+            // ============== Forward Message ==============
+            case MessageKind::FORWARD_MESSAGE: {
+                std::string messageId = msg.value("messageId", "");
+                std::string targetRoomId = msg.value("targetRoomId", "");
+                
+                if (messageId.empty() || targetRoomId.empty()) {
+                    sendErrorJson((void*)ws, "messageId and targetRoomId required");
+                } else {
+                    // Get original message from database
+                    auto originalMsg = dbClient_->getMessage(messageId);
+                    if (originalMsg) {
+                        // Create forwarded message
+                        uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                        std::string newMsgId = "msg-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
+                        
+                        Message forwardedMsg;
+                        forwardedMsg.messageId = newMsgId;
+                        forwardedMsg.roomId = targetRoomId;
+                        forwardedMsg.senderId = data->userId;
+                        forwardedMsg.senderName = data->username;
+                        forwardedMsg.content = originalMsg->content;
+                        forwardedMsg.timestamp = now;
+                        forwardedMsg.metadata = "{\"forwarded_from\": \"" + messageId + "\", \"original_sender\": \"" + originalMsg->senderName + "\"}";
+                        
+                        if (dbClient_->createMessage(forwardedMsg)) {
                             json response = {
-                                {"type", "change_password_response"},
-                                {"success", success},
-                                {"message", success ? "Password changed successfully" : error}
-                            };
-                            sendJsonMessage((void*)ws, response.dump());
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== AI Chat (Gemini) ==============
-                    else if (type == "ai_request") {
-                        if (data->authenticated && geminiClient_) {
-                            std::string message = msg.value("message", "");
-                            Logger::info("🤖 AI request from " + data->username + ": " + message.substr(0, 50) + "...");
-                            
-                            // Call Gemini API asynchronously
-                            std::thread([this, ws, message, userId = data->userId]() {
-                                try {
-                                    auto result = geminiClient_->sendMessage(message);
-                                    std::string response = result.value_or("No response from AI");
-                                    Logger::info("✅ AI response received");
-                                    
-                                    json responseJson = {
-                                        {"type", "ai_response"},
-                                        {"response", response}
-                                    };
-                                    
-                                    // Send response back to client
-                                    sendJsonMessage((void*)ws, responseJson.dump());
-                                } catch (const std::exception& e) {
-                                    Logger::error("❌ AI request failed: " + std::string(e.what()));
-                                    json errorJson = {
-                                        {"type", "ai_error"},
-                                        {"message", e.what()}
-                                    };
-                                    sendJsonMessage((void*)ws, errorJson.dump());
-                                }
-                            }).detach();
-                        } else if (!geminiClient_) {
-                            sendErrorJson((void*)ws, "AI service not available");
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Polls ==============
-                    else if (type == "poll_create") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            std::string question = msg.value("question", "");
-                            auto options = msg.value("options", json::array());
-                            
-                            uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                            std::string pollId = "poll-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                            
-                            // Create poll struct for database
-                            Poll pollData;
-                            pollData.pollId = pollId;
-                            pollData.roomId = roomId;
-                            pollData.question = question;
-                            pollData.createdBy = data->userId;
-                            pollData.createdAt = now;
-                            pollData.isClosed = false;
-                            
-                            json pollOptions = json::array();
-                            int optIdx = 0;
-                            for (const auto& opt : options) {
-                                // Include pollId in optId to make it unique across polls
-                                std::string optId = pollId + "-opt-" + std::to_string(optIdx);
-                                PollOption optData;
-                                optData.optionId = optId;
-                                optData.text = opt.get<std::string>();
-                                optData.index = optIdx;
-                                optData.voteCount = 0;
-                                pollData.options.push_back(optData);
-                                
-                                pollOptions.push_back({
-                                    {"id", optId},
-                                    {"text", opt.get<std::string>()},
-                                    {"votes", 0},
-                                    {"voters", json::array()}
-                                });
-                                optIdx++;
-                            }
-                            
-                            // Save to database
-                            auto db = authManager_->getDatabase();
-                            if (db && db->createPoll(pollData)) {
-                                Logger::info("✅ Poll saved to database: " + pollId);
-                            }
-                            
-                            json poll = {
-                                {"id", pollId},
-                                {"question", question},
-                                {"options", pollOptions},
-                                {"createdBy", data->userId},
-                                {"createdAt", now},
-                                {"isClosed", false}
-                            };
-                            
-                            json broadcastMsg = {
-                                {"type", "poll_created"},
-                                {"roomId", roomId},
-                                {"poll", poll}
-                            };
-                            
-                            // For DM rooms, send to both users
-                            if (roomId.substr(0, 3) == "dm_") {
-                                // Extract target user ID from dm_targetUserId format
-                                std::string targetUserId = roomId.substr(3);
-                                // Send to target user with their perspective roomId
-                                std::string targetRoomId = "dm_" + data->userId;
-                                json targetMsg = broadcastMsg;
-                                targetMsg["roomId"] = targetRoomId;
-                                sendToUser(targetUserId, targetMsg.dump());
-                                // Send to sender
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                                Logger::info("📊 Poll sent to DM: " + roomId + " and " + targetRoomId);
-                            } else {
-                                // Broadcast to ALL users in room (including creator for confirmation)
-                                broadcastToRoom(roomId, broadcastMsg.dump());
-                            }
-                            Logger::info("📊 Poll created by " + data->username + ": " + question);
-                        }
-                    }
-                    else if (type == "poll_vote") {
-                        if (data->authenticated) {
-                            std::string pollId = msg.value("pollId", "");
-                            std::string optionId = msg.value("optionId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            // Save vote to database
-                            PollVote vote;
-                            vote.pollId = pollId;
-                            vote.optionId = optionId;
-                            vote.userId = data->userId;
-                            vote.username = data->username;
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db && db->votePoll(vote)) {
-                                Logger::info("✅ Vote saved to database");
-                            }
-                            
-                            json broadcastMsg = {
-                                {"type", "poll_vote"},
-                                {"pollId", pollId},
-                                {"optionId", optionId},
-                                {"roomId", roomId},
-                                {"userId", data->userId},
-                                {"username", data->username}
-                            };
-                            
-                            // For DM rooms, send to both users
-                            if (!roomId.empty() && roomId.substr(0, 3) == "dm_") {
-                                std::string targetUserId = roomId.substr(3);
-                                std::string targetRoomId = "dm_" + data->userId;
-                                json targetMsg = broadcastMsg;
-                                targetMsg["roomId"] = targetRoomId;
-                                sendToUser(targetUserId, targetMsg.dump());
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                            } else if (!roomId.empty()) {
-                                broadcastToRoom(roomId, broadcastMsg.dump());
-                            } else {
-                                sendJsonMessage((void*)ws, broadcastMsg.dump());
-                            }
-                            Logger::info("🗳️ Vote cast by " + data->username + " in room " + roomId);
-                        }
-                    }
-                    else if (type == "poll_close") {
-                        if (data->authenticated) {
-                            std::string pollId = msg.value("pollId", "");
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db) {
-                                auto poll = db->getPoll(pollId);
-                                if (poll && poll->createdBy == data->userId) {
-                                    db->closePoll(pollId);
-                                    
-                                    json broadcastMsg = {
-                                        {"type", "poll_closed"},
-                                        {"pollId", pollId}
-                                    };
-                                    broadcast(broadcastMsg.dump());
-                                    Logger::info("📊 Poll closed: " + pollId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Only poll creator can close the poll");
-                                }
-                            }
-                        }
-                    }
-                    else if (type == "get_room_polls") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            bool activeOnly = msg.value("activeOnly", false);
-                            
-                            auto db = authManager_->getDatabase();
-                            if (db) {
-                                auto polls = db->getRoomPolls(roomId, activeOnly);
-                                json pollsJson = json::array();
-                                
-                                for (const auto& poll : polls) {
-                                    json optionsJson = json::array();
-                                    for (const auto& opt : poll.options) {
-                                        json votersJson = json::array();
-                                        for (size_t i = 0; i < opt.voterIds.size(); i++) {
-                                            votersJson.push_back(opt.voterNames[i]);
-                                        }
-                                        optionsJson.push_back({
-                                            {"id", opt.optionId},
-                                            {"text", opt.text},
-                                            {"votes", opt.voteCount},
-                                            {"voters", votersJson}
-                                        });
-                                    }
-                                    pollsJson.push_back({
-                                        {"id", poll.pollId},
-                                        {"question", poll.question},
-                                        {"options", optionsJson},
-                                        {"createdBy", poll.createdBy},
-                                        {"createdAt", poll.createdAt},
-                                        {"isClosed", poll.isClosed}
-                                    });
-                                }
-                                
-                                json response = {
-                                    {"type", "room_polls"},
-                                    {"roomId", roomId},
-                                    {"polls", pollsJson}
-                                };
-                                sendJsonMessage((void*)ws, response.dump());
-                            }
-                        }
-                    }
-                    // ============== Games ==============
-                    else if (type == "game_invite") {
-                        if (data->authenticated) {
-                            std::string gameType = msg.value("gameType", "tictactoe");
-                            std::string opponentId = msg.value("opponentId", "");
-                            std::string gameId = "game-" + std::to_string(std::time(nullptr));
-                            
-                            json inviteMsg = {
-                                {"type", "game_invite"},
-                                {"gameId", gameId},
-                                {"gameType", gameType},
-                                {"fromUser", data->username},
-                                {"fromUserId", data->userId}
-                            };
-                            
-                            // Send to opponent
-                            sendToUser(opponentId, inviteMsg.dump());
-                            Logger::info("🎮 Game invite from " + data->username + " to " + opponentId);
-                        }
-                    }
-                    else if (type == "game_accept") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            
-                            // Create initial game state
-                            json gameState = {
-                                {"id", gameId},
-                                {"type", "tictactoe"},
-                                {"board", json::array({nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr})},
-                                {"currentTurn", data->userId},
-                                {"players", {{"X", data->userId}, {"O", ""}}},
-                                {"winner", nullptr},
-                                {"status", "playing"}
+                                {"type", "message_forwarded"},
+                                {"messageId", newMsgId},
+                                {"originalMessageId", messageId},
+                                {"targetRoomId", targetRoomId},
+                                {"content", originalMsg->content},
+                                {"forwardedBy", data->username},
+                                {"originalSender", originalMsg->senderName},
+                                {"timestamp", now * 1000}
                             };
                             
-                            json gameStartMsg = {
-                                {"type", "game_start"},
-                                {"gameId", gameId},
-                                {"game", gameState}
-                            };
-                            broadcast(gameStartMsg.dump());
-                            Logger::info("🎮 Game started: " + gameId);
+                            broadcastToRoom(targetRoomId, response.dump());
+                            sendJsonMessage((void*)ws, json({{"type", "forward_success"}, {"messageId", newMsgId}}).dump());
+                            Logger::info("↗️ Message forwarded by " + data->username);
+                        } else {
+                            sendErrorJson((void*)ws, "Failed to forward message");
                         }
+                    } else {
+                        sendErrorJson((void*)ws, "Original message not found");
                     }
-                    else if (type == "game_reject") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            Logger::info("🎮 Game rejected: " + gameId);
-                        }
+                }
+                break;
+            }
+            // ============== Block/Unblock User ==============
+            case MessageKind::USER_BLOCK: {
+                std::string targetUserId = msg.value("targetUserId", "");
+                
+                if (targetUserId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId required");
+                } else if (targetUserId == data->userId) {
+                    sendErrorJson((void*)ws, "Cannot block yourself");
+                } else {
+                    if (dbClient_->blockUser(data->userId, targetUserId)) {
+                        json response = {
+                            {"type", "user_blocked"},
+                            {"targetUserId", targetUserId},
+                            {"success", true}
+                        };
+                        sendJsonMessage((void*)ws, response.dump());
+                        Logger::info("🚫 User " + data->username + " blocked " + targetUserId);
+                    } else {
+                        sendErrorJson((void*)ws, "Failed to block user");
                     }
-                    else if (type == "game_move") {
-                        if (data->authenticated) {
-                            std::string gameId = msg.value("gameId", "");
-                            int position = msg.value("position", -1);
-                            
-                            json moveMsg = {
-                                {"type", "game_state"},
-                                {"gameId", gameId},
-                                {"position", position},
-                                {"playerId", data->userId}
-                            };
-                            broadcast(moveMsg.dump());
-                            Logger::info("🎮 Game move in " + gameId);
-                        }
+                }
+                break;
+            }
+            case MessageKind::USER_UNBLOCK: {
+                std::string targetUserId = msg.value("targetUserId", "");
+                
+                if (targetUserId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId required");
+                } else {
+                    if (dbClient_->unblockUser(data->userId, targetUserId)) {
+                        json response = {
+                            {"type", "user_unblocked"},
+                            {"targetUserId", targetUserId},
+                            {"success", true}
+                        };
+                        sendJsonMessage((void*)ws, response.dump());
+                        Logger::info("✅ User " + data->username + " unblocked " + targetUserId);
+                    } else {
+                        sendErrorJson((void*)ws, "Failed to unblock user");
                     }
-                    // ============== Watch Together ==============
-                    else if (type == "watch_create") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            std::string videoUrl = msg.value("videoUrl", "");
+                }
+                break;
+            }
+            case MessageKind::GET_BLOCKED_USERS: {
+                auto blockedUsers = dbClient_->getBlockedUsers(data->userId);
+                json response = {
+                    {"type", "blocked_users_list"},
+                    {"blockedUsers", blockedUsers}
+                };
+                sendJsonMessage((void*)ws, response.dump());
+                break;
+            }
+            // ============== Kick User from Room ==============
+            case MessageKind::KICK_USER: {
+                std::string targetUserId = msg.value("targetUserId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                if (targetUserId.empty() || roomId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId and roomId required");
+                } else {
+                    // Check if user has permission (owner or admin)
+                    std::string role = dbClient_->getMemberRole(roomId, data->userId);
+                    if (role == "owner" || role == "admin") {
+                        // Remove user from room
+                        if (dbClient_->removeRoomMember(roomId, targetUserId)) {
+                            setRoomSubscription(targetUserId, roomId, false);
                             
-                            json watchMsg = {
-                                {"type", "watch_session_created"},
+                            // Notify kicked user
+                            json kickNotify = {
+                                {"type", "kicked_from_room"},
                                 {"roomId", roomId},
-                                {"videoUrl", videoUrl},
-                                {"createdBy", data->username},
-                                {"viewerCount", 1}
+                                {"kickedBy", data->username}
                             };
-                            broadcastToRoom(roomId, watchMsg.dump(), "");
-                            Logger::info("📺 Watch session created by " + data->username);
-                        }
-                    }
-                    else if (type == "watch_sync") {
-                        if (data->authenticated) {
-                            std::string action = msg.value("action", "");
-                            double time = msg.value("time", 0.0);
+                            sendToUser(targetUserId, kickNotify.dump());
                             
-                            json syncMsg = {
-                                {"type", "watch_sync"},
-                                {"action", action},
-                                {"time", time},
-                                {"syncedBy", data->username}
-                            };
-                            broadcast(syncMsg.dump());
-                        }
-                    }
-                    else if (type == "watch_end") {
-                        if (data->authenticated) {
-                            json endMsg = {
-                                {"type", "watch_ended"}
+                            // Notify room
+                            json roomNotify = {
+                                {"type", "user_kicked"},
+                                {"roomId", roomId},
+                                {"targetUserId", targetUserId},
+                                {"kickedBy", data->username}
                             };
-                            broadcast(endMsg.dump());
-                            Logger::info("📺 Watch session ended");
-                        }
-                    }
-                    // ============== Chunked File Upload ==============
-                    else if (type == "upload_init") {
-                        if (data->authenticated) {
-                            std::string roomId = msg.value("roomId", "global");
-                            Logger::info("📤 Upload init from " + data->username);
-                            
-                            // Call FileHandler to initialize upload
-                            fileHandler_->handleUploadInit((void*)ws, msg, data->userId, roomId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "upload_chunk") {
-                        if (data->authenticated) {
-                            std::string uploadId = msg.value("uploadId", "");
-                            int chunkIndex = msg.value("chunkIndex", 0);
-                            Logger::debug("📦 Upload chunk " + std::to_string(chunkIndex) + " from " + data->username);
+                            broadcastToRoom(roomId, roomNotify.dump());
                             
-                            // Call FileHandler to process chunk
-                            fileHandler_->handleUploadChunk((void*)ws, msg, data->userId);
+                            json response = {
+                                {"type", "kick_success"},
+                                {"targetUserId", targetUserId},
+                                {"roomId", roomId}
+                            };
+                            sendJsonMessage((void*)ws, response.dump());
+                            Logger::info("👢 User " + targetUserId + " kicked from " + roomId + " by " + data->username);
                         } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
+                            sendErrorJson((void*)ws, "Failed to kick user");
                         }
+                    } else {
+                        sendErrorJson((void*)ws, "No permission to kick users");
                     }
-                    else if (type == "upload_finalize") {
-                        if (data->authenticated) {
-                            std::string uploadId = msg.value("uploadId", "");
-                            Logger::info("✅ Upload finalize from " + data->username + " (" + uploadId + ")");
+                }
+                break;
+            }
+            // ============== Invite User to Room ==============
+            case MessageKind::INVITE_USER: {
+                std::string targetUserId = msg.value("targetUserId", "");
+                std::string roomId = msg.value("roomId", "");
+                
+                if (targetUserId.empty() || roomId.empty()) {
+                    sendErrorJson((void*)ws, "targetUserId and roomId required");
+                } else {
+                    // Check if inviter is member of room
+                    if (dbClient_->isRoomMember(roomId, data->userId)) {
+                        // Add user to room
+                        if (dbClient_->addRoomMember(roomId, targetUserId)) {
+                            setRoomSubscription(targetUserId, roomId, true);
                             
-                            // Call FileHandler to finalize upload
-                            fileHandler_->handleUploadFinalize((void*)ws, msg, data->userId);
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Forward Message ==============
-                    else if (type == "forward_message") {
-                        if (data->authenticated) {
-                            std::string messageId = msg.value("messageId", "");
-                            std::string targetRoomId = msg.value("targetRoomId", "");
+                            // Get room info
+                            auto room = dbClient_->getRoom(roomId);
+                            std::string roomName = room ? room->name : roomId;
                             
-                            if (messageId.empty() || targetRoomId.empty()) {
-                                sendErrorJson((void*)ws, "messageId and targetRoomId required");
-                            } else {
-                                // Get original message from database
-                                auto originalMsg = dbClient_->getMessage(messageId);
-                                if (originalMsg) {
-                                    // Create forwarded message
-                                    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                                    std::string newMsgId = "msg-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                                    
-                                    Message forwardedMsg;
-                                    forwardedMsg.messageId = newMsgId;
-                                    forwardedMsg.roomId = targetRoomId;
-                                    forwardedMsg.senderId = data->userId;
-                                    forwardedMsg.senderName = data->username;
-                                    forwardedMsg.content = originalMsg->content;
-                                    forwardedMsg.timestamp = now;
-                                    forwardedMsg.metadata = "{\"forwarded_from\": \"" + messageId + "\", \"original_sender\": \"" + originalMsg->senderName + "\"}";
-                                    
-                                    if (dbClient_->createMessage(forwardedMsg)) {
-                                        json response = {
-                                            {"type", "message_forwarded"},
-                                            {"messageId", newMsgId},
-                                            {"originalMessageId", messageId},
-                                            {"targetRoomId", targetRoomId},
-                                            {"content", originalMsg->content},
-                                            {"forwardedBy", data->username},
-                                            {"originalSender", originalMsg->senderName},
-                                            {"timestamp", now * 1000}
-                                        };
-                                        
-                                        broadcastToRoom(targetRoomId, response.dump());
-                                        sendJsonMessage((void*)ws, json({{"type", "forward_success"}, {"messageId", newMsgId}}).dump());
-                                        Logger::info("↗️ Message forwarded by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to forward message");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "Original message not found");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Block/Unblock User ==============
-                    else if (type == "user_block") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
+                            // Notify invited user
+                            json inviteNotify = {
+                                {"type", "room_invitation"},
+                                {"roomId", roomId},
+                                {"roomName", roomName},
+                                {"invitedBy", data->username}
+                            };
+                            sendToUser(targetUserId, inviteNotify.dump());
                             
-                            if (targetUserId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId required");
-                            } else if (targetUserId == data->userId) {
-                                sendErrorJson((void*)ws, "Cannot block yourself");
-                            } else {
-                                if (dbClient_->blockUser(data->userId, targetUserId)) {
-                                    json response = {
-                                        {"type", "user_blocked"},
-                                        {"targetUserId", targetUserId},
-                                        {"success", true}
-                                    };
-                                    sendJsonMessage((void*)ws, response.dump());
-                                    Logger::info("🚫 User " + data->username + " blocked " + targetUserId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to block user");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "user_unblock") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
+                            // Notify room
+                            json roomNotify = {
+                                {"type", "user_invited"},
+                                {"roomId", roomId},
+                                {"targetUserId", targetUserId},
+                                {"invitedBy", data->username}
+                            };
+                            broadcastToRoom(roomId, roomNotify.dump());
                             
-                            if (targetUserId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId required");
-                            } else {
-                                if (dbClient_->unblockUser(data->userId, targetUserId)) {
-                                    json response = {
-                                        {"type", "user_unblocked"},
-                                        {"targetUserId", targetUserId},
-                                        {"success", true}
-                                    };
-                                    sendJsonMessage((void*)ws, response.dump());
-                                    Logger::info("✅ User " + data->username + " unblocked " + targetUserId);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to unblock user");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    else if (type == "get_blocked_users") {
-                        if (data->authenticated) {
-                            auto blockedUsers = dbClient_->getBlockedUsers(data->userId);
                             json response = {
-                                {"type", "blocked_users_list"},
-                                {"blockedUsers", blockedUsers}
+                                {"type", "invite_success"},
+                                {"targetUserId", targetUserId},
+                                {"roomId", roomId}
                             };
                             sendJsonMessage((void*)ws, response.dump());
+                            Logger::info("📨 User " + targetUserId + " invited to " + roomId + " by " + data->username);
                         } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Kick User from Room ==============
-                    else if (type == "kick_user") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            if (targetUserId.empty() || roomId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId and roomId required");
-                            } else {
-                                // Check if user has permission (owner or admin)
-                                std::string role = dbClient_->getMemberRole(roomId, data->userId);
-                                if (role == "owner" || role == "admin") {
-                                    // Remove user from room
-                                    if (dbClient_->removeRoomMember(roomId, targetUserId)) {
-                                        // Notify kicked user
-                                        json kickNotify = {
-                                            {"type", "kicked_from_room"},
-                                            {"roomId", roomId},
-                                            {"kickedBy", data->username}
-                                        };
-                                        sendToUser(targetUserId, kickNotify.dump());
-                                        
-                                        // Notify room
-                                        json roomNotify = {
-                                            {"type", "user_kicked"},
-                                            {"roomId", roomId},
-                                            {"targetUserId", targetUserId},
-                                            {"kickedBy", data->username}
-                                        };
-                                        broadcastToRoom(roomId, roomNotify.dump());
-                                        
-                                        json response = {
-                                            {"type", "kick_success"},
-                                            {"targetUserId", targetUserId},
-                                            {"roomId", roomId}
-                                        };
-                                        sendJsonMessage((void*)ws, response.dump());
-                                        Logger::info("👢 User " + targetUserId + " kicked from " + roomId + " by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to kick user");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "No permission to kick users");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Invite User to Room ==============
-                    else if (type == "invite_user") {
-                        if (data->authenticated) {
-                            std::string targetUserId = msg.value("targetUserId", "");
-                            std::string roomId = msg.value("roomId", "");
-                            
-                            if (targetUserId.empty() || roomId.empty()) {
-                                sendErrorJson((void*)ws, "targetUserId and roomId required");
-                            } else {
-                                // Check if inviter is member of room
-                                auto members = dbClient_->getRoomMembers(roomId);
-                                bool isMember = std::find(members.begin(), members.end(), data->userId) != members.end();
-                                
-                                if (isMember) {
-                                    // Add user to room
-                                    if (dbClient_->addRoomMember(roomId, targetUserId)) {
-                                        // Get room info
-                                        auto room = dbClient_->getRoom(roomId);
-                                        std::string roomName = room ? room->name : roomId;
-                                        
-                                        // Notify invited user
-                                        json inviteNotify = {
-                                            {"type", "room_invitation"},
-                                            {"roomId", roomId},
-                                            {"roomName", roomName},
-                                            {"invitedBy", data->username}
-                                        };
-                                        sendToUser(targetUserId, inviteNotify.dump());
-                                        
-                                        // Notify room
-                                        json roomNotify = {
-                                            {"type", "user_invited"},
-                                            {"roomId", roomId},
-                                            {"targetUserId", targetUserId},
-                                            {"invitedBy", data->username}
-                                        };
-                                        broadcastToRoom(roomId, roomNotify.dump());
-                                        
-                                        json response = {
-                                            {"type", "invite_success"},
-                                            {"targetUserId", targetUserId},
-                                            {"roomId", roomId}
-                                        };
-                                        sendJsonMessage((void*)ws, response.dump());
-                                        Logger::info("📨 User " + targetUserId + " invited to " + roomId + " by " + data->username);
-                                    } else {
-                                        sendErrorJson((void*)ws, "Failed to invite user (maybe already member)");
-                                    }
-                                } else {
-                                    sendErrorJson((void*)ws, "You must be a room member to invite others");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
-                        }
-                    }
-                    // ============== Location Message ==============
-                    else if (type == "chat_location") {
-                        if (data->authenticated) {
-                            double latitude = msg.value("latitude", 0.0);
-                            double longitude = msg.value("longitude", 0.0);
-                            std::string roomId = msg.value("roomId", "global");
-                            
-                            if (latitude == 0.0 && longitude == 0.0) {
-                                sendErrorJson((void*)ws, "latitude and longitude required");
-                            } else {
-                                uint64_t now = static_cast<uint64_t>(std::time(nullptr));
-                                std::string messageId = "loc-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
-                                
-                                std::string locationStr = std::to_string(latitude) + "," + std::to_string(longitude);
-                                
-                                Message locMsg;
-                                locMsg.messageId = messageId;
-                                locMsg.roomId = roomId;
-                                locMsg.senderId = data->userId;
-                                locMsg.senderName = data->username;
-                                locMsg.content = "[location:" + locationStr + "]";
-                                locMsg.timestamp = now;
-                                locMsg.metadata = "{\"type\": \"location\", \"latitude\": " + std::to_string(latitude) + ", \"longitude\": " + std::to_string(longitude) + "}";
-                                
-                                if (dbClient_->createMessage(locMsg)) {
-                                    json response = {
-                                        {"type", "chat"},
-                                        {"messageType", "location"},
-                                        {"messageId", messageId},
-                                        {"roomId", roomId},
-                                        {"userId", data->userId},
-                                        {"username", data->username},
-                                        {"latitude", latitude},
-                                        {"longitude", longitude},
-                                        {"timestamp", now * 1000}
-                                    };
-                                    std::string responseStr = response.dump();
-                                    sendJsonMessage((void*)ws, responseStr);  // Echo to sender
-                                    broadcastToRoom(roomId, responseStr, data->userId);  // Broadcast to others
-                                    Logger::info("📍 Location sent by " + data->username);
-                                } else {
-                                    sendErrorJson((void*)ws, "Failed to send location");
-                                }
-                            }
-                        } else {
-                            sendErrorJson((void*)ws, "Not authenticated");
+                            sendErrorJson((void*)ws, "Failed to invite user (maybe already member)");
                         }
+                    } else {
+                        sendErrorJson((void*)ws, "You must be a room member to invite others");
                     }
-                    else {
-                        Logger::warning("Unknown message type: " + type);
-                        sendErrorJson((void*)ws, "Unknown message type");
-                    }
-                    
-                } catch (const json::exception& e) {
-                    Logger::error("JSON parse error: " + std::string(e.what()));
-                    sendErrorJson((void*)ws, "Invalid JSON");
-                } catch (const std::exception& e) {
-                    Logger::error("Message handling error: " + std::string(e.what()));
-                    sendErrorJson((void*)ws, "Internal error");
                 }
-            },
-            
-            .drain = [](auto* ws) {},
-            .ping = [](auto* ws, std::string_view) {},
-            .pong = [](auto* ws, std::string_view) {},
-            
-            // Connection closed
-            .close = [this](auto* ws, int code, std::string_view message) {
-                PerSocketData* data = ws->getUserData();
+                break;
+            }
+            // ============== Location Message ==============
+            case MessageKind::CHAT_LOCATION: {
+                double latitude = msg.value("latitude", 0.0);
+                double longitude = msg.value("longitude", 0.0);
+                std::string roomId = msg.value("roomId", "global");
                 
-                if (data->authenticated) {
-                    Logger::info("Client disconnected: " + data->username);
+                if (latitude == 0.0 && longitude == 0.0) {
+                    sendErrorJson((void*)ws, "latitude and longitude required");
+                } else {
+                    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+                    std::string messageId = "loc-" + std::to_string(now) + "-" + data->userId.substr(0, 8);
                     
-                    // Update user status to offline in database
-                    try {
-                        dbClient_->updateUserStatus(data->userId, 0);  // 0 = offline
-                        Logger::debug("Updated " + data->username + " status to offline");
-                    } catch (const std::exception& e) {
-                        Logger::warning("Failed to update offline status: " + std::string(e.what()));
-                    }
+                    std::string locationStr = std::to_string(latitude) + "," + std::to_string(longitude);
                     
-                    // Broadcast offline presence to other users
-                    json offlineMsg = {
-                        {"type", "presence_update"},
-                        {"userId", data->userId},
-                        {"username", data->username},
-                        {"status", "offline"}
-                    };
+                    Message locMsg;
+                    locMsg.messageId = messageId;
+                    locMsg.roomId = roomId;
+                    locMsg.senderId = data->userId;
+                    locMsg.senderName = data->username;
+                    locMsg.content = "[location:" + locationStr + "]";
+                    locMsg.timestamp = now;
+                    locMsg.metadata = "{\"type\": \"location\", \"latitude\": " + std::to_string(latitude) + ", \"longitude\": " + std::to_string(longitude) + "}";
                     
-                    // Broadcast to all other connections
-                    {
-                        std::lock_guard<std::mutex> lock(connectionsMutex_);
-                        for (const auto& [key, state] : connections_) {
-                            if (state.authenticated && state.wsPtr && state.userId != data->userId) {
-                                auto* otherWs = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-                                otherWs->send(offlineMsg.dump(), uWS::OpCode::TEXT);
-                            }
-                        }
+                    if (dbClient_->createMessage(locMsg)) {
+                        json response = {
+                            {"type", "chat"},
+                            {"messageType", "location"},
+                            {"messageId", messageId},
+                            {"roomId", roomId},
+                            {"userId", data->userId},
+                            {"username", data->username},
+                            {"latitude", latitude},
+                            {"longitude", longitude},
+                            {"timestamp", now * 1000}
+                        };
+                        std::string responseStr = response.dump();
+                        sendJsonMessage((void*)ws, responseStr);  // Echo to sender
+                        broadcastToRoom(roomId, responseStr, data->userId);  // Broadcast to others
+                        Logger::info("📍 Location sent by " + data->username);
+                    } else {
+                        sendErrorJson((void*)ws, "Failed to send location");
                     }
-                } else {
-                    Logger::info("Client disconnected (not authenticated)");
                 }
-                
-                // Remove connection
-                {
-                    std::lock_guard<std::mutex> lock(connectionsMutex_);
-                    connections_.erase((void*)ws);
+                break;
+            }
+            // Answered by handleInbound, never parsed into a document
+            case MessageKind::TYPING:
+            case MessageKind::ADD_REACTION:
+            case MessageKind::PING:
+            case MessageKind::WEBRTC_ICE:
+            case MessageKind::PRESENCE_UPDATE:
+            case MessageKind::WATCH_SYNC:
+            case MessageKind::UNKNOWN:
+                break;
+        }
+    } catch (const json::exception& e) {
+        Logger::error("JSON field error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Invalid JSON");
+    } catch (const std::exception& e) {
+        Logger::error("Message handling error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Internal error");
+    }
+}
+
+void WebSocketServer::handleBinaryFrame(void* wsPtr, std::string_view frame) {
+    setLoopActivity("ws binary frame (parse)");
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    if (!data->binaryProtocol) {
+        sendErrorJson(wsPtr, "Binary protocol not negotiated");
+        return;
+    }
+    
+    BinaryMessage packet;
+    bool valid = false;
+    if (data->packetVersion == PROTOCOL_VERSION_V2) {
+        PacketHeaderV2 header;
+        std::string_view payload;
+        if (ProtocolChatBox1::parsePacketV2(frame, header, payload)) {
+            if (header.msgType == MSG_INTERN) {
+                // Charged like any frame: each request inserts (maybe evicts) and replies
+                if (admit(wsPtr, message_types::kUnknown)) {
+                    handleInternRequest(wsPtr, payload);
                 }
+                return;
             }
-        });
-        
-        // HTTP health check
-        app.get("/health", [](auto* res, auto* req) {
-            res->writeStatus("200 OK")
-               ->writeHeader("Content-Type", "application/json")
-               ->end("{\"status\":\"ok\",\"service\":\"chatbox-websocket\"}");
-        });
-        
-        // Listen
-        app.listen(port_, [this](auto* listenSocket) {
-            if (listenSocket) {
-                Logger::info("========================================");
-                Logger::info("✅ WebSocket server LIVE!");
-                Logger::info("========================================"); 
-                Logger::info("Listening on: 0.0.0.0:" + std::to_string(port_));
-                Logger::info("WebSocket: ws://localhost:" + std::to_string(port_) + "/");
-                Logger::info("Health: http://localhost:" + std::to_string(port_) + "/health");
-                Logger::info("");
-                Logger::info("Protocol: ChatBox v1");
-                Logger::info("  - register: Create new account");
-                Logger::info("  - login: Authenticate user");
-                Logger::info("  - chat: Send message");
-                Logger::info("  - ping: Keep-alive");
-                Logger::info("========================================");
-                Logger::info("");
-                Logger::info("Ready for protocol messages! 🚀");
-                Logger::info("");
-            } else {
-                Logger::error("❌ Failed to listen on port " + std::to_string(port_));
-                running_ = false;
+            const std::string* topic = nullptr;
+            if (header.topicId != 0 && !(topic = data->topics.lookup(header.topicId))) {
+                // Evicted or never assigned: the client re-interns and retries
+                if (admit(wsPtr, message_types::kUnknown)) {
+                    sendErrorJson(wsPtr, "Unknown topic id " + std::to_string(header.topicId));
+                }
+                return;
+            }
+            valid = decodeV2(header, topic ? *topic : std::string(), payload, packet);
+        }
+    } else {
+        PacketHeader header;
+        std::string_view payload;
+        if (ProtocolChatBox1::parsePacket(frame, header, payload)) {
+            valid = decodeV1(header, payload, packet);
+            if (valid && header.version == PROTOCOL_VERSION_V2) {
+                data->packetVersion = PROTOCOL_VERSION_V2;  // Our replies switch from here on
+                Logger::debug("ChatBox1 v2 packets enabled for " + data->username);
             }
+        }
+    }
+    if (!valid) {
+        // Garbage still costs tokens (and strikes once throttled)
+        if (admit(wsPtr, message_types::kUnknown)) {
+            Logger::warning("Invalid ChatBox1 packet (" + std::to_string(frame.size()) + " bytes)");
+            sendErrorJson(wsPtr, "Invalid packet");
+        }
+        return;
+    }
+    
+    const MessageTypeEntry& entry = binaryMessageType(packet.msgType);
+    PerformanceMonitor::Timer timer(handlerHistograms().loop[messageTypeIndex(entry)]);
+    setLoopActivity(activityOf(entry));
+    if (!admit(wsPtr, entry)) {
+        return;
+    }
+    if (entry.kind == MessageKind::UNKNOWN) {
+        Logger::warning("Unsupported ChatBox1 packet type: " + std::to_string(packet.msgType));
+        sendErrorJson(wsPtr, "Unknown message type");
+        return;
+    }
+    
+    // Same exec policy as the JSON type (DB types carry no frame views)
+    if (entry.exec == ExecPolicy::DATABASE) {
+        runOnDbExecutor(wsPtr, entry, [this, wsPtr, &entry, packet = std::move(packet)]() {
+            handleBinaryMessage(wsPtr, entry, packet);
         });
+        return;
+    }
+    handleBinaryMessage(wsPtr, entry, packet);
+}
+
+void WebSocketServer::handleBinaryMessage(void* wsPtr, const MessageTypeEntry& entry, const BinaryMessage& packet) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    SocketSession* data = sessionOf(ws);
+    
+    try {
+        if (!authorize(wsPtr, entry, *data)) {
+            return;
+        }
         
-        app.run();
+        std::string roomId = packet.roomId.empty() ? "global" : packet.roomId;
         
+        switch (packet.msgType) {
+            case MSG_CHAT_TEXT: {
+                handleChatMessage(wsPtr, roomId, packet.text, nullptr);
+                break;
+            }
+            case MSG_TYPING_START:
+            case MSG_TYPING_STOP: {
+                handleTyping(wsPtr, packet.msgType == MSG_TYPING_START);
+                break;
+            }
+            case MSG_ADD_REACTION: {
+                handleReaction(wsPtr, packet.messageId, packet.emoji, packet.roomId);
+                break;
+            }
+            case MSG_MESSAGE_READ: {
+                handleMarkRead(wsPtr, packet.messageId, roomId);
+                break;
+            }
+            case MSG_HEARTBEAT:
+            case MSG_PING: {
+                // Answered in kind: an empty MSG_PONG in the connection's header version
+                if (ws->getUserData()->packetVersion == PROTOCOL_VERSION_V2) {
+                    PacketHeaderV2 pong;
+                    pong.msgType = MSG_PONG;
+                    sendQueued(wsPtr, PreparedMessage::create(ProtocolChatBox1::serializePacketV2(pong, {}),
+                                                              uWS::OpCode::BINARY), false);
+                } else {
+                    PacketHeader pong = ProtocolChatBox1::createHeader(MSG_PONG, "", "", 0);
+                    auto bytes = ProtocolChatBox1::serializePacket(pong, nullptr, 0);
+                    sendQueued(wsPtr, PreparedMessage::create(std::string(bytes.begin(), bytes.end()),
+                                                              uWS::OpCode::BINARY), false);
+                }
+                break;
+            }
+            case MSG_FILE_CHUNK: {
+                // Raw bytes: no base64 round trip
+                fileHandler_->handleUploadChunkData(wsPtr, packet.transferId, packet.chunkIndex,
+                                                    reinterpret_cast<const uint8_t*>(packet.chunk.data()),
+                                                    packet.chunk.size(), data->userId);
+                break;
+            }
+            default:
+                break;
+        }
     } catch (const std::exception& e) {
-        Logger::error("WebSocket server error: " + std::string(e.what()));
-        running_ = false;
+        Logger::error("Binary message handling error: " + std::string(e.what()));
+        sendErrorJson(wsPtr, "Internal error");
     }
+}
+
+void WebSocketServer::handleInternRequest(void* wsPtr, std::string_view payload) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
     
-    Logger::info("WebSocket server stopped");
+    uint64_t requestedId;
+    std::string_view name = payload;
+    if (!ProtocolChatBox1::readVarint(name, requestedId) || requestedId != 0 ||
+        name.empty() || name.size() > MAX_TOPIC_LEN) {
+        sendErrorJson(wsPtr, "Invalid packet");
+        return;
+    }
+    
+    auto interned = data->topics.intern(name);
+    
+    auto announce = [this, wsPtr](uint32_t id, std::string_view topic) {
+        std::string body;
+        ProtocolChatBox1::appendVarint(body, id);
+        body.append(topic);
+        PacketHeaderV2 header;
+        header.msgType = MSG_INTERN;
+        sendQueued(wsPtr, PreparedMessage::create(ProtocolChatBox1::serializePacketV2(header, body),
+                                                  uWS::OpCode::BINARY), false);
+    };
+    if (interned.evicted) {
+        announce(*interned.evicted, {});
+    }
+    announce(interned.id, name);
 }
 
 void WebSocketServer::stop() {
@@ -1538,9 +2442,20 @@ void WebSocketServer::stop() {
 // Protocol message handlers
 
 void WebSocketServer::sendJsonMessage(void* wsPtr, const std::string& jsonStr) {
+    sendJsonMessage(wsPtr, PreparedMessage::create(jsonStr));
+}
+
+void WebSocketServer::sendJsonMessage(void* wsPtr, const PreparedMessage::Ptr& message) {
     // Cast back to proper WebSocket type - we know it's non-SSL from our App setup
-    auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-    ws->send(jsonStr, uWS::OpCode::TEXT);
+    if (!currentLoop) {
+        // DB executor thread: the socket is only touched on its own loop
+        runOnSocketLoop(wsPtr, [this, message](void* ws) { sendJsonMessage(ws, message); });
+        return;
+    }
+    
+    // Corked with the socket's other output, or queued while it is congested
+    bool compress = compression_.shouldCompress(message->payload());
+    sendQueued(wsPtr, message, compress);
 }
 
 void WebSocketServer::sendErrorJson(void* wsPtr, const std::string& error) {
@@ -1551,10 +2466,8 @@ void WebSocketServer::sendErrorJson(void* wsPtr, const std::string& error) {
     sendJsonMessage(wsPtr, response.dump());
 }
 
-void WebSocketServer::handleRegisterJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleRegisterJson(void* wsPtr, const json& msg) {
     try {
-        json msg = json::parse(jsonStr);
-        
         std::string username = msg.value("username", "");
         std::string password = msg.value("password", "");
         std::string email = msg.value("email", "");
@@ -1586,12 +2499,10 @@ void WebSocketServer::handleRegisterJson(void* wsPtr, const std::string& jsonStr
     }
 }
 
-void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleLoginJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
+        SocketSession* data = sessionOf(ws);
         
         std::string username = msg.value("username", "");
         std::string password = msg.value("password", "");
@@ -1608,18 +2519,14 @@ void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
             data->authenticated = true;
             data->userId = result.userId;
             data->username = username;
-            data->sessionId = "ws-session-" + result.userId;
+            data->sessionId = "ws-session-" + result.userId + "-" + std::to_string(data->connectionId);
             
-            // Update connection state in connections_ map for broadcast
-            {
-                std::lock_guard<std::mutex> lock(connectionsMutex_);
-                if (connections_.find(wsPtr) != connections_.end()) {
-                    connections_[wsPtr].authenticated = true;
-                    connections_[wsPtr].userId = result.userId;
-                    connections_[wsPtr].username = username;
-                    Logger::info("📝 Updated connection state for: " + username);
-                }
+            // Index connection by user and session for sendToUser/broadcast
+            bool indexed = connections_.authenticate(wsPtr, result.userId, username, data->sessionId);
+            if (indexed) {
+                Logger::info("📝 Updated connection state for: " + username);
             }
+            subscribeSocket(wsPtr, result.userId);
             
             // Get user's display name and avatar from database
             std::string displayName = username;
@@ -1693,14 +2600,10 @@ void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
                 Logger::error("Failed to load history: " + std::string(e.what()));
             }
             
-            // Broadcast user joined to all other users
-            json userJoinedMsg = {
-                {"type", "user_joined"},
-                {"userId", result.userId},
-                {"username", username}
-            };
-            broadcastToRoom("global", userJoinedMsg.dump(), result.userId);
-            Logger::info("📢 Broadcast user_joined: " + username);
+            // Announced to other users with the next presence_batch
+            if (indexed) {
+                presence_.online(result.userId, username);
+            }
             
         } else {
             json response = {
@@ -1719,57 +2622,80 @@ void WebSocketServer::handleLoginJson(void* wsPtr, const std::string& jsonStr) {
     }
 }
 
-void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleChatMessageJson(void* wsPtr, const json& msg) {
+    // Check if message has metadata (file attachment)
+    json metadata = nullptr;
+    if (msg.contains("metadata") && msg["metadata"].is_object()) {
+        metadata = msg["metadata"];
+    }
+    handleChatMessage(wsPtr, msg.value("roomId", "global"), msg.value("content", ""), metadata);
+}
+
+void WebSocketServer::handleChatMessage(void* wsPtr, const std::string& roomId, const std::string& content,
+                                        const json& metadata, MessageTrace::Ptr trace, bool aiCommands) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
-        
-        std::string content = msg.value("content", "");
-        std::string roomId = msg.value("roomId", "global");
+        SocketSession* data = sessionOf(ws);
         
         if (content.empty()) {
             return;
         }
         
-        Logger::info("💬 Chat from " + data->username + " in room '" + roomId + "': " + content);
+        LOG_INFO_F("💬 Chat from {} in room '{}': {}", data->username, roomId, content);
         
         // ============================================================================
         // CHECK FOR @AI COMMAND
         // ============================================================================
-        if (content.length() > 3 && content.substr(0, 3) == "@ai" && geminiClient_) {
+        if (aiCommands && content.length() > 3 && content.substr(0, 3) == "@ai" && aiScheduler_) {
             std::string question = content.substr(3);
             // Trim leading spaces
             size_t start = question.find_first_not_of(" \t");
-            if (start != std::string::npos) {
-                question = question.substr(start);
-            }
-            
-            Logger::info("🤖 AI command detected: " + question);
-            
-            // Get AI response
-            auto aiResponse = geminiClient_->sendMessage(question);
-            
-            if (aiResponse.has_value()) {
-                Logger::info("✓ AI response received (" + std::to_string(aiResponse.value().length()) + " chars)");
-                
-                // Generate AI message ID
-                std::string aiMessageId = "msg-ai-" + std::to_string(std::time(nullptr));
-                
-                // Create AI response message
-                json aiMsg = {
-                    {"type", "chat"},
-                    {"messageId", aiMessageId},
-                    {"roomId", roomId},
-                    {"userId", "ai-assistant"},
-                    {"username", "AI Assistant"},
-                    {"content", aiResponse.value()},
-                    {"timestamp", std::time(nullptr)}
-                };
-                
-                // Save AI response to database
-                try {
+            if (start != std::string::npos) {
+                question = question.substr(start);
+            }
+            
+            Logger::info("🤖 AI command detected: " + question);
+            
+            // The answer is posted to the room when the AI worker gets it;
+            // this task (and the sender's next messages) do not wait for it
+            auto admission = aiScheduler_->submit(data->userId, question,
+                [this, roomId, content, metadata, socket = socketRef(wsPtr)](std::optional<std::string> aiResponse) {
+                    if (!aiResponse.has_value()) {
+                        Logger::error("✗ Failed to get AI response");
+                        json errorJson = {
+                            {"type", "ai_error"},
+                            {"message", "No response from AI"}
+                        };
+                        // The question is still a chat message: store and
+                        // broadcast it like a refused submit, without asking again
+                        postToSocket(socket, [this, payload = errorJson.dump(), roomId, content, metadata](void* socketWs) {
+                            sendJsonMessage(socketWs, payload);
+                            const MessageTypeEntry& entry = lookupMessageType("chat");
+                            runOnDbExecutor(socketWs, entry, [this, socketWs, &entry, roomId, content, metadata]() {
+                                if (authorize(socketWs, entry, *sessionOf(static_cast<WebSocket*>(socketWs)))) {
+                                    handleChatMessage(socketWs, roomId, content, metadata, nullptr, false);
+                                }
+                            });
+                        });
+                        return;
+                    }
+                    Logger::info("✓ AI response received (" + std::to_string(aiResponse.value().length()) + " chars)");
+                    
+                    // Generate AI message ID
+                    std::string aiMessageId = "msg-ai-" + std::to_string(std::time(nullptr));
+                    
+                    // Create AI response message
+                    json aiMsg = {
+                        {"type", "chat"},
+                        {"messageId", aiMessageId},
+                        {"roomId", roomId},
+                        {"userId", "ai-assistant"},
+                        {"username", "AI Assistant"},
+                        {"content", aiResponse.value()},
+                        {"timestamp", std::time(nullptr)}
+                    };
+                    
+                    // Save AI response to database (DB executor, not this AI worker)
                     Message aiDbMessage;
                     aiDbMessage.messageId = aiMessageId;
                     aiDbMessage.roomId = roomId;
@@ -1780,23 +2706,37 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
                     aiDbMessage.replyToId = "";
                     aiDbMessage.timestamp = std::time(nullptr);
                     
-                    authManager_->getDatabase()->createMessage(aiDbMessage);
-                    Logger::info("💾 AI message saved to database");
-                } catch (const std::exception& e) {
-                    Logger::error("Failed to save AI message: " + std::string(e.what()));
-                }
-                
-                // Broadcast AI response to all users in room (including sender)
-                std::string aiResponseStr = aiMsg.dump();
-                sendJsonMessage(wsPtr, aiResponseStr);
-                broadcastToRoom(roomId, aiResponseStr);
-                
-                Logger::info("✅ AI response broadcasted to room");
+                    bool queued = dbExecutor_->submit(0, [this, aiDbMessage]() {
+                        try {
+                            authManager_->getDatabase()->createMessage(aiDbMessage);
+                            Logger::info("💾 AI message saved to database");
+                        } catch (const std::exception& e) {
+                            Logger::error("Failed to save AI message: " + std::string(e.what()));
+                        }
+                    });
+                    if (!queued) {
+                        Logger::error("Failed to save AI message: DB executor queue full");
+                    }
+                    
+                    // Broadcast AI response to all users in room (including sender)
+                    std::string aiResponseStr = aiMsg.dump();
+                    postToSocket(socket, [this, aiResponseStr](void* socketWs) {
+                        sendJsonMessage(socketWs, aiResponseStr);
+                    });
+                    broadcastToRoom(roomId, aiResponseStr);
+                    
+                    Logger::info("✅ AI response broadcasted to room");
+                });
+            
+            if (admission == AiScheduler::Admission::ACCEPTED) {
                 return; // Don't process as regular message
-            } else {
-                Logger::error("✗ Failed to get AI response");
-                // Continue to process as regular message
             }
+            json errorJson = {
+                {"type", "ai_error"},
+                {"message", AiScheduler::describe(admission)}
+            };
+            sendJsonMessage(wsPtr, errorJson.dump());
+            // Continue to process as regular message
         }
         // ============================================================================
         
@@ -1804,34 +2744,31 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
         std::string messageId = "msg-" + std::to_string(std::time(nullptr)) + "-" + 
                                 data->userId.substr(0, 8);
         
-        // Check if message has metadata (file attachment)
-        json metadata = nullptr;
-        if (msg.contains("metadata") && msg["metadata"].is_object()) {
-            metadata = msg["metadata"];
-        }
-        
         // Create message response
-        json response = {
-            {"type", "chat"},
-            {"messageId", messageId},
-            {"roomId", roomId},
-            {"userId", data->userId},
-            {"username", data->username},
-            {"content", content},
-            {"timestamp", std::time(nullptr) * 1000}  // Convert to milliseconds for JS
-        };
+        ChatMessage response;
+        response.messageId = messageId;
+        response.roomId = roomId;
+        response.userId = data->userId;
+        response.username = data->username;
+        response.content = content;
+        response.timestamp = std::time(nullptr) * 1000;  // Convert to milliseconds for JS
         
         // Add metadata if present (for file attachments)
         if (!metadata.is_null()) {
-            response["metadata"] = metadata;
-            Logger::info("📎 Message has file attachment: " + metadata.value("fileName", "unknown"));
+            response.metadata = &metadata;
+            LOG_INFO_F("📎 Message has file attachment: {}", metadata.value("fileName", "unknown"));
         }
         
-        std::string responseStr = response.dump();
+        // One frame for the echo and the room; a traced message completes
+        // once every copy of it is written
+        PreparedMessage::Ptr prepared = MessageTrace::track(trace, PreparedMessage::create(json_writer::toString(response)));
+        if (trace) {
+            trace->describe(messageId, roomId);
+        }
         
         // Save to database
         try {
-            Logger::info("🔍 Preparing to save message to database...");
+            LOG_INFO_F("🔍 Preparing to save message to database...");
             
             // For DM, use conversation_id from database (Discord/Telegram style)
             std::string storageRoomId = roomId;
@@ -1839,7 +2776,10 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
                 std::string targetUserId = roomId.substr(3);
                 // Get or create DM conversation (like Discord channel)
                 storageRoomId = dbClient_->getOrCreateDmConversation(data->userId, targetUserId);
-                Logger::info("📦 DM conversation roomId for storage: " + storageRoomId);
+                LOG_INFO_F("📦 DM conversation roomId for storage: {}", storageRoomId);
+            }
+            if (trace) {
+                trace->mark(MessageTrace::Stage::RESOLVED);
             }
             
             Message dbMessage;
@@ -1856,16 +2796,19 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
                 dbMessage.metadata = metadata.dump();
             }
             
-            Logger::info("🔍 Calling authManager_->getDatabase()->createMessage()...");
+            LOG_INFO_F("🔍 Calling authManager_->getDatabase()->createMessage()...");
             
             // Note: Will use DB default for created_at
             bool saved = authManager_->getDatabase()->createMessage(dbMessage);
             
             if (saved) {
-                Logger::info("💾 Message saved to database");
+                LOG_INFO_F("💾 Message saved to database");
             } else {
                 Logger::error("✗ createMessage returned false!");
             }
+            if (trace) {
+                trace->mark(MessageTrace::Stage::PERSISTED);
+            }
             
         } catch (const std::exception& e) {
             Logger::error("Failed to save message to DB: " + std::string(e.what()));
@@ -1876,48 +2819,30 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
         if (roomId.rfind("dm_", 0) == 0) {
             // Extract target user ID from room ID
             std::string targetUserId = roomId.substr(3); // Remove "dm_" prefix
-            Logger::info("📨 DM detected from " + data->userId + " to user: " + targetUserId);
+            LOG_INFO_F("📨 DM detected from {} to user: {}", data->userId, targetUserId);
             
-            // Create response for sender with their perspective roomId
-            json senderResponse = {
-                {"type", "chat"},
-                {"messageId", response["messageId"]},
-                {"roomId", roomId},  // Sender sees dm_targetUserId
-                {"userId", data->userId},
-                {"username", data->username},
-                {"content", content},
-                {"timestamp", response["timestamp"]}
-            };
-            if (!metadata.is_null()) {
-                senderResponse["metadata"] = metadata;
-            }
-            sendJsonMessage(wsPtr, senderResponse.dump());
+            // Sender sees dm_targetUserId, i.e. roomId: the response as is
+            sendJsonMessage(wsPtr, prepared);
             
             // Create response for receiver with their perspective roomId
-            json receiverResponse = {
-                {"type", "chat"},
-                {"messageId", response["messageId"]},
-                {"roomId", "dm_" + data->userId},  // Receiver sees dm_senderId
-                {"userId", data->userId},
-                {"username", data->username},
-                {"content", content},
-                {"timestamp", response["timestamp"]}
-            };
-            if (!metadata.is_null()) {
-                receiverResponse["metadata"] = metadata;
-            }
+            std::string receiverRoomId = "dm_" + data->userId;  // Receiver sees dm_senderId
+            ChatMessage receiverResponse = response;
+            receiverResponse.roomId = receiverRoomId;
             
             // Send to target user with their perspective roomId
-            sendToUser(targetUserId, receiverResponse.dump());
+            sendToUser(targetUserId, MessageTrace::track(trace, PreparedMessage::create(json_writer::toString(receiverResponse))));
         } else {
             // Echo back to sender for non-DM messages
-            sendJsonMessage(wsPtr, responseStr);
+            sendJsonMessage(wsPtr, prepared);
             // Broadcast to all other users in room
-            broadcastToRoom(roomId, responseStr, data->userId);
+            broadcastToRoom(roomId, prepared, data->userId);
+        }
+        if (trace) {
+            trace->mark(MessageTrace::Stage::FANOUT);
         }
         
         // Publish to PubSub (for future multi-server support)
-        broker_->publish("chat." + roomId, responseStr);
+        broker_->publish("chat." + roomId, std::string(prepared->payload()));
         
     } catch (const std::exception& e) {
         Logger::error("Chat message error: " + std::string(e.what()));
@@ -1926,179 +2851,525 @@ void WebSocketServer::handleChatMessageJson(void* wsPtr, const std::string& json
 
 // Public methods
 size_t WebSocketServer::getConnectionCount() const {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
     return connections_.size();
 }
 
-void WebSocketServer::broadcast(const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
+void WebSocketServer::deliver(const ConnectionState& state,
+                              const PreparedMessage::Ptr& message,
+                              bool ordered) {
+    if (!state.wsPtr) {
+        return;
+    }
     
-    int sent = 0;
-    for (const auto& [key, state] : connections_) {
-        if (state.authenticated && state.wsPtr) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            sent++;
-        }
+    bool compress = compression_.shouldCompress(message->payload());
+    
+    // Our own socket: write directly unless an ordered fan-out must queue
+    // behind messages other loops already posted to this loop
+    if (state.loop == currentLoop && (!ordered || eventLoopCount_ == 1)) {
+        sendQueued(state.wsPtr, message, compress);
+        return;
+    }
+    if (!state.loop) {
+        return;
     }
     
-    Logger::info("📢 Broadcast to " + std::to_string(sent) + " authenticated clients");
+    state.loop->defer([this, wsPtr = state.wsPtr, connectionId = state.connectionId, message, compress]() {
+        setLoopActivity("deferred send");
+        if (!connections_.isAlive(wsPtr, connectionId)) {
+            return;  // Socket closed before the deferred send ran
+        }
+        // Only this loop thread can close the socket, so it is still open here
+        sendQueued(wsPtr, message, compress);
+    });
 }
 
-void WebSocketServer::broadcastToRoom(const std::string& roomId, const std::string& message, const std::string& excludeUserId) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
+void WebSocketServer::publish(const std::string& topic, const PreparedMessage::Ptr& message, const std::string& excludeUserId) {
+    // Posting to every loop under one lock keeps the publish order identical
+    // on all loops (same rule as deliver() with `ordered`)
+    // Decided once; uWS compresses per subscriber that negotiated deflate
+    bool compress = compression_.shouldCompress(message->payload());
     
-    // Special handling for "global" room - broadcast to ALL authenticated users
-    if (roomId == "global") {
-        int sent = 0;
-        for (const auto& [key, state] : connections_) {
-            if (state.authenticated && state.wsPtr && state.userId != excludeUserId) {
-                auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-                ws->send(message, uWS::OpCode::TEXT);
-                sent++;
+    std::lock_guard<std::mutex> lock(loopsMutex_);
+    for (const auto& handle : loops_) {
+        if (handle.loop == currentLoop && eventLoopCount_ == 1) {
+            publishLocal(handle.app, topic, message, excludeUserId, compress);
+            continue;
+        }
+        // Every loop shares the same rendered payload
+        handle.loop->defer([this, app = handle.app, topic, message, excludeUserId, compress]() {
+            publishLocal(app, topic, message, excludeUserId, compress);
+        });
+    }
+}
+
+void WebSocketServer::publishLocal(void* appPtr, const std::string& topic, const PreparedMessage::Ptr& message,
+                                   const std::string& excludeUserId, bool compress) {
+    setLoopActivity("publish");
+    auto* app = static_cast<uWS::App*>(appPtr);
+    
+    // Sockets of the excluded user that this loop owns (safe to touch: only
+    // this thread closes them, and close removes them from the registry)
+    std::vector<WebSocket*> excluded;
+    if (!excludeUserId.empty()) {
+        connections_.forEachUserConnection(excludeUserId, [&](const ConnectionState& state) {
+            if (state.loop == currentLoop && static_cast<WebSocket*>(state.wsPtr)->isSubscribed(topic)) {
+                excluded.push_back(static_cast<WebSocket*>(state.wsPtr));
             }
+        });
+    }
+    
+    // Congested subscribers get the message through their send queue
+    // instead, where droppable traffic is coalesced
+    std::vector<WebSocket*> congested;
+    for (auto* ws : congestedSockets) {
+        if (ws->isSubscribed(topic) && std::find(excluded.begin(), excluded.end(), ws) == excluded.end()) {
+            congested.push_back(ws);
+        }
+    }
+    
+    // Frames corked earlier for subscribers must reach the wire first
+    for (auto* ws : corkedSockets) {
+        if (!ws->getUserData()->corked.empty() && ws->isSubscribed(topic)) {
+            uncork(ws);
         }
-        Logger::info("📢 Broadcast to global room: " + std::to_string(sent) + " users");
+    }
+    
+    // uWS can only skip the publishing socket itself, so excluded and
+    // congested sockets leave the topic for the (synchronous) publish
+    for (auto* ws : excluded) {
+        ws->unsubscribe(topic);
+    }
+    for (auto* ws : congested) {
+        ws->unsubscribe(topic);
+    }
+    app->publish(topic, message->payload(), message->opCode(), compress);
+    unsigned int published = app->numSubscribers(topic);  // Excluded / congested are out of the topic
+    fanoutHistogram().record(published + congested.size());
+    sendBytesCounter(true).add(static_cast<uint64_t>(published) * message->payload().size());
+    for (auto* ws : excluded) {
+        ws->subscribe(topic);
+    }
+    for (auto* ws : congested) {
+        ws->subscribe(topic);
+        sendQueued(ws, message, compress);
+    }
+}
+
+void WebSocketServer::sendQueued(void* wsPtr, const PreparedMessage::Ptr& message, bool compress) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    SendQueue& queue = ws->getUserData()->sendQueue;
+    
+    if (queue.empty() && ws->getBufferedAmount() < sendLimits_.highWatermark) {
+        writeCorked(ws, message, compress);
         return;
     }
     
-    // For other rooms, send to all room members (not just currently viewing)
-    std::vector<std::string> roomMembers;
-    try {
-        roomMembers = dbClient_->getRoomMembers(roomId);
-    } catch (...) {
-        Logger::warning("Could not get room members for: " + roomId);
+    congestedSockets.insert(ws);
+    if (!queue.push(message, compress, ws->getBufferedAmount(), sendLimits_)) {
+        LOG_DEBUG_F("Dropped message for slow consumer {} ({} bytes queued)",
+                    ws->getUserData()->username, queue.bytes());
     }
+}
+
+void WebSocketServer::flushSendQueue(void* wsPtr) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    SendQueue& queue = ws->getUserData()->sendQueue;
     
-    int sent = 0;
-    for (const auto& [key, state] : connections_) {
-        // Skip excluded user (usually sender) and unauthenticated users
-        if (!state.authenticated || !state.wsPtr || state.userId == excludeUserId) {
-            continue;
+    // Drained output leaves as one batch, sized against the high watermark
+    PerSocketData* data = ws->getUserData();
+    while (!queue.empty() && ws->getBufferedAmount() + data->corkedBytes < sendLimits_.highWatermark) {
+        const SendQueue::Entry& entry = queue.front();
+        writeCorked(ws, entry.message, entry.compress);
+        queue.pop();
+    }
+    uncork(ws);
+    if (queue.empty() && ws->getBufferedAmount() < sendLimits_.lowWatermark) {
+        congestedSockets.erase(ws);
+    }
+}
+
+void WebSocketServer::writeCorked(void* wsPtr, const PreparedMessage::Ptr& message, bool compress) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    
+    data->corked.push_back({message, compress});
+    data->corkedBytes += message->payload().size();
+    sendBytesCounter(false).add(message->payload().size());
+    if (corkDeadline_.count() == 0 || data->corkedBytes >= kCorkFlushBytes) {
+        uncork(ws);
+        return;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    if (data->corked.size() == 1) {
+        if (corkedSockets.empty()) {
+            corkedSince = now;
+        }
+        corkedSockets.push_back(ws);
+    }
+    
+    // Long loop iteration (a burst of deferred deliveries, many readable
+    // sockets): don't hold output past the deadline waiting for its end
+    if (now - corkedSince >= corkDeadline_) {
+        corkDeadlineFlushes_.fetch_add(1, std::memory_order_relaxed);
+        flushCorked();
+    }
+}
+
+void WebSocketServer::uncork(void* wsPtr) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    if (data->corked.empty()) {
+        return;
+    }
+    
+    // uWS copies everything written while corked into its cork buffer and
+    // sends it with one syscall on uncork
+    ws->cork([ws, data]() {
+        for (const auto& entry : data->corked) {
+            writeMessage(ws, *entry.message, entry.compress);
+        }
+    });
+    corkFrames_.fetch_add(data->corked.size(), std::memory_order_relaxed);
+    corkFlushes_.fetch_add(1, std::memory_order_relaxed);
+    data->corked.clear();
+    data->corkedBytes = 0;
+    
+    if (ws->getBufferedAmount() >= sendLimits_.highWatermark) {
+        congestedSockets.insert(ws);
+    }
+}
+
+void WebSocketServer::flushCorked() {
+    // uncork never closes a socket, so the list stays valid while we walk it
+    for (auto* ws : corkedSockets) {
+        uncork(ws);
+    }
+    corkedSockets.clear();
+}
+
+void WebSocketServer::sweepSlowConsumers() {
+    setLoopActivity("sweep_slow_consumers");
+    auto now = std::chrono::steady_clock::now();
+    std::vector<WebSocket*> slow;
+    
+    for (auto* ws : loopSockets) {
+        PerSocketData* data = ws->getUserData();
+        size_t buffered = ws->getBufferedAmount();
+        
+        // Topic publishes bypass sendQueued(): pick up congestion they caused
+        if (buffered >= sendLimits_.highWatermark) {
+            congestedSockets.insert(ws);
+        } else if (congestedSockets.count(ws) && buffered <= sendLimits_.lowWatermark) {
+            flushSendQueue(ws);
+            buffered = ws->getBufferedAmount();
         }
         
-        bool shouldSend = false;
+        if (buffered + data->sendQueue.bytes() <= sendLimits_.hardLimit) {
+            data->overLimitSince = {};
+        } else if (data->overLimitSince == std::chrono::steady_clock::time_point{}) {
+            data->overLimitSince = now;
+        } else if (now - data->overLimitSince >= sendLimits_.slowConsumerTimeout) {
+            slow.push_back(ws);
+        }
+    }
+    
+    // Closing runs .close, which edits loopSockets: not while iterating it
+    for (auto* ws : slow) {
+        Logger::warning("⚠️ Disconnecting slow consumer " + ws->getUserData()->username + " (" +
+                        std::to_string(ws->getBufferedAmount() + ws->getUserData()->sendQueue.bytes()) + " bytes pending)");
+        ws->end(1008, "Slow consumer");
+    }
+}
+
+void WebSocketServer::refreshBootstrap() {
+    setLoopActivity("refresh_bootstrap");
+    auto db = authManager_ ? authManager_->getDatabase() : nullptr;
+    if (!db) {
+        return;
+    }
+    if (!dbExecutor_->submit(0, [this, db]() {
+            bootstrap_.refresh([db]() { return db->getAllUsers(); });
+        })) {
+        Logger::warning("⚠️ DB executor queue full, user directory refresh skipped");
+    }
+}
+
+void WebSocketServer::flushPresence() {
+    setLoopActivity("flush_presence");
+    auto changes = presence_.flush([this](const std::string& userId) {
+        return connections_.userConnectionCount(userId) > 0;
+    });
+    if (changes.empty()) {
+        return;
+    }
+    
+    PresenceBatchMessage batch;
+    batch.users.reserve(changes.size());
+    std::vector<std::pair<std::string, std::string>> statuses;
+    for (const auto& change : changes) {
+        batch.users.push_back({change.status, change.userId, change.username});
+        // users.status is an ENUM: client-only states are broadcast, not stored
+        if (change.status == "online" || change.status == "offline" ||
+            change.status == "away" || change.status == "busy") {
+            statuses.emplace_back(change.userId, change.status);
+        }
+    }
+    
+    publish(kBroadcastTopic, PreparedMessage::create(json_writer::toString(batch)));
+    
+    if (!statuses.empty() && !dbExecutor_->submit(0, [this, statuses = std::move(statuses)]() {
+            dbClient_->updateUserStatuses(statuses);
+        })) {
+        Logger::warning("⚠️ DB executor queue full, presence statuses not stored");
+    }
+    Logger::debug("Presence batch: " + std::to_string(changes.size()) + " users");
+}
+
+void WebSocketServer::subscribeSocket(void* wsPtr, const std::string& userId) {
+    // Query where we are (DB thread after auth/login), subscribe on the loop
+    auto roomIds = dbClient_->getUserRoomIds(userId);
+    auto userBucket = rateLimiter_->userBucket(userId);
+    
+    runOnSocketLoop(wsPtr, [userId, roomIds, userBucket](void* socket) {
+        auto* ws = static_cast<WebSocket*>(socket);
+        ws->getUserData()->rate.user = userBucket;
+        
+        // Re-auth as another user on the same socket: drop the old topics first
+        std::vector<std::string> oldTopics;
+        ws->iterateTopics([&](std::string_view topic) {
+            oldTopics.emplace_back(topic);
+        });
+        for (const auto& topic : oldTopics) {
+            ws->unsubscribe(topic);
+        }
         
-        // Check if user is a member of this room (from database)
-        for (const auto& memberId : roomMembers) {
-            if (memberId == state.userId) {
-                shouldSend = true;
-                break;
+        ws->subscribe(kBroadcastTopic);
+        ws->subscribe(userTopic(userId));
+        for (const auto& roomId : roomIds) {
+            ws->subscribe(roomTopic(roomId));
+        }
+        Logger::debug("Subscribed " + userId + " to " + std::to_string(roomIds.size()) + " room topics");
+    });
+}
+
+void WebSocketServer::runOnDbExecutor(void* wsPtr, const MessageTypeEntry& entry, std::function<void()> handler) {
+    auto* ws = static_cast<WebSocket*>(wsPtr);
+    PerSocketData* data = ws->getUserData();
+    uint64_t connectionId = data->connectionId;
+    
+    // Keyed by connection: one client's DB messages run in arrival order
+    PerformanceMonitor::Histogram* histogram = handlerHistograms().db[messageTypeIndex(entry)];
+    bool queued = dbExecutor_->submit(connectionId,
+        [this, wsPtr, connectionId, loop = currentLoop, session = data->dbSession, histogram,
+         handler = std::move(handler)]() {
+            DbTaskContext context{wsPtr, connectionId, loop, session.get(), *session};
+            dbTask = &context;
+            {
+                PerformanceMonitor::Timer timer(histogram);
+                handler();
             }
+            mirrorDbSession();
+            dbTask = nullptr;
+        });
+    
+    if (!queued) {
+        Logger::warning("⚠️ DB executor queue full, rejected " + std::string(entry.name));
+        sendErrorJson(wsPtr, "Server busy, please retry");
+    }
+}
+
+void WebSocketServer::mirrorDbSession() {
+    // Login / auth / join_room changed the session: mirror it on the loop
+    if (*dbTask->session == dbTask->mirrored) {
+        return;
+    }
+    dbTask->mirrored = *dbTask->session;
+    dbTask->loop->defer([this, wsPtr = dbTask->ws, connectionId = dbTask->connectionId, updated = dbTask->mirrored]() {
+        if (connections_.isAlive(wsPtr, connectionId)) {
+            static_cast<SocketSession&>(*static_cast<WebSocket*>(wsPtr)->getUserData()) = updated;
         }
-        
-        // Also send if user is currently viewing this room
-        if (!shouldSend && state.currentRoom == roomId) {
-            shouldSend = true;
+    });
+}
+
+void WebSocketServer::runOnSocketLoop(void* wsPtr, std::function<void(void*)> action) {
+    if (currentLoop) {
+        action(wsPtr);  // Already on the socket's loop
+        return;
+    }
+    if (!dbTask || dbTask->ws != wsPtr) {
+        Logger::warning("Dropped socket action from a thread that does not serve this socket");
+        return;
+    }
+    postToSocket(socketRef(wsPtr), std::move(action));
+}
+
+WebSocketServer::SocketRef WebSocketServer::socketRef(void* wsPtr) const {
+    if (dbTask && dbTask->ws == wsPtr) {
+        return SocketRef{wsPtr, dbTask->connectionId, dbTask->loop};
+    }
+    // On the socket's own loop
+    return SocketRef{wsPtr, static_cast<WebSocket*>(wsPtr)->getUserData()->connectionId, currentLoop};
+}
+
+void WebSocketServer::postToSocket(const SocketRef& socket, std::function<void(void*)> action) {
+    if (!socket.loop) {
+        return;
+    }
+    // A reply (auth_response...) must not reach the client before the
+    // socket's own data says what the reply says
+    if (dbTask && dbTask->ws == socket.ws && dbTask->connectionId == socket.connectionId) {
+        mirrorDbSession();
+    }
+    socket.loop->defer([this, socket, action = std::move(action)]() {
+        setLoopActivity("deferred socket action");
+        if (connections_.isAlive(socket.ws, socket.connectionId)) {
+            action(socket.ws);
         }
+    });
+}
+
+void WebSocketServer::setRoomSubscription(const std::string& userId, const std::string& roomId, bool subscribed) {
+    std::string topic = roomTopic(roomId);
+    
+    connections_.forEachUserConnection(userId, [&](const ConnectionState& state) {
+        auto apply = [topic, subscribed](void* wsPtr) {
+            auto* ws = static_cast<WebSocket*>(wsPtr);
+            if (subscribed) {
+                ws->subscribe(topic);
+            } else {
+                ws->unsubscribe(topic);
+            }
+        };
         
-        if (shouldSend) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            sent++;
+        if (state.loop == currentLoop) {
+            apply(state.wsPtr);
+        } else if (state.loop) {
+            state.loop->defer([this, apply, wsPtr = state.wsPtr, connectionId = state.connectionId]() {
+                if (connections_.isAlive(wsPtr, connectionId)) {
+                    apply(wsPtr);
+                }
+            });
         }
+    });
+}
+
+void WebSocketServer::broadcast(const std::string& message) {
+    broadcast(PreparedMessage::create(message));
+}
+
+void WebSocketServer::broadcast(const PreparedMessage::Ptr& message) {
+    publish(kBroadcastTopic, message);
+    LOG_INFO_F("📢 Broadcast to {} clients", connections_.size());
+}
+
+void WebSocketServer::broadcastToRoom(const std::string& roomId, const std::string& message, const std::string& excludeUserId) {
+    broadcastToRoom(roomId, PreparedMessage::create(message), excludeUserId);
+}
+
+void WebSocketServer::broadcastToRoom(const std::string& roomId, const PreparedMessage::Ptr& message, const std::string& excludeUserId) {
+    // Special handling for "global" room - broadcast to ALL authenticated users
+    if (roomId == "global") {
+        publish(kBroadcastTopic, message, excludeUserId);
+        LOG_INFO_F("📢 Broadcast to global room");
+        return;
     }
     
-    Logger::info("📢 Broadcast to room '" + roomId + "': " + std::to_string(sent) + " users");
+    // Room members' sockets are subscribed to the room topic (on auth, join,
+    // invite, create), so fan-out needs no member lookup
+    publish(roomTopic(roomId), message, excludeUserId);
+    LOG_INFO_F("📢 Broadcast to room '{}'", roomId);
 }
 
 void WebSocketServer::sendToUser(const std::string& userId, const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    
-    Logger::info("🔍 sendToUser looking for userId: " + userId);
-    Logger::info("🔍 Total connections: " + std::to_string(connections_.size()));
+    sendToUser(userId, PreparedMessage::create(message));
+}
+
+void WebSocketServer::sendToUser(const std::string& userId, const PreparedMessage::Ptr& message) {
+    // Every device the user is connected from
+    size_t devices = connections_.userConnectionCount(userId);
     
-    for (const auto& [key, state] : connections_) {
-        Logger::debug("🔍 Checking connection: userId=" + state.userId + ", authenticated=" + std::to_string(state.authenticated));
-        if (state.authenticated && state.wsPtr && state.userId == userId) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            Logger::info("📤 Message sent to user: " + userId);
-            return;
-        }
+    if (devices > 0) {
+        publish(userTopic(userId), message);
+        LOG_INFO_F("📤 Message sent to user: {} ({} connections)", userId, devices);
+    } else {
+        Logger::warning("User not found or not connected: " + userId);
     }
-    
-    Logger::warning("User not found or not connected: " + userId);
 }
 
-void WebSocketServer::handleTypingJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleTyping(void* wsPtr, bool isTyping) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
-        bool isTyping = msg.value("isTyping", false);
+        SocketSession* data = sessionOf(ws);
         
-        json response = {
-            {"type", "typing"},
-            {"userId", data->userId},
-            {"username", data->username},
-            {"isTyping", isTyping}
-        };
+        TypingMessage response;
+        response.isTyping = isTyping;
+        response.userId = data->userId;
+        response.username = data->username;
         
         // Broadcast to room, excluding sender
-        broadcastToRoom("global", response.dump(), data->userId);
+        broadcastToRoom("global", json_writer::toString(response), data->userId);
         
     } catch (const std::exception& e) {
         Logger::error("Typing handler error: " + std::string(e.what()));
     }
 }
 
+void WebSocketServer::handleReaction(void* wsPtr, const std::string& messageId, const std::string& emoji,
+                                     const std::string& roomId) {
+    SocketSession* data = sessionOf(static_cast<WebSocket*>(wsPtr));
+    
+    ReactionAddedMessage response;
+    response.messageId = messageId;
+    response.emoji = emoji;
+    response.roomId = roomId;
+    response.userId = data->userId;
+    response.username = data->username;
+    std::string responseStr = json_writer::toString(response);
+    
+    // Send to sender
+    sendJsonMessage(wsPtr, responseStr);
+    // Broadcast to room
+    broadcastToRoom(roomId, responseStr, data->sessionId);
+    LOG_INFO_F("👍 Reaction added by {}: {}", data->username, emoji);
+}
+
 void WebSocketServer::handleGetOnlineUsersJson(void* wsPtr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* currentUser = ws->getUserData();
+        SocketSession* currentUser = sessionOf(ws);
         
-        // Get online user IDs from connections
-        std::set<std::string> onlineUserIds;
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            for (const auto& [ptr, state] : connections_) {
-                if (state.authenticated && !state.userId.empty()) {
-                    onlineUserIds.insert(state.userId);
-                }
-            }
-        }
-        
-        // Get all users from database and mark online status
-        json usersArray = json::array();
+        // Users table from memory (refreshBootstrap keeps it fresh); the
+        // rendered list is shared by every client asking within one interval
         auto db = authManager_->getDatabase();
         if (db) {
-            auto allUsers = db->getAllUsers();
-            for (const auto& user : allUsers) {
-                // Don't include current user in the list
-                if (user.userId == currentUser->userId) continue;
-                
-                bool isOnline = onlineUserIds.find(user.userId) != onlineUserIds.end();
-                usersArray.push_back({
-                    {"userId", user.userId},
-                    {"username", user.username},
-                    {"online", isOnline},
-                    {"status", isOnline ? "online" : "offline"}
-                });
-            }
+            bootstrap_.refresh([db]() { return db->getAllUsers(); }, true);
         }
+        auto reply = bootstrap_.onlineUsers(currentUser->userId, [this]() {
+            return connections_.getOnlineUserIds();
+        });
         
-        json response = {
-            {"type", "online_users"},
-            {"users", usersArray},
-            {"count", usersArray.size()}
-        };
-        
-        sendJsonMessage(wsPtr, response.dump());
-        Logger::info("📋 Sent users list: " + std::to_string(usersArray.size()) + " users (" + std::to_string(onlineUserIds.size()) + " online)");
+        if (!reply) {
+            json response = {
+                {"type", "online_users"},
+                {"users", json::array()},
+                {"count", 0}
+            };
+            reply = response.dump();
+        }
+        sendJsonMessage(wsPtr, *reply);
+        LOG_DEBUG_F("📋 Sent users list to {}", currentUser->username);
         
     } catch (const std::exception& e) {
         Logger::error("Get online users error: " + std::string(e.what()));
     }
 }
 
-void WebSocketServer::handleEditMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleEditMessageJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
-        json msg = json::parse(jsonStr);
         std::string messageId = msg.value("messageId", "");
         std::string newContent = msg.value("newContent", "");
         std::string roomId = msg.value("roomId", "global");
@@ -2154,12 +3425,11 @@ void WebSocketServer::handleEditMessageJson(void* wsPtr, const std::string& json
     }
 }
 
-void WebSocketServer::handleDeleteMessageJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleDeleteMessageJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
-        json msg = json::parse(jsonStr);
         std::string messageId = msg.value("messageId", "");
         std::string roomId = msg.value("roomId", "global");
         
@@ -2218,12 +3488,11 @@ void WebSocketServer::handleDeleteMessageJson(void* wsPtr, const std::string& js
 
 // Room management handlers
 
-void WebSocketServer::handleCreateRoomJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleCreateRoomJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
-        json msg = json::parse(jsonStr);
         // Support both 'name' and 'roomName' for compatibility
         std::string roomName = msg.value("name", msg.value("roomName", ""));
         std::string roomType = msg.value("roomType", "public");
@@ -2247,6 +3516,7 @@ void WebSocketServer::handleCreateRoomJson(void* wsPtr, const std::string& jsonS
             room.creatorId = data->userId;
             
             if (db->createRoom(room)) {
+                setRoomSubscription(data->userId, roomId, true);
                 Logger::info("✅ Room saved to database: " + roomId);
             } else {
                 Logger::warning("⚠️ Failed to save room to database");
@@ -2269,12 +3539,11 @@ void WebSocketServer::handleCreateRoomJson(void* wsPtr, const std::string& jsonS
     }
 }
 
-void WebSocketServer::handleJoinRoomJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleJoinRoomJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
-        json msg = json::parse(jsonStr);
         std::string roomId = msg.value("roomId", "");
         
         if (roomId.empty()) {
@@ -2287,19 +3556,15 @@ void WebSocketServer::handleJoinRoomJson(void* wsPtr, const std::string& jsonStr
         // Update currentRoom in PerSocketData
         data->currentRoom = roomId;
         
-        // Update currentRoom in connections_ map
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            if (connections_.count(wsPtr)) {
-                connections_[wsPtr].currentRoom = roomId;
-            }
+        // Save to room_members table (skip the write when already a member)
+        if (!dbClient_->isRoomMember(roomId, data->userId) &&
+            !dbClient_->addRoomMember(roomId, data->userId)) {
+            Logger::warning("Failed to add user to room");
         }
         
-        // Save to room_members table
-        bool added = dbClient_->addRoomMember(roomId, data->userId);
-        if (!added) {
-            Logger::warning("User already member or failed to add to room");
-        }
+        // Subscribe every device (also when the membership write failed, so
+        // the viewer still gets room broadcasts)
+        setRoomSubscription(data->userId, roomId, true);
         
         // For DM, use conversation_id from database (Discord/Telegram style)
         std::string queryRoomId = roomId;
@@ -2402,12 +3667,11 @@ void WebSocketServer::handleJoinRoomJson(void* wsPtr, const std::string& jsonStr
     }
 }
 
-void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const json& msg) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
-        json msg = json::parse(jsonStr);
         std::string roomId = msg.value("roomId", "");
         
         if (roomId.empty()) {
@@ -2429,19 +3693,12 @@ void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const std::string& jsonSt
         // Clear currentRoom in PerSocketData
         data->currentRoom = "";
         
-        // Clear currentRoom in connections_ map
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            if (connections_.count(wsPtr)) {
-                connections_[wsPtr].currentRoom = "";
-            }
-        }
-        
         // Remove from room_members table
         bool removed = dbClient_->removeRoomMember(roomId, data->userId);
         if (!removed) {
             Logger::warning("User was not member of room or failed to remove");
         }
+        setRoomSubscription(data->userId, roomId, false);
         
         json response = {
             {"type", "room_left"},
@@ -2461,7 +3718,7 @@ void WebSocketServer::handleLeaveRoomJson(void* wsPtr, const std::string& jsonSt
 void WebSocketServer::handleGetRoomsJson(void* wsPtr) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
+        SocketSession* data = sessionOf(ws);
         
         json rooms = json::array();
         
@@ -2515,11 +3772,8 @@ void WebSocketServer::handleGetRoomsJson(void* wsPtr) {
     }
 }
 
-void WebSocketServer::handleSearchMessagesJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleSearchMessagesJson(void* wsPtr, const json& msg) {
     try {
-        auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        
-        json msg = json::parse(jsonStr);
         std::string query = msg.value("query", "");
         std::string roomId = msg.value("roomId", "");
         int limit = msg.value("limit", 50);
@@ -2567,21 +3821,21 @@ void WebSocketServer::handleSearchMessagesJson(void* wsPtr, const std::string& j
     }
 }
 
-void WebSocketServer::handleMarkReadJson(void* wsPtr, const std::string& jsonStr) {
+void WebSocketServer::handleMarkReadJson(void* wsPtr, const json& msg) {
+    handleMarkRead(wsPtr, msg.value("messageId", ""), msg.value("roomId", "global"));
+}
+
+void WebSocketServer::handleMarkRead(void* wsPtr, const std::string& messageId, const std::string& roomId) {
     try {
         auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)wsPtr;
-        PerSocketData* data = ws->getUserData();
-        
-        json msg = json::parse(jsonStr);
-        std::string messageId = msg.value("messageId", "");
-        std::string roomId = msg.value("roomId", "global");
+        SocketSession* data = sessionOf(ws);
         
         if (messageId.empty()) {
             sendErrorJson(wsPtr, "Message ID required");
             return;
         }
         
-        Logger::info("✓✓ Mark read: " + messageId + " by " + data->username);
+        LOG_INFO_F("✓✓ Mark read: {} by {}", messageId, data->username);
         
         // Update read status in database
         try {
@@ -2593,25 +3847,23 @@ void WebSocketServer::handleMarkReadJson(void* wsPtr, const std::string& jsonStr
                     "VALUES (?, ?, NOW()) "
                     "ON DUPLICATE KEY UPDATE read_at = NOW()"
                 ).bind(messageId, data->userId).execute();
-                Logger::debug("Read status saved to database");
+                LOG_DEBUG_F("Read status saved to database");
             }
         } catch (const std::exception& e) {
             Logger::warning("Failed to save read status: " + std::string(e.what()));
             // Continue anyway - still broadcast the read receipt
         }
         
-        json response = {
-            {"type", "message_read"},
-            {"messageId", messageId},
-            {"roomId", roomId},
-            {"readBy", data->userId},
-            {"username", data->username},
-            {"timestamp", std::time(nullptr) * 1000}
-        };
+        MessageReadMessage response;
+        response.messageId = messageId;
+        response.roomId = roomId;
+        response.readBy = data->userId;
+        response.username = data->username;
+        response.timestamp = std::time(nullptr) * 1000;
         
         // Broadcast to room (sender will update their UI)
-        broadcastToRoom(roomId, response.dump());
-        Logger::info("✅ Read receipt sent");
+        broadcastToRoom(roomId, json_writer::toString(response));
+        LOG_INFO_F("✅ Read receipt sent");
         
     } catch (const std::exception& e) {
         Logger::error("Mark read error: " + std::string(e.what()));
@@ -2620,17 +3872,16 @@ void WebSocketServer::handleMarkReadJson(void* wsPtr, const std::string& jsonStr
 }
 
 bool WebSocketServer::sendToSession(const std::string& sessionId, const std::string& message) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    auto prepared = PreparedMessage::create(message);
     
-    for (const auto& [key, state] : connections_) {
-        if (state.authenticated && state.wsPtr && state.sessionId == sessionId) {
-            auto* ws = (uWS::WebSocket<false, true, PerSocketData>*)state.wsPtr;
-            ws->send(message, uWS::OpCode::TEXT);
-            Logger::debug("📤 Sent to session: " + sessionId);
-            return true;
-        }
-    }
+    bool found = connections_.withSession(sessionId, [&](const ConnectionState& state) {
+        deliver(state, prepared, false);
+    });
     
-    Logger::warning("Session not found: " + sessionId);
-    return false;
+    if (found) {
+        LOG_DEBUG_F("📤 Sent to session: {}", sessionId);
+    } else {
+        Logger::warning("Session not found: " + sessionId);
+    }
+    return found;
 }
@@ -0,0 +1,101 @@
+// ConnectionRegistry indexes stay consistent across auth, re-auth, socket
+// reuse, removal and rehashing.
+
+#include "websocket/connection_registry.h"
+#include "test_check.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t countUser(const ConnectionRegistry& registry, const std::string& userId) {
+    return registry.forEachUserConnection(userId, [](const ConnectionState&) {});
+}
+
+void testIndexes() {
+    ConnectionRegistry registry;
+    char a, b, c;
+
+    uint64_t idA = registry.add(&a, nullptr);
+    registry.add(&b, nullptr);
+    registry.add(&c, nullptr);
+    CHECK(registry.size() == 3);
+    CHECK(countUser(registry, "alice") == 0);
+
+    CHECK(registry.authenticate(&a, "alice", "Alice", "s-a"));
+    CHECK(registry.authenticate(&b, "alice", "Alice", "s-b"));
+    CHECK(registry.authenticate(&c, "bob", "Bob", "s-c"));
+    CHECK(!registry.authenticate(nullptr, "eve", "Eve", "s-e"));
+    CHECK(registry.userConnectionCount("alice") == 2);
+    CHECK(countUser(registry, "alice") == 2);
+    CHECK(registry.getOnlineUserIds().size() == 2);
+
+    void* found = nullptr;
+    CHECK(registry.withSession("s-b", [&](const ConnectionState& state) { found = state.wsPtr; }));
+    CHECK(found == &b);
+    CHECK(registry.isAlive(&a, idA));
+
+    // Re-auth as another user moves the socket between indexes
+    CHECK(registry.authenticate(&b, "bob", "Bob", "s-b2"));
+    CHECK(registry.userConnectionCount("alice") == 1);
+    CHECK(registry.userConnectionCount("bob") == 2);
+    CHECK(!registry.withSession("s-b", [](const ConnectionState&) {}));
+
+    // Removing the last device drops the user
+    auto removed = registry.remove(&a);
+    CHECK(removed && removed->userId == "alice" && removed->sessionId == "s-a");
+    CHECK(registry.userConnectionCount("alice") == 0);
+    CHECK(!registry.withSession("s-a", [](const ConnectionState&) {}));
+    CHECK(!registry.isAlive(&a, idA));
+    CHECK(!registry.remove(&a));
+
+    // A reused socket address is a new, unindexed connection
+    uint64_t idC = 0;
+    registry.withSession("s-c", [&](const ConnectionState& state) { idC = state.connectionId; });
+    uint64_t reused = registry.add(&c, nullptr);
+    CHECK(reused != idC);
+    CHECK(!registry.isAlive(&c, idC));
+    CHECK(registry.userConnectionCount("bob") == 1);
+    CHECK(!registry.withSession("s-c", [](const ConnectionState&) {}));
+}
+
+void testStableAcrossRehash() {
+    ConnectionRegistry registry;
+    std::vector<char> sockets(5000);
+    for (size_t i = 0; i < sockets.size(); i++) {
+        registry.add(&sockets[i], nullptr);
+        registry.authenticate(&sockets[i], "user-" + std::to_string(i % 1000), "u",
+                              "session-" + std::to_string(i));
+    }
+    CHECK(registry.size() == sockets.size());
+
+    size_t matched = 0;
+    for (size_t i = 0; i < sockets.size(); i += 7) {
+        registry.withSession("session-" + std::to_string(i), [&](const ConnectionState& state) {
+            matched += state.wsPtr == &sockets[i];
+        });
+    }
+    CHECK(matched == (sockets.size() + 6) / 7);
+
+    size_t devices = 0;
+    registry.forEachUserConnection("user-7", [&](const ConnectionState& state) {
+        devices += state.userId == "user-7";
+    });
+    CHECK(devices == 5);
+
+    for (size_t i = 0; i < sockets.size(); i += 2) {
+        registry.remove(&sockets[i]);
+    }
+    CHECK(registry.userConnectionCount("user-7") == 5);   // Odd indexes only
+    CHECK(registry.userConnectionCount("user-8") == 0);
+    CHECK(registry.forEachAuthenticated([](const ConnectionState&) {}) == sockets.size() / 2);
+}
+
+} // namespace
+
+int main() {
+    testIndexes();
+    testStableAcrossRehash();
+    return TEST_MAIN_RESULT();
+}
@@ -0,0 +1,69 @@
+// checksum::crc32 against an independent bit-at-a-time CRC-32, for
+// whichever kernel this CPU selected and for the portable one.
+
+#include "utils/crc32.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+uint32_t bitwiseCrc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+        }
+    }
+    return ~crc;
+}
+
+void testCheckValues() {
+    CHECK(checksum::crc32("123456789", 9) == 0xCBF43926u);
+    CHECK(checksum::crc32Portable("123456789", 9) == 0xCBF43926u);
+    CHECK(checksum::crc32("", 0) == 0);
+    CHECK(checksum::crc32("The quick brown fox jumps over the lazy dog", 43) == 0x414FA339u);
+}
+
+void testAgainstBitwise() {
+    std::vector<uint8_t> buffer(4096 + 64);
+    uint32_t seed = 0xC0FFEEu;
+    for (auto& byte : buffer) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+
+    for (size_t offset : {0, 1, 7, 15, 33}) {
+        const uint8_t* data = buffer.data() + offset;
+        for (size_t length = 0; length <= 4096; length += (length < 300 ? 1 : 61)) {
+            uint32_t expected = bitwiseCrc32(data, length);
+            CHECK(checksum::crc32(data, length) == expected);
+            CHECK(checksum::crc32Portable(data, length) == expected);
+        }
+    }
+}
+
+void testContinuation() {
+    std::vector<uint8_t> buffer(1000);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+    uint32_t whole = bitwiseCrc32(buffer.data(), buffer.size());
+    for (size_t split : {0, 1, 63, 64, 65, 500, 999, 1000}) {
+        uint32_t crc = checksum::crc32(buffer.data(), split);
+        crc = checksum::crc32(buffer.data() + split, buffer.size() - split, crc);
+        CHECK(crc == whole);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("crc32 implementation: %s\n", checksum::crc32Implementation());
+    testCheckValues();
+    testAgainstBitwise();
+    testContinuation();
+    return TEST_MAIN_RESULT();
+}
@@ -0,0 +1,141 @@
+// json_writer output must be byte-identical to nlohmann::json::dump(), for
+// every typed message and for arbitrary (including invalid) string bytes.
+
+#include "websocket/protocol_messages.h"
+#include "test_check.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using json = nlohmann::json;
+
+// Random bytes biased towards the escaper's edge cases
+std::string randomString(std::mt19937& rng) {
+    static const std::string pieces[] = {
+        "a", "Z", "0", " ", "\"", "\\", "/", "\b", "\f", "\n", "\r", "\t",
+        std::string(1, '\0'), "\x01", "\x1F", "\x7F",
+        "\xC3\xA9",                  // é
+        "\xE2\x82\xAC",              // €
+        "\xF0\x9F\x91\x8D",          // 👍
+        "\xC3",                      // Truncated 2-byte sequence
+        "\xE2\x82",                  // Truncated 3-byte sequence
+        "\xC0\x80",                  // Overlong NUL
+        "\xED\xA0\x80",              // UTF-16 surrogate
+        "\xF4\x90\x80\x80",          // Past U+10FFFF
+        "\x80", "\xFF",              // Stray continuation, invalid byte
+        "plain ascii run of text ",
+    };
+    constexpr size_t count = sizeof(pieces) / sizeof(pieces[0]);
+    std::string out;
+    size_t length = rng() % 12;
+    for (size_t i = 0; i < length; i++) {
+        out += pieces[rng() % count];
+    }
+    return out;
+}
+
+void testStringsMatchDump() {
+    std::mt19937 rng(20240611);
+    size_t mismatches = 0;
+    size_t rejected = 0;
+    for (int i = 0; i < 200000; i++) {
+        std::string value = randomString(rng);
+
+        std::string expected;
+        bool dumpThrew = false;
+        try {
+            expected = json(value).dump();
+        } catch (const json::exception&) {
+            dumpThrew = true;
+        }
+
+        std::string actual;
+        bool writerThrew = false;
+        try {
+            json_writer::appendString(actual, value);
+        } catch (const std::invalid_argument&) {
+            writerThrew = true;
+        }
+
+        if (dumpThrew != writerThrew || (!dumpThrew && actual != expected)) {
+            mismatches++;
+        }
+        rejected += dumpThrew;
+    }
+    CHECK(mismatches == 0);
+    CHECK(rejected > 0);  // The generator does reach the invalid cases
+}
+
+void testMessagesMatchDump() {
+    json metadata = {{"fileId", "f-1"}, {"fileName", "notes \"final\".pdf"}, {"size", 1024}};
+
+    ChatMessage chat;
+    chat.content = "Line one\nLine \"two\" \xE2\x82\xAC";
+    chat.messageId = "msg-1700000000000-42";
+    chat.roomId = "room-4f1c";
+    chat.timestamp = 1700000000000;
+    chat.userId = "user-1";
+    chat.username = "alice";
+    json chatJson = {
+        {"type", "chat"}, {"content", chat.content}, {"messageId", chat.messageId},
+        {"roomId", chat.roomId}, {"timestamp", chat.timestamp},
+        {"userId", chat.userId}, {"username", chat.username}
+    };
+    CHECK(json_writer::toString(chat) == chatJson.dump());
+
+    chat.metadata = &metadata;
+    chatJson["metadata"] = metadata;
+    CHECK(json_writer::toString(chat) == chatJson.dump());
+
+    json nullMetadata;
+    chat.metadata = &nullMetadata;  // null is left out
+    chatJson.erase("metadata");
+    CHECK(json_writer::toString(chat) == chatJson.dump());
+
+    TypingMessage typing;
+    typing.isTyping = true;
+    typing.userId = "user-1";
+    typing.username = "alice";
+    CHECK(json_writer::toString(typing) ==
+          json({{"type", "typing"}, {"isTyping", true}, {"userId", "user-1"}, {"username", "alice"}}).dump());
+
+    ReactionAddedMessage reaction;
+    reaction.emoji = "\xF0\x9F\x91\x8D";
+    reaction.messageId = "msg-1";
+    reaction.roomId = "room-4f1c";
+    reaction.userId = "user-2";
+    reaction.username = "bob";
+    CHECK(json_writer::toString(reaction) ==
+          json({{"type", "reaction_added"}, {"emoji", reaction.emoji}, {"messageId", "msg-1"},
+                {"roomId", "room-4f1c"}, {"userId", "user-2"}, {"username", "bob"}}).dump());
+
+    MessageReadMessage read;
+    read.messageId = "msg-1";
+    read.readBy = "user-2";
+    read.roomId = "room-4f1c";
+    read.timestamp = -1;
+    read.username = "bob";
+    CHECK(json_writer::toString(read) ==
+          json({{"type", "message_read"}, {"messageId", "msg-1"}, {"readBy", "user-2"},
+                {"roomId", "room-4f1c"}, {"timestamp", -1}, {"username", "bob"}}).dump());
+
+    PresenceBatchMessage batch;
+    json users = json::array();
+    CHECK(json_writer::toString(batch) == json({{"type", "presence_batch"}, {"users", users}}).dump());
+    batch.users.push_back(PresenceEntry{"online", "user-1", "alice"});
+    batch.users.push_back(PresenceEntry{"away", "user-2", "b\tob"});
+    users.push_back({{"status", "online"}, {"userId", "user-1"}, {"username", "alice"}});
+    users.push_back({{"status", "away"}, {"userId", "user-2"}, {"username", "b\tob"}});
+    CHECK(json_writer::toString(batch) == json({{"type", "presence_batch"}, {"users", users}}).dump());
+}
+
+} // namespace
+
+int main() {
+    testStringsMatchDump();
+    testMessagesMatchDump();
+    return TEST_MAIN_RESULT();
+}
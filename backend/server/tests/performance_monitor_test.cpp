@@ -0,0 +1,98 @@
+// PerformanceMonitor shards: samples recorded on many threads (including
+// threads that exit before the scrape) are all exported, and scrapes
+// running concurrently with recording never see counts go backwards.
+
+#include "utils/logging.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using chatbox::logging::PerformanceMonitor;
+
+namespace {
+
+// Value of the first exported line starting with `prefix`, -1 if missing
+long long metricValue(const std::string& metrics, std::string_view prefix) {
+    size_t pos = 0;
+    while (pos < metrics.size()) {
+        size_t end = metrics.find('\n', pos);
+        std::string_view line(metrics.data() + pos, (end == std::string::npos ? metrics.size() : end) - pos);
+        if (line.substr(0, prefix.size()) == prefix) {
+            return std::stoll(std::string(line.substr(line.rfind(' ') + 1)));
+        }
+        pos = end == std::string::npos ? metrics.size() : end + 1;
+    }
+    return -1;
+}
+
+void testConcurrentMerge() {
+    constexpr int kThreads = 8;
+    constexpr int kSamples = 200000;
+
+    auto& histogram = PerformanceMonitor::histogram("test_values", "case=\"merge\"", PerformanceMonitor::Unit::COUNT);
+    auto& counter = PerformanceMonitor::counter("test_events_total", "case=\"merge\"");
+
+    std::atomic<bool> done{false};
+    bool monotonic = true;
+    std::thread scraper([&] {
+        long long last = 0;
+        while (!done.load()) {
+            long long count = metricValue(PerformanceMonitor::getMetrics(), "test_values_count{case=\"merge\"}");
+            if (count >= 0) {
+                monotonic = monotonic && count >= last;
+                last = count;
+            }
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; t++) {
+        writers.emplace_back([&] {
+            for (int i = 0; i < kSamples; i++) {
+                histogram.record(static_cast<uint64_t>(i % 100));  // Uniform 0..99
+                counter.add();
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();  // Shards fold into the retired totals on exit
+    }
+    done = true;
+    scraper.join();
+
+    std::string metrics = PerformanceMonitor::getMetrics();
+    long long total = static_cast<long long>(kThreads) * kSamples;
+    CHECK(monotonic);
+    CHECK(metricValue(metrics, "test_values_count{case=\"merge\"}") == total);
+    CHECK(metricValue(metrics, "test_events_total{case=\"merge\"}") == total);
+    CHECK(metricValue(metrics, "test_values_bucket{case=\"merge\",le=\"+Inf\"}") == total);
+    // 0..50 is 51 of every 100 values; exact at this bound
+    CHECK(metricValue(metrics, "test_values_bucket{case=\"merge\",le=\"50\"}") == total * 51 / 100);
+    CHECK(metricValue(metrics, "test_values_sum{case=\"merge\"}") == total / 100 * 4950);
+}
+
+void testRegistration() {
+    auto& a = PerformanceMonitor::histogram("test_seconds", "op=\"a\"");
+    auto& b = PerformanceMonitor::histogram("test_seconds", "op=\"b\"");
+    CHECK(&a == &PerformanceMonitor::histogram("test_seconds", "op=\"a\""));
+    CHECK(&a != &b);
+
+    a.recordDuration(std::chrono::microseconds(1500));
+    std::string metrics = PerformanceMonitor::getMetrics();
+    CHECK(metricValue(metrics, "test_seconds_count{op=\"a\"}") == 1);
+    CHECK(metricValue(metrics, "test_seconds_count{op=\"b\"}") == 0);
+    CHECK(metricValue(metrics, "test_seconds_bucket{op=\"a\",le=\"0.001\"}") == 0);
+    CHECK(metricValue(metrics, "test_seconds_bucket{op=\"a\",le=\"0.0025\"}") == 1);
+}
+
+} // namespace
+
+int main() {
+    testConcurrentMerge();
+    testRegistration();
+    return TEST_MAIN_RESULT();
+}
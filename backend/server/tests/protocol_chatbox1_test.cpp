@@ -0,0 +1,266 @@
+// ChatBox1 v1/v2 codec: round trips and rejection of malformed frames.
+// parsePacket / parsePacketV2 take untrusted bytes straight off the socket.
+
+#include "protocol_chatbox1.h"
+#include "websocket/intern_table.h"
+#include "test_check.h"
+
+#include <string>
+#include <string_view>
+
+using namespace ProtocolChatBox1;
+
+namespace {
+
+std::string_view view(const std::vector<uint8_t>& data) {
+    return std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void testV1RoundTrip() {
+    const std::string payload = "hello room";
+    PacketHeader header = createHeader(MSG_CHAT_TEXT, "alice", "chat.group.42",
+                                       static_cast<uint32_t>(payload.size()));
+    std::vector<uint8_t> frame = serializePacket(header, payload.data(), payload.size());
+
+    PacketHeader parsed{};
+    std::string_view parsedPayload;
+    CHECK(parsePacket(view(frame), parsed, parsedPayload));
+    CHECK(parsed.msgType == MSG_CHAT_TEXT);
+    CHECK(parsedPayload == payload);
+    CHECK(fieldString(parsed.sender, sizeof(parsed.sender)) == "alice");
+    CHECK(fieldString(parsed.topic, sizeof(parsed.topic)) == "chat.group.42");
+
+    // Empty payload
+    std::vector<uint8_t> empty = serializePacket(header, nullptr, 0);
+    CHECK(parsePacket(view(empty), parsed, parsedPayload));
+    CHECK(parsedPayload.empty());
+}
+
+void testV1Rejects() {
+    const std::string payload = "abc";
+    PacketHeader header = createHeader(MSG_CHAT_TEXT, "alice", "t", 3);
+    std::vector<uint8_t> frame = serializePacket(header, payload.data(), payload.size());
+    PacketHeader parsed{};
+    std::string_view parsedPayload;
+
+    // Every truncation, including a partial header
+    for (size_t length = 0; length < frame.size(); length++) {
+        CHECK(!parsePacket(view(frame).substr(0, length), parsed, parsedPayload));
+    }
+
+    // Trailing bytes past payloadLength
+    std::vector<uint8_t> longer = frame;
+    longer.push_back('x');
+    CHECK(!parsePacket(view(longer), parsed, parsedPayload));
+
+    // payloadLength larger than the frame
+    std::vector<uint8_t> oversized = frame;
+    PacketHeader* raw = reinterpret_cast<PacketHeader*>(oversized.data());
+    raw->payloadLength = 0xFFFFFFFFu;
+    CHECK(!parsePacket(view(oversized), parsed, parsedPayload));
+
+    // Corrupted payload
+    std::vector<uint8_t> corrupt = frame;
+    corrupt.back() ^= 0x01;
+    CHECK(!parsePacket(view(corrupt), parsed, parsedPayload));
+
+    // Unknown protocol version
+    std::vector<uint8_t> version = frame;
+    reinterpret_cast<PacketHeader*>(version.data())->version = 7;
+    CHECK(!parsePacket(view(version), parsed, parsedPayload));
+}
+
+void testVarints() {
+    const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, UINT32_MAX,
+                               uint64_t(1) << 63, UINT64_MAX};
+    for (uint64_t value : values) {
+        std::string encoded;
+        appendVarint(encoded, value);
+        std::string_view in = encoded;
+        uint64_t decoded = 0;
+        CHECK(readVarint(in, decoded));
+        CHECK(decoded == value);
+        CHECK(in.empty());
+
+        // Any truncation of the encoding fails
+        for (size_t length = 0; length < encoded.size(); length++) {
+            std::string_view prefix = std::string_view(encoded).substr(0, length);
+            CHECK(!readVarint(prefix, decoded));
+        }
+    }
+
+    uint64_t decoded = 0;
+
+    // 11 bytes: longer than any uint64_t
+    std::string overlong(10, '\x80');
+    overlong.push_back('\x01');
+    std::string_view in = overlong;
+    CHECK(!readVarint(in, decoded));
+
+    // 10 bytes, but the last one sets bits past 64
+    std::string overflow(9, '\xFF');
+    overflow.push_back('\x02');
+    in = overflow;
+    CHECK(!readVarint(in, decoded));
+}
+
+void testStrings() {
+    std::string encoded;
+    appendString(encoded, "msg-1");
+    appendString(encoded, "");
+    appendString(encoded, "\xF0\x9F\x91\x8D");
+
+    std::string_view in = encoded;
+    std::string_view value;
+    CHECK(readString(in, value) && value == "msg-1");
+    CHECK(readString(in, value) && value.empty());
+    CHECK(readString(in, value) && value == "\xF0\x9F\x91\x8D");
+    CHECK(in.empty());
+
+    // Length past the end of the input
+    std::string oversized;
+    appendVarint(oversized, 1000);
+    oversized += "short";
+    in = oversized;
+    CHECK(!readString(in, value));
+
+    std::string huge;
+    appendVarint(huge, UINT64_MAX);
+    in = huge;
+    CHECK(!readString(in, value));
+}
+
+void testV2RoundTrip() {
+    for (uint8_t flags : {uint8_t(0), uint8_t(FLAG_CHECKSUM), uint8_t(FLAG_CHECKSUM | FLAG_PRIORITY)}) {
+        PacketHeaderV2 header;
+        header.msgType = MSG_INTERN;  // Two-byte varint
+        header.flags = flags;
+        header.topicId = 300;
+        const std::string payload(200, 'p');  // Two-byte length
+        std::string frame = serializePacketV2(header, payload);
+
+        PacketHeaderV2 parsed;
+        std::string_view parsedPayload;
+        CHECK(parsePacketV2(frame, parsed, parsedPayload));
+        CHECK(parsed.msgType == MSG_INTERN);
+        CHECK(parsed.flags == flags);
+        CHECK(parsed.topicId == 300);
+        CHECK(parsedPayload == payload);
+
+        // Every truncation
+        for (size_t length = 0; length < frame.size(); length++) {
+            CHECK(!parsePacketV2(std::string_view(frame).substr(0, length), parsed, parsedPayload));
+        }
+
+        // Trailing garbage
+        CHECK(!parsePacketV2(frame + "x", parsed, parsedPayload));
+    }
+
+    // Empty payload, no topic
+    PacketHeaderV2 ping;
+    ping.msgType = MSG_PING;
+    std::string frame = serializePacketV2(ping, "");
+    PacketHeaderV2 parsed;
+    std::string_view parsedPayload;
+    CHECK(parsePacketV2(frame, parsed, parsedPayload));
+    CHECK(parsed.msgType == MSG_PING && parsed.topicId == 0 && parsedPayload.empty());
+}
+
+// Hand-built v2 frame: version | msgType | flags | topicId | length | payload
+std::string v2Frame(uint64_t msgType, uint8_t flags, uint64_t topicId, uint64_t length,
+                    std::string_view rest) {
+    std::string out(1, static_cast<char>(PROTOCOL_VERSION_V2));
+    appendVarint(out, msgType);
+    out.push_back(static_cast<char>(flags));
+    appendVarint(out, topicId);
+    appendVarint(out, length);
+    out.append(rest);
+    return out;
+}
+
+void testV2Rejects() {
+    PacketHeaderV2 parsed;
+    std::string_view payload;
+
+    CHECK(v2Frame(MSG_CHAT_TEXT, 0, 1, 2, "hi").size() == 7);
+    CHECK(parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, 1, 2, "hi"), parsed, payload));
+
+    // Wrong version byte (a v1 header starts with msgType)
+    std::string wrongVersion = v2Frame(MSG_CHAT_TEXT, 0, 1, 2, "hi");
+    wrongVersion[0] = PROTOCOL_VERSION;
+    CHECK(!parsePacketV2(wrongVersion, parsed, payload));
+
+    // Declared length larger than the frame, and absurdly large
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, 1, 3, "hi"), parsed, payload));
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, 1, UINT64_MAX, "hi"), parsed, payload));
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, 1, uint64_t(1) << 40, "hi"), parsed, payload));
+
+    // Fields that do not fit the 32-bit header
+    CHECK(!parsePacketV2(v2Frame(uint64_t(UINT32_MAX) + 1, 0, 1, 2, "hi"), parsed, payload));
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, uint64_t(UINT32_MAX) + 1, 2, "hi"), parsed, payload));
+    CHECK(parsePacketV2(v2Frame(MSG_CHAT_TEXT, 0, UINT32_MAX, 2, "hi"), parsed, payload));
+    CHECK(parsed.topicId == UINT32_MAX);
+
+    // Unterminated varint in each header position
+    std::string unterminated(1, static_cast<char>(PROTOCOL_VERSION_V2));
+    unterminated += std::string(12, '\x80');
+    CHECK(!parsePacketV2(unterminated, parsed, payload));
+
+    std::string badTopic(1, static_cast<char>(PROTOCOL_VERSION_V2));
+    appendVarint(badTopic, MSG_CHAT_TEXT);
+    badTopic.push_back(0);
+    badTopic += std::string(11, '\x80');
+    CHECK(!parsePacketV2(badTopic, parsed, payload));
+
+    // Checksum flag without a trailer, and a wrong trailer
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, FLAG_CHECKSUM, 1, 2, "hi"), parsed, payload));
+    CHECK(!parsePacketV2(v2Frame(MSG_CHAT_TEXT, FLAG_CHECKSUM, 1, 2, std::string("hi\0\0\0\0", 6)),
+                         parsed, payload));
+
+    PacketHeaderV2 header;
+    header.msgType = MSG_CHAT_TEXT;
+    header.flags = FLAG_CHECKSUM;
+    std::string frame = serializePacketV2(header, "payload");
+    frame[frame.size() - 5] ^= 0x20;  // Last payload byte
+    CHECK(!parsePacketV2(frame, parsed, payload));
+
+    CHECK(!parsePacketV2("", parsed, payload));
+}
+
+void testInternTable() {
+    InternTable table(2);
+    CHECK(table.lookup(0) == nullptr);  // 0 = no topic
+    CHECK(table.lookup(1) == nullptr);  // Never assigned
+
+    InternTable::Interned a = table.intern("room-a");
+    InternTable::Interned b = table.intern("room-b");
+    CHECK(a.id != 0 && b.id != 0 && a.id != b.id);
+    CHECK(!a.evicted && !b.evicted);
+    CHECK(table.intern("room-a").id == a.id);  // Stable, and now most recent
+    CHECK(table.lookup(a.id) && *table.lookup(a.id) == "room-a");
+
+    // Over capacity: least recently used (room-b) goes, its ID is not reused
+    InternTable::Interned c = table.intern("room-c");
+    CHECK(c.evicted && *c.evicted == b.id);
+    CHECK(c.id != a.id && c.id != b.id);
+    CHECK(table.lookup(b.id) == nullptr);
+    CHECK(table.size() == 2);
+
+    InternTable::Interned again = table.intern("room-b");
+    CHECK(again.id != b.id);
+    CHECK(table.lookup(b.id) == nullptr);
+    CHECK(table.lookup(UINT32_MAX) == nullptr);
+}
+
+} // namespace
+
+int main() {
+    testV1RoundTrip();
+    testV1Rejects();
+    testVarints();
+    testStrings();
+    testV2RoundTrip();
+    testV2Rejects();
+    testInternTable();
+    return TEST_MAIN_RESULT();
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Connect / auth / broadcast smoke test against a running chat_server.
+
+Start the server with SERVER_THREADS > 1 in config/.env and a reachable
+MySQL, then:
+
+    python3 tests/smoke_test.py --port 8080 --clients 16
+
+Every client registers (or reuses) a smoke-test user, logs in and sends
+one chat message to "global". Each client must receive every message,
+its own echo included. Connections are spread over the event loops by
+SO_REUSEPORT, so with several loops most deliveries cross loops. Not run
+by ctest: it needs the server and its database. Standard library only.
+"""
+
+import argparse
+import base64
+import json
+import os
+import socket
+import struct
+import sys
+import time
+import urllib.request
+
+
+class Client:
+    """Minimal RFC 6455 client: text frames, masked, no extensions."""
+
+    def __init__(self, host, port, timeout):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.buffer = b""
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall((
+            "GET / HTTP/1.1\r\n"
+            f"Host: {host}:{port}\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            f"Sec-WebSocket-Key: {key}\r\n"
+            "Sec-WebSocket-Version: 13\r\n\r\n").encode())
+        while b"\r\n\r\n" not in self.buffer:
+            self._fill()
+        head, self.buffer = self.buffer.split(b"\r\n\r\n", 1)
+        if not head.startswith(b"HTTP/1.1 101"):
+            raise RuntimeError("upgrade refused: " + head.split(b"\r\n", 1)[0].decode())
+
+    def _fill(self):
+        chunk = self.sock.recv(65536)
+        if not chunk:
+            raise RuntimeError("connection closed by server")
+        self.buffer += chunk
+
+    def _take(self, n):
+        while len(self.buffer) < n:
+            self._fill()
+        data, self.buffer = self.buffer[:n], self.buffer[n:]
+        return data
+
+    def send(self, message):
+        payload = json.dumps(message).encode()
+        header = bytes([0x81])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([0x80 | 126]) + struct.pack("!H", len(payload))
+        else:
+            header += bytes([0x80 | 127]) + struct.pack("!Q", len(payload))
+        mask = os.urandom(4)
+        self.sock.sendall(header + mask + bytes(b ^ mask[i % 4] for i, b in enumerate(payload)))
+
+    def receive(self):
+        """Next text message as JSON; control frames are handled here."""
+        while True:
+            first, second = self._take(2)
+            length = second & 0x7F
+            if length == 126:
+                length = struct.unpack("!H", self._take(2))[0]
+            elif length == 127:
+                length = struct.unpack("!Q", self._take(8))[0]
+            payload = self._take(length)
+            opcode = first & 0x0F
+            if opcode == 0x1:
+                return json.loads(payload)
+            if opcode == 0x8:
+                raise RuntimeError("server closed the connection")
+            if opcode == 0x9:  # Ping: answer with a masked pong
+                self.sock.sendall(bytes([0x8A, 0x80 | length]) + b"\0\0\0\0" + payload)
+
+    def wait_for(self, predicate, what, deadline):
+        while time.monotonic() < deadline:
+            message = self.receive()
+            if predicate(message):
+                return message
+        raise RuntimeError("timed out waiting for " + what)
+
+
+def event_loops(host, port):
+    with urllib.request.urlopen(f"http://{host}:{port}/health", timeout=5) as response:
+        return json.load(response).get("eventLoops", 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n", 1)[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--clients", type=int, default=16)
+    parser.add_argument("--password", default="smoke-test-password")
+    parser.add_argument("--timeout", type=float, default=10.0)
+    args = parser.parse_args()
+
+    loops = event_loops(args.host, args.port)
+    print(f"server: {loops} event loop(s)")
+    if loops < 2:
+        print("FAIL: set SERVER_THREADS > 1 so broadcasts cross event loops")
+        return 1
+
+    deadline = time.monotonic() + args.timeout
+    clients = []
+    for i in range(args.clients):
+        client = Client(args.host, args.port, args.timeout)
+        username = f"smoke_user_{i}"
+        client.send({"type": "register", "username": username, "password": args.password})
+        client.wait_for(lambda m: m.get("type") == "register_response", "register_response", deadline)
+        client.send({"type": "login", "username": username, "password": args.password})
+        login = client.wait_for(lambda m: m.get("type") == "login_response", "login_response", deadline)
+        if not login.get("success"):
+            print(f"FAIL: login {username}: {login.get('message')}")
+            return 1
+        clients.append(client)
+    print(f"connected and logged in: {len(clients)} clients")
+
+    nonce = base64.b32encode(os.urandom(5)).decode()
+    contents = {f"smoke {nonce} from {i}" for i in range(len(clients))}
+    for i, client in enumerate(clients):
+        client.send({"type": "chat", "roomId": "global", "content": f"smoke {nonce} from {i}"})
+
+    deadline = time.monotonic() + args.timeout
+    for i, client in enumerate(clients):
+        missing = set(contents)
+        try:
+            while missing:
+                message = client.wait_for(
+                    lambda m: m.get("type") == "chat" and m.get("content") in missing, "chat", deadline)
+                missing.discard(message["content"])
+        except (RuntimeError, OSError) as error:
+            print(f"FAIL: client {i} is missing {len(missing)} of {len(contents)} messages ({error})")
+            return 1
+
+    print(f"OK: {len(clients)} clients each received all {len(contents)} broadcasts "
+          f"across {loops} event loops")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
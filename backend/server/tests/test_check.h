@@ -0,0 +1,24 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+
+// Minimal check macro for the test executables: reports every failure and
+// lets main() return the count.
+inline int testFailures = 0;
+
+#define CHECK(expr)                                                         \
+    do {                                                                    \
+        if (!(expr)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n",               \
+                         __FILE__, __LINE__, #expr);                        \
+            testFailures++;                                                 \
+        }                                                                   \
+    } while (0)
+
+#define TEST_MAIN_RESULT()                                                  \
+    (testFailures == 0 ? (std::printf("all checks passed\n"), 0)            \
+                       : (std::fprintf(stderr, "%d check(s) failed\n",      \
+                                       testFailures), 1))
+
+#endif // TEST_CHECK_H
@@ -153,8 +153,9 @@ export function useWebSocket() {
             console.log('WebSocket disconnected');
             setConnected(false);
 
-            // Reconnect after 3 seconds
-            reconnectTimeoutRef.current = setTimeout(connect, 3000);
+            // Reconnect after 1-5 seconds: spread out so a server restart
+            // does not bring every client back in the same instant
+            reconnectTimeoutRef.current = setTimeout(connect, 1000 + Math.random() * 4000);
         };
 
         ws.onerror = (error) => {
@@ -168,6 +169,19 @@ export function useWebSocket() {
                 console.log('Authenticated');
                 break;
 
+            case 'auth_response':
+                // Server busy (reconnect storm): retry when told, with jitter
+                if (!data.success && data.retryAfterMs) {
+                    const token = localStorage.getItem('token');
+                    setTimeout(() => {
+                        const ws = wsRef.current;
+                        if (token && ws?.readyState === WebSocket.OPEN) {
+                            ws.send(JSON.stringify({ type: 'auth', token }));
+                        }
+                    }, data.retryAfterMs + Math.random() * 1000);
+                }
+                break;
+
             case 'chat':
                 console.log('📩 Received chat message:', data);
                 console.log('📩 Chat roomId:', data.roomId, 'content:', data.content);
@@ -552,6 +566,24 @@ export function useWebSocket() {
                 ));
                 break;
 
+            case 'presence_batch': {
+                // Connects, disconnects and status changes collected server-side
+                const changes = new Map<string, any>((data.users || []).map((p: any) => [p.userId, p]));
+                setUsers(prev => {
+                    const updated = prev.map(u => {
+                        const p = changes.get(u.id);
+                        if (!p) return u;
+                        changes.delete(u.id);
+                        return { ...u, username: p.username || u.username, status: p.status, online: p.status !== 'offline' && p.status !== 'invisible' };
+                    });
+                    const added = [...changes.values()]
+                        .filter((p: any) => p.status !== 'offline')
+                        .map((p: any) => ({ id: p.userId, username: p.username, status: p.status, online: true }));
+                    return [...updated, ...added];
+                });
+                break;
+            }
+
             // Profile
             case 'profile_update_response':
                 console.log('📝 Profile update response:', data);
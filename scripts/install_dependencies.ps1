@@ -78,7 +78,9 @@ Write-Host "Step 5: Installing other dependencies..." -ForegroundColor Yellow
 $packages = @(
     "openssl:x64-windows",
     "curl:x64-windows",
-    "zlib:x64-windows"
+    "zlib:x64-windows",
+    "simdjson:x64-windows",
+    "fmt:x64-windows"
 )
 
 foreach ($pkg in $packages) {